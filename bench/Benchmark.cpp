@@ -0,0 +1,222 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include "Debugger.h"
+#include "DwarfContext.h"
+#include "SyntheticProgram.h"
+
+using namespace SyntheticProgram;
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t LOOKUPS = 100000;
+constexpr std::size_t SOURCE_LINE_LOOKUPS = 1000;     // Each one scans the line tables of every unit
+constexpr std::size_t STEPS = 2000;
+constexpr std::size_t ROUND_TRIPS = 2000;
+
+// Silences std::cout while debugger commands run (they print the source at every stop)
+class Quiet {
+public:
+    Quiet() : _saved(std::cout.rdbuf(_null.rdbuf())) {}
+    ~Quiet() { std::cout.rdbuf(_saved); }
+
+private:
+    std::ofstream _null {"/dev/null"};
+    std::streambuf *_saved;
+};
+
+static double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Resident and peak resident set size of this process, in kB
+static void read_memory_usage(long& rss_kb, long& peak_kb) {
+    std::ifstream status {"/proc/self/status"};
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            rss_kb = std::stol(line.substr(6));
+        } else if (line.rfind("VmHWM:", 0) == 0) {
+            peak_kb = std::stol(line.substr(6));
+        }
+    }
+}
+
+// Mean and percentiles of a set of samples, as a JSON object
+static std::string summarise(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (auto sample : samples) {
+        sum += sample;
+    }
+    auto percentile = [&](double p) { return samples[std::min(samples.size() - 1, std::size_t(p * samples.size()))]; };
+    std::ostringstream out;
+    out << "{\"mean\": " << sum / samples.size() << ", \"p50\": " << percentile(0.5)
+        << ", \"p99\": " << percentile(0.99) << ", \"max\": " << samples.back() << "}";
+    return out.str();
+}
+
+// Average time of one call of op over n calls, in ns
+template <typename Op>
+static double time_per_op(std::size_t n, Op op) {
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < n; i++) {
+        op(i);
+    }
+    return elapsed_ms(start) * 1e6 / n;
+}
+
+// Build the DWARF index with an empty cache, then again from the cache that run wrote, and time lookups.
+// Caching goes to a temporary directory, so the user's cache is left alone
+static void bench_index(const std::string& prog, unsigned units, unsigned functions, std::ostream& json) {
+    char cache_dir[] = "/tmp/linux-debugger-bench-XXXXXX";
+    if (mkdtemp(cache_dir) == nullptr) {
+        throw std::runtime_error{"Could not create a cache directory"};
+    }
+    setenv("XDG_CACHE_HOME", cache_dir, 1);
+
+    long rss_before = 0, rss_after = 0, peak = 0;
+    read_memory_usage(rss_before, peak);
+
+    auto start = Clock::now();
+    DwarfContext ctx {prog};
+    auto open_ms = elapsed_ms(start);
+    ctx.get_function_by_name(function_name(units - 1, functions - 1));
+    auto first_query_ms = elapsed_ms(start);
+    ctx.prepare();
+    auto cold_ms = elapsed_ms(start);
+    read_memory_usage(rss_after, peak);
+    auto cold_status = to_string(ctx.get_index_cache_status());
+
+    start = Clock::now();
+    DwarfContext cached {prog};
+    auto warm_open_ms = elapsed_ms(start);
+    cached.prepare();
+    auto warm_ms = elapsed_ms(start);
+    auto warm_status = to_string(cached.get_index_cache_status());
+
+    // The same random functions for every kind of lookup
+    std::mt19937 rng {42};
+    std::vector<std::string> names;
+    std::vector<std::string> files;
+    std::vector<unsigned> lines;
+    for (std::size_t i = 0; i < LOOKUPS; i++) {
+        auto unit = rng() % units;
+        auto function = rng() % functions;
+        names.push_back(function_name(unit, function));
+        files.push_back(unit_file(unit));
+        lines.push_back(body_line(function));
+    }
+    std::vector<uint64_t> pcs;
+    for (auto& name : names) {
+        auto symbol = ctx.lookup_symbol(name);
+        pcs.push_back(symbol.empty() ? 0 : symbol.begin()->addr + 4);
+    }
+
+    auto symbol_ns = time_per_op(LOOKUPS, [&](std::size_t i) { ctx.lookup_symbol(names[i]); });
+    auto function_ns = time_per_op(LOOKUPS, [&](std::size_t i) { ctx.get_function_by_name(names[i]); });
+    auto line_ns = time_per_op(LOOKUPS, [&](std::size_t i) { ctx.get_line_from_pc(pcs[i]); });
+    auto enclosing_ns = time_per_op(LOOKUPS, [&](std::size_t i) { ctx.get_function_range_from_pc(pcs[i]); });
+    auto source_line_ns = time_per_op(SOURCE_LINE_LOOKUPS,
+                                      [&](std::size_t i) { ctx.get_source_line(files[i], lines[i]); });
+    auto cached_function_ns = time_per_op(LOOKUPS, [&](std::size_t i) { cached.get_function_by_name(names[i]); });
+    auto cached_line_ns = time_per_op(LOOKUPS, [&](std::size_t i) { cached.get_line_from_pc(pcs[i]); });
+
+    json << "  \"index\": {\"open_ms\": " << open_ms << ", \"first_query_ms\": " << first_query_ms
+         << ", \"cold_ms\": " << cold_ms << ", \"cold_cache\": \"" << cold_status << "\""
+         << ", \"warm_open_ms\": " << warm_open_ms << ", \"warm_ms\": " << warm_ms
+         << ", \"warm_cache\": \"" << warm_status << "\"},\n";
+    json << "  \"memory_kb\": {\"index_rss\": " << rss_after - rss_before << ", \"peak_rss\": " << peak << "},\n";
+    json << "  \"lookup_ns\": {\"symbol\": " << symbol_ns << ", \"function_by_name\": " << function_ns
+         << ", \"line_from_pc\": " << line_ns << ", \"function_from_pc\": " << enclosing_ns
+         << ", \"source_line\": " << source_line_ns << ", \"cached_function_by_name\": " << cached_function_ns
+         << ", \"cached_line_from_pc\": " << cached_line_ns << "},\n";
+
+    unlink(ctx.get_index_cache_path().c_str());
+    auto dir = std::string{cache_dir} + "/linux-debugger";
+    rmdir(dir.c_str());
+    rmdir(cache_dir);
+    unsetenv("XDG_CACHE_HOME");
+}
+
+// Launch the program under the debugger, then time stepping in bench_step and breakpoint hits in bench_hit
+static void bench_process(const std::string& prog, std::ostream& json) {
+    auto start = Clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        Debugger::launch_process(prog.c_str(), pid);
+        _exit(EXIT_FAILURE);
+    }
+
+    Debugger debugger {prog, pid};
+    Quiet quiet;
+    debugger.start();
+    auto launch_ms = elapsed_ms(start);
+
+    debugger.handle("break bench_step");
+    debugger.handle("continue");
+
+    auto steps_per_sec = [&](const std::string& cmd) {
+        auto steps_start = Clock::now();
+        for (std::size_t i = 0; i < STEPS; i++) {
+            debugger.handle(cmd);
+        }
+        return STEPS * 1000 / elapsed_ms(steps_start);
+    };
+    auto stepi = steps_per_sec("stepi");
+    auto stepl = steps_per_sec("stepl");
+    auto next = steps_per_sec("next");
+
+    debugger.handle("break bench_hit");
+    debugger.handle("continue");
+    std::vector<double> round_trips;
+    for (std::size_t i = 0; i < ROUND_TRIPS; i++) {
+        auto hit_start = Clock::now();
+        debugger.handle("continue");
+        round_trips.push_back(elapsed_ms(hit_start) * 1000);
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, __WALL);
+
+    json << "  \"launch_ms\": " << launch_ms << ",\n";
+    json << "  \"steps_per_sec\": {\"stepi\": " << stepi << ", \"stepl\": " << stepl << ", \"next\": " << next << "},\n";
+    json << "  \"breakpoint_round_trip_us\": " << summarise(round_trips) << "\n";
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: Benchmark <program> <units> <functions-per-unit> [results.json]\n";
+        return EXIT_FAILURE;
+    }
+    std::string prog = argv[1];
+    auto units = static_cast<unsigned>(std::stoul(argv[2]));
+    auto functions = static_cast<unsigned>(std::stoul(argv[3]));
+
+    std::ostringstream json;
+    json << "{\n  \"program\": {\"path\": \"" << prog << "\", \"units\": " << units
+         << ", \"functions_per_unit\": " << functions << "},\n";
+    try {
+        bench_index(prog, units, functions, json);
+        bench_process(prog, json);
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    json << "}\n";
+
+    std::cout << json.str();
+    if (argc > 4) {
+        std::ofstream {argv[4]} << json.str();
+    }
+    return EXIT_SUCCESS;
+}
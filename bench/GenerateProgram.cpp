@@ -0,0 +1,75 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <sys/stat.h>
+#include <fstream>
+#include <iostream>
+#include "SyntheticProgram.h"
+
+using namespace SyntheticProgram;
+
+// Write one unit: `functions` small functions with a branch each, so that stepping has lines to go through
+static void write_unit(const std::string& dir, unsigned unit, unsigned functions) {
+    std::ofstream out {dir + "/" + unit_file(unit)};
+    out << "// Generated by GenerateProgram, do not edit\n";
+    for (unsigned k = 0; k < functions; k++) {
+        out << "int " << function_name(unit, k) << "(int x) {\n"
+            << "    int y = x * " << k + 1 << ";\n"
+            << "    y += " << unit << ";\n"
+            << "    if (y & 1) {\n"
+            << "        y = y * 3 + 1;\n"
+            << "    }\n"
+            << "    return y;\n"
+            << "}\n";
+    }
+}
+
+// Write main.c: bench_step calls the first function of STEP_UNITS units spread over the program
+static void write_main(const std::string& dir, unsigned units) {
+    std::ofstream out {dir + "/main.c"};
+    out << "// Generated by GenerateProgram, do not edit\n";
+    for (unsigned i = 0; i < STEP_UNITS; i++) {
+        out << "int " << function_name(i * units / STEP_UNITS, 0) << "(int x);\n";
+    }
+    out << "\nvolatile int sink;\n\n"
+        << "int bench_hit(int i) {\n"
+        << "    return i + 1;\n"
+        << "}\n\n"
+        << "int bench_step(int n) {\n"
+        << "    int acc = 0;\n"
+        << "    for (int i = 0; i < n; i++) {\n";
+    for (unsigned i = 0; i < STEP_UNITS; i++) {
+        out << "        acc += " << function_name(i * units / STEP_UNITS, 0) << "(i);\n";
+    }
+    out << "    }\n"
+        << "    return acc;\n"
+        << "}\n\n"
+        << "int main(void) {\n"
+        << "    sink = bench_step(" << STEP_ITERATIONS << ");\n"
+        << "    for (;;) {\n"
+        << "        sink = bench_hit(sink);\n"
+        << "    }\n"
+        << "}\n";
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: GenerateProgram <dir> <units> <functions-per-unit>\n";
+        return EXIT_FAILURE;
+    }
+    std::string dir = argv[1];
+    auto units = static_cast<unsigned>(std::stoul(argv[2]));
+    auto functions = static_cast<unsigned>(std::stoul(argv[3]));
+    if (units < STEP_UNITS || functions == 0) {
+        std::cerr << "Need at least " << STEP_UNITS << " units and one function per unit\n";
+        return EXIT_FAILURE;
+    }
+
+    mkdir(dir.c_str(), 0755);
+    for (unsigned unit = 0; unit < units; unit++) {
+        write_unit(dir, unit, functions);
+    }
+    write_main(dir, units);
+    return EXIT_SUCCESS;
+}
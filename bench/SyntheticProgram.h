@@ -0,0 +1,35 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef SYNTHETICPROGRAM_H
+#define SYNTHETICPROGRAM_H
+
+#include <string>
+
+// Layout of the generated benchmark program, shared by the generator and the benchmarks.
+// Each unit<u>.c holds functions f<u>_<k> of LINES_PER_FUNCTION lines each. main.c runs bench_step, whose loop
+// calls into STEP_UNITS units spread over the program (the stepping benchmarks run in there), then calls
+// bench_hit forever (the breakpoint benchmarks stop there).
+namespace SyntheticProgram {
+    constexpr unsigned LINES_PER_FUNCTION = 8;
+    constexpr unsigned FIRST_FUNCTION_LINE = 2;     // After the "generated" comment
+    constexpr unsigned STEP_UNITS = 8;
+    constexpr unsigned STEP_ITERATIONS = 1000000;
+
+    inline std::string function_name(unsigned unit, unsigned function) {
+        return "f" + std::to_string(unit) + "_" + std::to_string(function);
+    }
+
+    inline std::string unit_file(unsigned unit) {
+        return "unit" + std::to_string(unit) + ".c";
+    }
+
+    // The first statement of a function
+    inline unsigned body_line(unsigned function) {
+        return FIRST_FUNCTION_LINE + function * LINES_PER_FUNCTION + 1;
+    }
+}
+
+
+#endif //SYNTHETICPROGRAM_H
@@ -0,0 +1,78 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef ACCELERATORINDEX_H
+#define ACCELERATORINDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "elf/elf++.hh"
+
+// The lookup tables that compilers and linkers can add for debuggers: .debug_aranges or the address area of
+// .gdb_index (address -> CU), and .gdb_index or .debug_names (function name -> CUs).
+// They are read in place from the mapped sections, so building this costs one pass over the address table.
+// Units are identified by the offset of their header in .debug_info.
+class AcceleratorIndex {
+public:
+    void build(const elf::elf& elf);
+
+    // Offset of the unit covering pc (false if no table covers it)
+    bool find_unit(uint64_t pc, uint64_t& unit_offset) const;
+    // The address table lists the ranges of this unit (if it does for every unit, an address it does not cover
+    // belongs to no unit)
+    bool covers_unit(uint64_t unit_offset) const;
+
+    bool has_names() const { return _gdb_index != nullptr || !_name_tables.empty(); }
+    // Offsets of the units defining a function (only meaningful if has_names())
+    void find_units(std::string_view name, std::vector<uint64_t>& unit_offsets) const;
+
+private:
+    struct AddressRange {
+        uint64_t low;
+        uint64_t high;
+        uint64_t unit;
+    };
+
+    // One name table of .debug_names (there is one per unit unless the linker merged them)
+    struct NameTable {
+        struct Abbrev {
+            uint64_t code;
+            uint64_t tag;
+            std::vector<std::pair<uint64_t, uint64_t>> attrs;   // (DW_IDX_*, DW_FORM_*)
+        };
+
+        const uint8_t *units;           // Unit offsets (4 bytes each)
+        uint32_t num_units;
+        const uint8_t *buckets;
+        uint32_t num_buckets;
+        const uint8_t *hashes;
+        const uint8_t *string_offsets;  // Into .debug_str
+        const uint8_t *entry_offsets;   // Into the entry pool
+        uint32_t num_names;
+        const uint8_t *entry_pool;
+        const uint8_t *end;
+        std::vector<Abbrev> abbrevs;
+    };
+
+    std::vector<AddressRange> _ranges;  // Sorted by low address
+    std::vector<uint64_t> _range_units; // Sorted, unique
+
+    const uint8_t *_gdb_index = nullptr;
+    std::size_t _gdb_index_size = 0;
+    std::vector<NameTable> _name_tables;
+    const char *_str = nullptr;         // .debug_str, for the names of .debug_names
+    std::size_t _str_size = 0;
+
+    void read_aranges(const elf::section& section);
+    void read_gdb_index(const elf::section& section);
+    void read_debug_names(const elf::section& section);
+    void find_units_gdb_index(std::string_view name, std::vector<uint64_t>& unit_offsets) const;
+    void find_units_debug_names(const NameTable& table, std::string_view name,
+                                std::vector<uint64_t>& unit_offsets) const;
+};
+
+
+#endif //ACCELERATORINDEX_H
@@ -0,0 +1,96 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef ADDRESSINDEX_H
+#define ADDRESSINDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dwarf/dwarf++.hh"
+#include "elf/elf++.hh"
+#include "IndexCache.h"
+
+// Sorted interval tables for PC -> line and PC -> function queries, plus function name and source line lookups.
+// There is one shard per compilation unit. build() returns straight away: the threads of the WorkerPool (shared
+// with the indexes of the other modules) index the units in the background, and a query only waits for the unit(s)
+// it needs, which it indexes itself if no thread has got to them yet. The unit of an address or function name comes from the accelerator tables (.debug_aranges,
+// .gdb_index, .debug_names) if the program has them; otherwise from the line sequences of all units, which
+// needs every unit to be indexed first.
+// Once every unit is indexed, the tables are saved to an IndexCache; the next session on the same binary maps them
+// from there without reading any DWARF (only the DIEs of a unit are read again, the first time one is asked for).
+class AddressIndex {
+public:
+    // One row of a line table, covering [low, high)
+    struct LineRange {
+        uint64_t low;
+        uint64_t high;
+        uint32_t line;
+        uint32_t file : 31;     // Index into the file path table
+        uint32_t is_stmt : 1;
+    };
+
+    // One contiguous address range of a subprogram, covering [low, high)
+    struct FunctionRange {
+        uint64_t low;
+        uint64_t high;
+        uint32_t die;           // Index into the (cold) DIE table of its unit
+        uint32_t cu;
+    };
+
+    AddressIndex();
+    ~AddressIndex();
+    AddressIndex(AddressIndex&&) noexcept;
+    AddressIndex& operator=(AddressIndex&&) noexcept;
+
+    void build(const dwarf::dwarf& dw, const elf::elf& elf);
+    bool is_built() const { return _state != nullptr; }
+    // Block until every unit is indexed
+    void wait() const;
+
+    // Point queries (nullptr if the address is not covered)
+    const LineRange* find_line(uint64_t pc) const;
+    const FunctionRange* find_function(uint64_t pc) const;
+
+    // All line rows of the unit of low starting within [low, high), in address order
+    std::pair<const LineRange*, const LineRange*> lines_in(uint64_t low, uint64_t high) const;
+
+    // The line rows of every unit, one range per unit in address order
+    std::vector<std::pair<const LineRange*, const LineRange*>> all_lines() const;
+
+    // Row following the given one in address order within its unit (nullptr at the end of the table)
+    const LineRange* next_line(const LineRange* entry) const;
+
+    // Entry address of a function defined in the program (false if there is none)
+    bool find_function_by_name(const std::string& name, uint64_t& addr) const;
+    // Address of the first statement of a line in a source file (matched by suffix)
+    bool find_source_line(const std::string& file, unsigned line, uint64_t& addr) const;
+
+    const std::string& file_path(const LineRange& entry) const;
+    const dwarf::die& function_die(const FunctionRange& entry) const;
+
+    IndexCache::Status get_cache_status() const;
+    const std::string& get_cache_path() const;
+
+private:
+    struct Unit;
+    struct State;
+    std::unique_ptr<State> _state;
+
+    // The workers only see the state, which stays put when the index is moved
+    static bool claim(State& state, Unit& u);
+    static Unit& ensure(State& state, std::size_t unit);
+    static bool unit_has_file(State& state, std::size_t unit, const std::string& file);
+    static void index_unit(State& state, std::size_t unit);
+    static void run_worker(State& state);
+    static void finish(State& state);
+    static bool load_cache(State& state);
+    static void save_cache(State& state);
+    const Unit* unit_for(uint64_t pc) const;
+};
+
+
+#endif //ADDRESSINDEX_H
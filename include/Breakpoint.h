@@ -8,26 +8,92 @@
 
 #include <csignal>
 #include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Condition.h"
+#include "ProcessMemory.h"
 
 // int 3 interrupt for x86 (triggers SIGTRAP)
 const std::uintptr_t BREAKPOINT_INT3 = 0xcc;
 
+constexpr std::uintptr_t PAGE_SIZE_BITS = 12;
+
+// Plant int3s at (or put back the saved bytes of) items sorted by address, with one read and one write per page
+// touched. addr(item) is its address, saved(item) and patched(item) refer to its saved byte and whether its int3
+// is in memory (set once the page is written)
+template <typename T, typename Addr, typename Saved, typename Patched>
+void patch_int3s(ProcessMemory& memory, const std::vector<T*>& items, bool plant, Addr addr, Saved saved,
+                 Patched patched) {
+    uint8_t buf[1 << PAGE_SIZE_BITS];
+    for (std::size_t first = 0; first < items.size();) {
+        auto page = addr(items[first]) >> PAGE_SIZE_BITS;
+        auto last = first + 1;
+        while (last < items.size() && (addr(items[last]) >> PAGE_SIZE_BITS) == page) {
+            last++;
+        }
+
+        auto start = addr(items[first]);
+        auto len = addr(items[last - 1]) - start + 1;
+        if (memory.read(start, buf, len) == len) {
+            for (auto i = first; i < last; i++) {
+                auto& byte = buf[addr(items[i]) - start];
+                if (plant) {
+                    saved(items[i]) = byte;
+                    byte = BREAKPOINT_INT3;
+                } else {
+                    byte = saved(items[i]);
+                }
+            }
+            if (memory.write_forced(start, buf, len) == len) {
+                for (auto i = first; i < last; i++) {
+                    patched(items[i]) = plant;
+                }
+            }
+        }
+        first = last;
+    }
+}
+
 class Breakpoint {
 public:
     Breakpoint() = default;
     Breakpoint(pid_t pid, std::uintptr_t addr) : _pid{pid}, _addr{addr} {};
 
-    void enable();
-    void disable();
+    void enable(ProcessMemory& memory);
+    void disable(ProcessMemory& memory);
+
+    // Enable/disable a group of breakpoints with one read and one write per page touched
+    static void enable_all(ProcessMemory& memory, std::vector<Breakpoint*>& bps);
+    static void disable_all(ProcessMemory& memory, std::vector<Breakpoint*>& bps);
 
     bool is_enabled() const { return _enabled; }
     std::uintptr_t get_address() const { return _addr; }
+    uint8_t get_saved_byte() const { return _saved_byte; }
+
+    // Conditions and ignore counts, checked on every hit before dropping back to the user
+    void set_condition(std::shared_ptr<const Condition> condition) { _condition = std::move(condition); }
+    void set_ignore_count(uint64_t count) { _ignore_count = count; }
+    bool should_stop(const user_regs_struct& regs, ProcessMemory& memory);
+
+    const Condition* get_condition() const { return _condition.get(); }
+    uint64_t get_hit_count() const { return _hit_count; }
+    uint64_t get_eval_count() const { return _eval_count; }
+    uint64_t get_eval_ns() const { return _eval_ns; }
 
 private:
     pid_t _pid{};
     std::uintptr_t _addr{};
     bool _enabled = false;
     uint8_t _saved_byte{};    // Byte of data that used to be at the breakpoint address before replacing with interrupt
+
+    std::shared_ptr<const Condition> _condition;
+    uint64_t _ignore_count = 0;
+    uint64_t _hit_count = 0;
+    uint64_t _eval_count = 0;
+    uint64_t _eval_ns = 0;     // Total time spent evaluating the condition
+
+    static void patch_all(ProcessMemory& memory, std::vector<Breakpoint*>& bps, bool enable);
 };
 
 
@@ -0,0 +1,50 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef CONDITION_H
+#define CONDITION_H
+
+#include <sys/user.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ProcessMemory.h"
+
+// Breakpoint condition, compiled once into a compact stack bytecode over registers and memory.
+// Syntax is a subset of C expressions on 64 bit integers:
+//   operands   123, 0x7b, $rax (or rax), *expr (reads 8 bytes at the absolute address expr)
+//   operators  ! ~ - (unary), * / %, + -, << >>, < <= > >=, == !=, &, ^, |, &&, ||, ( )
+// Evaluation uses a fixed-size stack and never allocates, so it is cheap enough to run on every hit.
+class Condition {
+public:
+    static Condition compile(const std::string& source);
+
+    uint64_t evaluate(const user_regs_struct& regs, ProcessMemory& memory) const;
+    const std::string& get_source() const { return _source; }
+
+private:
+    enum class Op : uint8_t {
+        Const, Reg, Deref,
+        Neg, Not, BitNot,
+        Mul, Div, Mod, Add, Sub, Shl, Shr,
+        Lt, Le, Gt, Ge, Eq, Ne,
+        BitAnd, BitXor, BitOr, And, Or,
+    };
+
+    struct Instr {
+        Op op;
+        uint64_t imm;   // Constant value or register index
+    };
+
+    static const std::size_t MAX_STACK = 32;
+
+    std::string _source;
+    std::vector<Instr> _code;
+
+    struct Parser;
+};
+
+
+#endif //CONDITION_H
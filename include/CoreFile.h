@@ -0,0 +1,76 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef COREFILE_H
+#define COREFILE_H
+
+#include <sys/types.h>
+#include <sys/user.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ProcessMemory.h"
+
+// ELF core files: written from a stopped process (gcore), and opened read-only for post-mortem debugging.
+// Memory is copied a few MB at a time with bulk reads and all-zero pages are left as holes in a sparse file,
+// so dumping a large, mostly untouched heap costs little more than the pages actually in use.
+// A loaded core is mapped into memory and read in place.
+class CoreFile {
+public:
+    struct ThreadState {
+        pid_t tid;
+        int signal;     // Signal the thread stopped with (0 if none)
+        user_regs_struct regs;
+    };
+
+    // A file mapping of the process (from the NT_FILE note)
+    struct Mapping {
+        uint64_t start;
+        uint64_t end;
+        uint64_t offset;
+        std::string path;
+    };
+
+    // Write a core of a stopped process (the thread that stopped it goes first), returning the number of bytes of
+    // memory written; the rest of the address space is holes
+    static uint64_t dump(pid_t pid, ProcessMemory& memory, const std::vector<ThreadState>& threads,
+                            const std::string& path);
+
+    explicit CoreFile(const std::string& path);
+    ~CoreFile();
+
+    CoreFile(const CoreFile&) = delete;
+    CoreFile& operator=(const CoreFile&) = delete;
+
+    // Returns the number of bytes read (less than len if part of the range was not in the process)
+    std::size_t read(uint64_t addr, void *buf, std::size_t len) const;
+
+    const std::vector<ThreadState>& get_threads() const { return _threads; }
+    pid_t get_pid() const { return _pid; }
+    std::string get_exe_path() const;
+    uint64_t get_load_addr() const;
+
+private:
+    struct Segment {
+        uint64_t vaddr;
+        uint64_t memsz;
+        uint64_t filesz;
+        uint64_t offset;
+    };
+
+    const uint8_t *_data = nullptr;
+    std::size_t _size = 0;
+    std::vector<Segment> _segments;     // Sorted by address
+    std::vector<ThreadState> _threads;
+    std::vector<Mapping> _mappings;
+    pid_t _pid = 0;
+    uint64_t _phdr = 0;                 // AT_PHDR: where the program headers of the executable were mapped
+
+    void parse_notes(const uint8_t *notes, std::size_t len);
+    const Mapping* get_exe_mapping() const;
+};
+
+
+#endif //COREFILE_H
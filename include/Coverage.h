@@ -0,0 +1,67 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DwarfContext.h"
+#include "ProcessMemory.h"
+
+// Line coverage without rebuilding the program: an int3 is planted at every statement in the line tables of the
+// program, and removed for good the first time it is hit (the thread then goes on as if it had never been there).
+// A run costs about one trap per line reached, however often the line runs afterwards, so the counts are 0 or 1.
+// Statements are kept sorted by address, so a hit is a binary search and a one byte write, without allocating.
+class Coverage {
+public:
+    bool is_running() const { return _running; }
+    const std::string& get_path() const { return _path; }
+
+    // Plant the int3s, a page at a time. has_breakpoint tells the (absolute) addresses where a breakpoint of ours
+    // is already: these are left alone, and counted as hit when it is
+    void start(const std::string& path, const DwarfContext& ctx, uint64_t load_addr, ProcessMemory& memory,
+               const std::function<bool(uint64_t)>& has_breakpoint);
+    // Put back the bytes of every int3 not hit yet (the results are kept until the next start)
+    void stop(ProcessMemory& memory);
+    // Forget the int3s without touching memory (the process has gone, or was replaced)
+    void abandon() { _running = false; }
+
+    // Called for every breakpoint trap (addr is the int3). If addr is a statement, marks it as hit and removes
+    // its int3; returns true if the trap came from it
+    bool hit(uint64_t addr, ProcessMemory& memory);
+    // A breakpoint is set at addr: put back the original byte first. Once removed, put_back plants the int3
+    // again if the statement has not been hit meanwhile
+    void take(uint64_t addr, ProcessMemory& memory);
+    void put_back(uint64_t addr, ProcessMemory& memory);
+
+    std::size_t get_planted() const { return _planted; }     // By the last start
+
+    // Writes the results as an lcov tracefile, and a summary to out
+    void report(const DwarfContext& ctx, std::ostream& lcov, std::ostream& out) const;
+
+private:
+    struct Statement {
+        uint64_t addr;                          // Absolute
+        const DwarfContext::LineEntry *row;     // Of the line table, for the file and line
+        uint8_t saved_byte = 0;
+        bool planted = false;                   // Our int3 is in memory (only on the first row of an address)
+        bool hit = false;
+    };
+
+    std::vector<Statement> _statements;     // Sorted by address
+    std::string _path;
+    bool _running = false;
+    std::size_t _planted = 0;
+
+    std::pair<Statement*, Statement*> find(uint64_t addr);
+    static void patch_all(ProcessMemory& memory, std::vector<Statement*>& statements, bool plant);
+};
+
+
+#endif //COVERAGE_H
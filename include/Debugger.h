@@ -5,34 +5,76 @@
 #ifndef DEBUGGER_H
 #define DEBUGGER_H
 
+#include <deque>
+#include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
 #include "Breakpoint.h"
+#include "CoreFile.h"
+#include "Coverage.h"
 #include "DwarfContext.h"
+#include "HardwareBreakpoints.h"
+#include "ModuleMap.h"
+#include "ProcessMemory.h"
+#include "Registers.h"
+#include "SyscallFilter.h"
+#include "Thread.h"
+#include "Tracepoints.h"
 
 
 class Debugger {
+    friend class GdbServer;
+
 public:
     Debugger (const std::string& prog_name, pid_t pid) {
         _prog_name = prog_name;
         _pid = pid;
         _abs_load_addr = UINTPTR_MAX;
         _dwarf_ctx = DwarfContext{_prog_name};
+        _memory.reset(pid);
+        _hw_breakpoints.reset(pid);
+        _thread = &_threads.emplace(pid, pid).first->second;
+        _thread->started = true;
     }
+    Debugger (std::unique_ptr<CoreFile> core, const std::string& prog_name);
 
-    static void launch_process(const char *prog_name, pid_t pid);
+    static void launch_process(const char *prog_name, pid_t pid, const std::vector<long>& syscalls = {});
+    static std::string read_exe_path(pid_t pid);
 
     // Debugger API
+    void attach();
+    void detach();
+    void start();
     void run();
+    void handle(const std::string& cmd);   // Run one command line, as typed at the prompt
     void set_breakpoint(std::uintptr_t addr, bool print = true);
     void remove_breakpoint(uintptr_t addr, bool print = true);
     void disable_breakpoint(uintptr_t addr, bool print = true);
+    void set_breakpoint_condition(std::uintptr_t addr, const std::string& condition);
+    void set_ignore_count(std::uintptr_t addr, uint64_t count);
+    void set_breakpoints(const std::vector<std::uintptr_t>& addrs);
+    void remove_breakpoints(const std::vector<std::uintptr_t>& addrs);
     void set_breakpoint_at_function(const std::string& name);
     void set_breakpoint_at_source_line(const std::string& filename, uint line);
+    void set_hw_breakpoint(std::uintptr_t addr);
+    void set_watchpoint(std::uintptr_t addr, std::size_t len, HardwareBreakpoints::Type type);
+    void remove_hw_breakpoint(int slot);
+    void set_tracepoint(std::uintptr_t addr);
+    void start_coverage(const std::string& path);
+    void stop_coverage();
     void continue_execution();
+    void filter_syscalls(const std::vector<long>& nrs);     // Those the launched process filters (before start)
+
+    void profile(double seconds, unsigned hz, const std::string& out_path);
+    void generate_core(const std::string& path);
+    void checkpoint();
+    void restart(unsigned id);
 
-    void print_registers() const;
+    void print_registers();
+    void print_backtrace();
+    void print_variable(const std::string& expression);
     void print_source_lines(uint64_t addr, uint line_win_size=0);
 
 private:
@@ -41,35 +83,118 @@ private:
     std::unordered_map<std::uintptr_t, Breakpoint> _breakpoints;
     std::uintptr_t _abs_load_addr;
     DwarfContext _dwarf_ctx;
-
-    // Read/write memory (via ptrace)
-    uint64_t read_memory(uint64_t addr) const;
-    uint64_t write_memory(uint64_t addr, uint8_t val) const;
+    ProcessMemory _memory;
+    std::unordered_map<pid_t, Thread> _threads;
+    Thread* _thread;                // Current thread (the one that reported the last stop, or chosen with 'thread')
+    std::deque<pid_t> _pending;     // Threads holding a wait status collected while stopping all threads
+    bool _resumed_all = false;      // All threads were resumed (otherwise only the current thread is being stepped)
+    StackSnapshot _stack;           // Reused for every unwind
+    bool _seized = false;           // Attached with PTRACE_SEIZE (threads are stopped with PTRACE_INTERRUPT, not SIGSTOP)
+    bool _exit_on_finish = true;    // Exit when the process does (otherwise _exited is set and the stop reported)
+    bool _exited = false;
+    int _exit_status = 0;
+    int _stop_signal = SIGTRAP;     // Signal of the last reported stop
+    int _stop_hw_slot = -1;         // Hardware breakpoint or watchpoint behind the last reported SIGTRAP, if any
+    HardwareBreakpoints _hw_breakpoints;
+    bool _block_step = true;    // Cleared if the kernel or CPU does not support PTRACE_SINGLEBLOCK
+    bool _stepping = false;     // Temporary breakpoints of the stepping engine are hit silently
+    std::uintptr_t _last_breakpoint = UINTPTR_MAX;
+    std::unique_ptr<CoreFile> _core;    // Set when debugging a core file instead of a live process
+    ModuleMap _modules;                 // Shared libraries
+    std::uintptr_t _debug_state_bp = UINTPTR_MAX;  // Breakpoint on _dl_debug_state, hit when libraries change
+    bool _report_debug_state = false;   // Report hits of it too (a GDB client tracks libraries itself)
+    SyscallFilter _syscalls;            // System calls that stop the process (empty unless launched with a filter)
+    std::map<pid_t, bool> _forks;       // Children that inherited the filter, by whether their first stop was seen
+    Tracepoints _tracepoints;
+    Coverage _coverage;                 // One-shot breakpoints of 'coverage run'
+
+    // A forked copy of the process, kept stopped so that it can be gone back to
+    struct Checkpoint {
+        pid_t pid;
+        uint64_t pc;
+        std::vector<std::pair<std::uintptr_t, uint8_t>> breakpoints;    // Inserted at the time, with the bytes they replaced
+        bool tracepoints;   // The tracepoint area was mapped at the time
+    };
+    std::map<unsigned, Checkpoint> _checkpoints;
+    unsigned _next_checkpoint = 1;
+
+    // Read/write memory (relative addresses)
+    uint64_t read_memory(uint64_t addr);
+    void write_memory(uint64_t addr, uint64_t val);
+    void dump_memory(uint64_t addr, std::size_t len);
 
     // Stepping TODO: move stepping commands to public API functions
-    uint64_t get_pc() const;
-    void set_pc(uint64_t pc) const;
+    uint64_t get_pc();
+    void set_pc(uint64_t pc);
+    long resume(__ptrace_request request);
+    long resume_thread(Thread& thread, __ptrace_request request);
+    void resume_all();
+    void stop_all_threads();
+    void step_over_breakpoint(Thread& thread);
     void single_step();
     void single_step_instruction();
+    void step_block(bool block);
+    void run_to(std::uintptr_t addr);
+
+    std::size_t unwind(Thread& thread, Unwinder::Frame *frames, std::size_t max, std::size_t snapshot_size);
 
     // Source level stepping
     void step_out();
-    void step_in();
+    void step_in(bool count_instructions = false);
+    bool is_local_line(const DwarfContext::FunctionEntry& func,
+                       std::pair<const DwarfContext::LineEntry*, const DwarfContext::LineEntry*> lines, uint32_t line);
     void step_over();
 
     // Command handlers
-    void handle(const std::string& cmd);
     void set_breakpoint_cmd(const std::string &address);
+    std::uintptr_t resolve_location(const std::string& location);
+
+    // Profiling
+    std::size_t sample_stack(Thread& thread, uint64_t *pcs);
+    std::string get_frame_name(uint64_t pc);
+
+    // Shared libraries
+    void init_modules();
+    void watch_modules(uint64_t debug_state);
+    DwarfContext* get_context(uint64_t pc, uint64_t& load_addr);
+    void print_modules();
+    void print_index_status();
+
+    // Checkpoints
+    pid_t inject_fork(pid_t tid, ProcessMemory& memory, long options, int& signal);
+    void print_checkpoints();
+    void delete_checkpoint(unsigned id);
+    bool handle_checkpoint_event(pid_t pid, int status);
+    void kill_process();
+    long trace_options() const;
+    long inject_syscall(Thread& thread, long nr, std::initializer_list<uint64_t> args);
+
+    // Tracepoints
+    void map_tracepoint_area(uint64_t near);
+
+    // Coverage
+    void write_coverage();
+
+    // System calls
+    bool handle_syscall(Thread& thread, bool entry);
+    bool handle_fork_event(pid_t pid, int status);
+    void set_syscall_flags(const std::vector<std::string>& args, bool caught);
+
+    // Threads
+    void print_threads();
+    void select_thread(pid_t tid);
 
     // Other helpers
     void wait_for_signal();
-    void handle_sigtrap(siginfo_t info);
+    bool handle_next_event(bool block, bool& reported);
+    bool handle_event(Thread& thread, int status);
+    bool handle_sigtrap(siginfo_t info);
+    Thread& add_thread(pid_t tid);
+    bool swallow_stop(Thread& thread, int status);
     static uintptr_t read_abs_load_addr(pid_t pid);
     void init_abs_load_addr_on_launch();
     uint64_t get_offset_pc();
 
 };
 
-#define RET_ADDR_FRAME_OFFSET (8)
-
 #endif //DEBUGGER_H
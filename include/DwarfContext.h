@@ -9,6 +9,11 @@
 
 #include "dwarf/dwarf++.hh"
 #include "elf/elf++.hh"
+#include "AddressIndex.h"
+#include "SymbolIndex.h"
+#include "SourceCache.h"
+#include "TypeCache.h"
+#include "Unwinder.h"
 
 class DwarfContext {
 public:
@@ -17,37 +22,66 @@ public:
     explicit DwarfContext(const std::string& prog_name) {
         auto fd = open(prog_name.c_str(), O_RDONLY);
         _elf = elf::elf{elf::create_mmap_loader(fd)};
-        _dwarf = dwarf::dwarf{dwarf::elf::create_loader(_elf)};
+        // Shared libraries usually come without DWARF; their symbols and CFI are still useful
+        try {
+            _dwarf = dwarf::dwarf{dwarf::elf::create_loader(_elf)};
+            _addr_index.build(_dwarf, _elf);    // Indexes in the background
+        } catch (const dwarf::format_error&) {}
     }
 
+    bool has_dwarf() const { return _dwarf.valid(); }
+    IndexCache::Status get_index_cache_status() const { return _addr_index.get_cache_status(); }
+    const std::string& get_index_cache_path() const { return _addr_index.get_cache_path(); }
+
+    // Build the lazy indexes up front (e.g. before stopping a process we attach to)
+    void prepare() {
+        symbols();
+        _addr_index.wait();
+    }
+
+    using LineEntry = AddressIndex::LineRange;
+    using FunctionEntry = AddressIndex::FunctionRange;
+
     dwarf::die get_function_from_pc(uint64_t pc) const;
-    dwarf::line_table::iterator get_line_from_pc(uint64_t pc) const;
+    const FunctionEntry& get_function_range_from_pc(uint64_t pc) const;
+    const LineEntry& get_line_from_pc(uint64_t pc) const;
+    std::pair<const LineEntry*, const LineEntry*> get_lines_in(uint64_t low, uint64_t high) const;
+    std::vector<std::pair<const LineEntry*, const LineEntry*>> get_all_lines() const { return _addr_index.all_lines(); }
+    const std::string& get_file_name(const LineEntry& entry) const { return _addr_index.file_path(entry); }
     void print_source(const std::string& file, uint line, uint num_lines=2) const;
+    const Unwinder& get_unwinder();     // Built on first use
 
     uint64_t get_function_by_name(const std::string& name) const;
     uint64_t get_source_line(const std::string& filename, uint line);
     uint64_t get_func_entry(const dwarf::die &d);
     uint64_t get_func_end(const dwarf::die &d);
 
-    enum class SymbolType {
-        NoType,
-        Object,
-        Function,
-        Section,
-        File,
-    };
-
-    struct Symbol {
-        SymbolType type;
-        std::string name;
-        std::uint64_t addr;
-    };
+    using SymbolType = SymbolIndex::SymbolType;
+    using Symbol = SymbolIndex::Symbol;
+    using SymbolRange = SymbolIndex::SymbolRange;
+
     static SymbolType get_symbol_type(elf::stt symbol);
-    std::vector<Symbol> lookup_symbol(const std::string& name);
+    SymbolRange lookup_symbol(std::string_view name);
+    void lookup_symbol_glob(const std::string& pattern, std::vector<const Symbol*>& out);
+    const Symbol* lookup_symbol_by_address(uint64_t addr);
+
+    dwarf::die find_variable(uint64_t pc, const std::string& name) const;
+    bool get_location(const dwarf::die& d, dwarf::DW_AT attr, uint64_t pc, const uint8_t *&expr, std::size_t& len) const;
+    const TypeLayout& get_type_layout(const dwarf::die& variable) const;
 
 private:
     dwarf::dwarf _dwarf;
     elf::elf _elf;
+    AddressIndex _addr_index;
+    SymbolIndex _symbol_index;  // Built lazily, on the first symbol query
+    Unwinder _unwinder;
+    bool _unwinder_built = false;
+    mutable SourceCache _source_cache;
+    mutable TypeCache _types;   // Decoded as variables are printed
+
+    const SymbolIndex& symbols();
+    bool find_in_location_list(const dwarf::die& d, uint64_t offset, uint64_t pc,
+                               const uint8_t *&expr, std::size_t& len) const;
 };
 
 inline std::string to_string(DwarfContext::SymbolType st) {
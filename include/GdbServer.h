@@ -0,0 +1,59 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef GDBSERVER_H
+#define GDBSERVER_H
+
+#include <string>
+
+#include "Debugger.h"
+
+// GDB remote serial protocol stub over a TCP port (on localhost) or a unix socket, driving a Debugger.
+// Every packet that arrived in one read is answered before the replies are sent back together, so a client
+// that pipelines its requests pays one round trip for all of them. After QStartNoAckMode there are no acks either.
+class GdbServer {
+public:
+    explicit GdbServer(Debugger& debugger) : _debugger{debugger} {}
+    ~GdbServer();
+
+    // Serve one client until it detaches or kills the process, or the process exits
+    void serve(const std::string& address);
+
+private:
+    Debugger& _debugger;
+    int _listen_fd = -1;
+    int _fd = -1;
+    std::string _unix_path; // Removed again when done
+    int _signal_fd = -1;    // Readable when SIGCHLD is pending, so waiting can also watch the client for interrupts
+    bool _ack = true;
+    bool _done = false;
+    bool _interrupted = false;
+    std::string _in;        // Received bytes not consumed yet
+    std::string _out;       // Replies waiting to be sent
+
+    void listen_on(const std::string& address);
+    bool receive();
+    bool next_packet(std::string& packet);
+    void send_packet(const std::string& payload);
+    void flush();
+
+    void handle_packet(const std::string& packet);
+    void handle_query(const std::string& packet);
+    void handle_vcont(const std::string& packet);
+    void handle_breakpoint(const std::string& packet);
+    void resume(pid_t step_tid);
+    void wait_for_stop();
+    std::string stop_reply();
+
+    std::string read_registers();
+    void write_registers(const std::string& hex);
+    bool read_register(std::size_t regnum, std::string& out);
+    bool write_register(std::size_t regnum, const std::string& hex);
+    std::string read_memory(uint64_t addr, std::size_t len, bool binary);
+    bool write_memory(uint64_t addr, const std::string& data);
+    void xfer(const std::string& data, const std::string& offset_length);
+};
+
+
+#endif //GDBSERVER_H
@@ -0,0 +1,72 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef HARDWAREBREAKPOINTS_H
+#define HARDWAREBREAKPOINTS_H
+
+#include <array>
+#include <csignal>
+#include <cstdint>
+#include <vector>
+
+// Number of address debug registers (DR0-DR3) on x86
+const std::size_t NUM_HW_SLOTS = 4;
+
+// Hardware breakpoints and data watchpoints, programmed into the x86 debug registers with PTRACE_POKEUSER.
+// They do not modify text pages, and watchpoints trap on the exact access instead of requiring single stepping.
+// Debug registers are per thread, so every slot is programmed into every thread of the debuggee.
+class HardwareBreakpoints {
+public:
+    // Values of the DR7 R/W field (x86 cannot trap on reads only)
+    enum class Type {
+        Execute = 0b00,
+        Write = 0b01,
+        ReadWrite = 0b11,
+    };
+
+    struct Slot {
+        bool used = false;
+        std::uintptr_t addr{};
+        Type type{};
+        std::size_t len{};
+    };
+
+    HardwareBreakpoints() = default;
+    explicit HardwareBreakpoints(pid_t pid) : _tids{pid} {};
+
+    void reset(pid_t pid);
+    void retarget(pid_t pid);
+    void add_thread(pid_t tid);
+    void remove_thread(pid_t tid);
+
+    int set(std::uintptr_t addr, Type type, std::size_t len);
+    void remove(int slot);
+    void clear();
+    int find(std::uintptr_t addr, Type type) const;
+    const Slot& get_slot(int slot) const { return _slots[slot]; }
+
+    // Read and clear DR6 of a thread, returning the slot that triggered (-1 if none did)
+    int get_triggered(pid_t tid);
+
+private:
+    std::vector<pid_t> _tids;
+    std::array<Slot, NUM_HW_SLOTS> _slots{};
+
+    static uint64_t read_dr(pid_t tid, int idx);
+    static void write_dr(pid_t tid, int idx, uint64_t val);
+    void write_dr_all(int idx, uint64_t val) const;
+    uint64_t get_dr7() const;
+};
+
+inline const char* to_string(HardwareBreakpoints::Type type) {
+    switch (type) {
+        case HardwareBreakpoints::Type::Execute: return "execute";
+        case HardwareBreakpoints::Type::Write: return "write";
+        case HardwareBreakpoints::Type::ReadWrite: return "read/write";
+    }
+    return "";
+}
+
+
+#endif //HARDWAREBREAKPOINTS_H
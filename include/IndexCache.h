@@ -0,0 +1,97 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef INDEXCACHE_H
+#define INDEXCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "elf/elf++.hh"
+
+// A file of prebuilt index tables for one binary, under $XDG_CACHE_HOME/linux-debugger (or ~/.cache), named by
+// the binary's GNU build ID so a rebuilt binary never picks up a stale index.
+// The file is a header, a table of sections and the section contents (arrays of plain structs, 8 byte aligned).
+// A hit maps the file and the tables are used in place. The header is checked for the magic, format and index
+// versions, build ID and size, and the section table against the size, before anything is read from it; the caller
+// bounds-checks every index it follows. The checksum of the contents is written with the file but only checked
+// on demand (LINUX_DEBUGGER_VERIFY_CACHE set), as it would read the whole file on every hit. Files are written to a
+// temporary name and renamed into place, so concurrent sessions never see a partial file.
+class IndexCache {
+public:
+    enum class Status {
+        Disabled,   // No binary to cache an index for
+        NoBuildId,  // The binary has no (usable) build ID
+        NoCacheDir, // Neither $XDG_CACHE_HOME nor $HOME is set
+        Miss,       // No cached index yet
+        Stale,      // A cached index that could not be used (it is rebuilt)
+        Hit,
+    };
+
+    struct Section {
+        uint32_t id;
+        const void *data;
+        std::size_t size;
+    };
+
+    IndexCache() = default;
+    // Identify the binary; `kind` names the index and `version` its layout
+    IndexCache(const elf::elf& elf, const std::string& kind, uint32_t version);
+    ~IndexCache();
+
+    IndexCache(IndexCache&& other) noexcept;
+    IndexCache& operator=(IndexCache&& other) noexcept;
+
+    // Map the cached file and check its header (sets the status)
+    bool load();
+    // Check the contents against the checksum in the header (reads the whole file)
+    bool verify() const;
+    // Get a section as an array of T (false if it is missing or its size is not a multiple of T)
+    template <typename T>
+    bool get(uint32_t id, const T *&data, std::size_t& count) const {
+        const void *raw;
+        std::size_t size;
+        if (!get_raw(id, raw, size) || size % sizeof(T) != 0) {
+            return false;
+        }
+        data = static_cast<const T *>(raw);
+        count = size / sizeof(T);
+        return true;
+    }
+    // The contents did not check out: unmap the file so it is rewritten
+    void invalidate();
+
+    // Write the sections, replacing any cached file. Returns false if it could not be written
+    bool save(const std::vector<Section>& sections) const;
+
+    Status get_status() const { return _status; }
+    const std::string& get_path() const { return _path; }
+
+private:
+    Status _status = Status::Disabled;
+    std::string _path;
+    std::vector<uint8_t> _build_id;
+    uint32_t _version = 0;
+    const uint8_t *_data = nullptr;
+    std::size_t _size = 0;
+
+    bool get_raw(uint32_t id, const void *&data, std::size_t& size) const;
+    void unmap();
+};
+
+inline std::string to_string(IndexCache::Status status) {
+    switch (status) {
+        case IndexCache::Status::Disabled: return "disabled";
+        case IndexCache::Status::NoBuildId: return "no build ID";
+        case IndexCache::Status::NoCacheDir: return "no cache directory";
+        case IndexCache::Status::Miss: return "miss";
+        case IndexCache::Status::Stale: return "stale";
+        case IndexCache::Status::Hit: return "hit";
+    }
+    __builtin_unreachable();
+}
+
+
+#endif //INDEXCACHE_H
@@ -0,0 +1,65 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef MODULEMAP_H
+#define MODULEMAP_H
+
+#include <sys/types.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DwarfContext.h"
+#include "ProcessMemory.h"
+#include "SymbolIndex.h"
+
+// Shared objects loaded into the debuggee, read from the dynamic linker's r_debug/link_map list.
+// The dynamic linker calls _dl_debug_state after every change to the list (at startup, dlopen and dlclose), so
+// the debugger breaks there and calls update(). Modules are sorted by address, so finding the module of an
+// address is a binary search; the ELF, DWARF and CFI of a module are only loaded once a lookup lands in it.
+// Lookups by symbol name only need the symbol tables, which are kept apart so that searching every module
+// does not load the DWARF of each.
+// The main executable is not part of the map.
+class ModuleMap {
+public:
+    struct Module {
+        std::string path;
+        uint64_t low;           // Address range of its mappings
+        uint64_t high;
+        uint64_t load_addr;     // Added to the addresses in the file (l_addr)
+    };
+
+    // Find the dynamic linker of a process, returning the (absolute) address of _dl_debug_state to break on,
+    // or 0 if there is none (static executables)
+    uint64_t init(pid_t pid);
+
+    // Re-read the link_map list. Returns false if the list is being changed (it is read again on the next call)
+    bool update(pid_t pid, ProcessMemory& memory);
+
+    const Module* find(uint64_t addr) const;
+    const std::vector<Module>& get_modules() const { return _modules; }
+
+    // The DWARF, symbols and CFI of a module, loaded on first use (nullptr if the file cannot be read)
+    DwarfContext* get_context(const Module& module);
+    bool is_loaded(const Module& module) const;
+
+    // The .symtab/.dynsym of a file, loaded on first use (nullptr if the file cannot be read)
+    const SymbolIndex* get_symbols(const std::string& path);
+
+private:
+    struct SymbolFile {
+        elf::elf elf;           // Keeps the string tables the symbol names point into mapped
+        SymbolIndex index;
+    };
+
+    std::vector<Module> _modules;   // Sorted by address
+    std::unordered_map<std::string, std::unique_ptr<DwarfContext>> _contexts;  // By path, kept across dlclose
+    std::unordered_map<std::string, std::unique_ptr<SymbolFile>> _symbols;   // By path
+    uint64_t _r_debug = 0;          // Address of the dynamic linker's r_debug
+};
+
+
+#endif //MODULEMAP_H
@@ -0,0 +1,52 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdint>
+
+// Counts the user-space instructions a process retires, using a hardware performance counter.
+// Not every machine (or VM) exposes one, so callers must check is_available().
+class InstructionCounter {
+public:
+    explicit InstructionCounter(pid_t pid) {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        _fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0));
+    }
+
+    ~InstructionCounter() {
+        if (_fd != -1) {
+            close(_fd);
+        }
+    }
+
+    InstructionCounter(const InstructionCounter&) = delete;
+    InstructionCounter& operator=(const InstructionCounter&) = delete;
+
+    bool is_available() const { return _fd != -1; }
+
+    uint64_t read_count() const {
+        uint64_t count = 0;
+        if (_fd != -1 && read(_fd, &count, sizeof(count)) != sizeof(count)) {
+            count = 0;
+        }
+        return count;
+    }
+
+private:
+    int _fd = -1;
+};
+
+
+#endif //PERFCOUNTER_H
@@ -0,0 +1,48 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef PROCESSMEMORY_H
+#define PROCESSMEMORY_H
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+
+class CoreFile;
+
+// Bulk access to the memory of the debuggee (absolute addresses).
+// Transfers go through process_vm_readv/process_vm_writev, which move any amount of data in a single syscall.
+// These cannot write to read-only mappings (e.g. text pages when patching breakpoints), so failed ranges
+// fall back to /proc/<pid>/mem, which writes through page protections like PTRACE_POKEDATA does.
+// Pointed at a core file instead, reads come from the core and writes fail.
+class ProcessMemory {
+public:
+    ProcessMemory() = default;
+    explicit ProcessMemory(pid_t pid) : _pid{pid} {}
+    ~ProcessMemory();
+
+    ProcessMemory(const ProcessMemory&) = delete;
+    ProcessMemory& operator=(const ProcessMemory&) = delete;
+
+    void reset(pid_t pid);
+    void reset(const CoreFile *core);
+
+    // Returns the number of bytes transferred (less than len if part of the range is not mapped)
+    std::size_t read(uint64_t addr, void *buf, std::size_t len);
+    std::size_t write(uint64_t addr, const void *buf, std::size_t len);
+    std::size_t write_forced(uint64_t addr, const void *buf, std::size_t len);   // Straight to /proc/<pid>/mem
+
+    uint64_t read_word(uint64_t addr);
+    void write_word(uint64_t addr, uint64_t val);
+
+private:
+    pid_t _pid{};
+    int _mem_fd = -1;   // /proc/<pid>/mem, opened on first use
+    const CoreFile *_core = nullptr;
+
+    int mem_fd();
+};
+
+
+#endif //PROCESSMEMORY_H
@@ -0,0 +1,57 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <vector>
+
+// Aggregates sampled call stacks (sequences of PCs, innermost first) into counts per distinct stack.
+// All storage is allocated up front, so recording a sample never allocates: the stacks live in one PC pool and
+// are found through an open-addressing hash table keyed by the PC sequence.
+class Profiler {
+public:
+    static constexpr std::size_t MAX_DEPTH = 64;
+
+    struct Stack {
+        std::uint64_t hash;
+        std::uint32_t offset;   // Start of the PCs in the pool
+        std::uint32_t depth;    // 0 marks an empty slot
+        std::uint64_t count;
+    };
+
+    explicit Profiler(std::size_t max_stacks);
+
+    // Count one sample, returning false (and dropping it) if the table is full
+    bool add(const std::uint64_t *pcs, std::size_t depth);
+
+    // Call f(pcs, depth, count) for every distinct stack
+    template <typename F>
+    void for_each(F f) const {
+        for (auto& stack : _stacks) {
+            if (stack.depth != 0) {
+                f(&_pcs[stack.offset], stack.depth, stack.count);
+            }
+        }
+    }
+
+    std::uint64_t get_samples() const { return _samples; }
+    std::uint64_t get_dropped() const { return _dropped; }
+    std::size_t size() const { return _size; }
+
+private:
+    std::vector<Stack> _stacks;         // Power of two sized, linear probing, at most half full
+    std::vector<std::uint64_t> _pcs;
+    std::size_t _pcs_used = 0;
+    std::size_t _size = 0;
+    std::size_t _max_stacks;
+    std::uint64_t _samples = 0;
+    std::uint64_t _dropped = 0;
+
+    static std::uint64_t hash(const std::uint64_t *pcs, std::size_t depth);
+};
+
+
+#endif //PROFILER_H
@@ -5,8 +5,14 @@
 #ifndef REGISTERS_H
 #define REGISTERS_H
 
+#include <sys/ptrace.h>
 #include <sys/user.h>
 #include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#include "Stats.h"
 
 // x86-64 registers (64 bit, integral value registers)
 enum class Reg {
@@ -68,60 +74,138 @@ const std::array<RegDescriptor, NUM_REGS> global_reg_descriptors {{
 }};
 
 
+// Index of each Reg (in enum order) into user_regs_struct, so lookups need no search
+inline const std::array<std::size_t, NUM_REGS> reg_indices = [] {
+    std::array<std::size_t, NUM_REGS> indices{};
+    for (std::size_t i = 0; i < NUM_REGS; i++) {
+        indices[static_cast<std::size_t>(global_reg_descriptors[i].r)] = i;
+    }
+    return indices;
+}();
+
+// Index of each DWARF register number into user_regs_struct (-1 if the number has no register)
+const std::size_t MAX_DWARF_REG = 64;
+inline const std::array<int, MAX_DWARF_REG> dwarf_reg_indices = [] {
+    std::array<int, MAX_DWARF_REG> indices{};
+    indices.fill(-1);
+    for (std::size_t i = 0; i < NUM_REGS; i++) {
+        if (global_reg_descriptors[i].dwarf_r >= 0) {
+            indices[global_reg_descriptors[i].dwarf_r] = static_cast<int>(i);
+        }
+    }
+    return indices;
+}();
+
+inline uint64_t& reg_slot(user_regs_struct& regs, Reg r) {
+    return *(reinterpret_cast<uint64_t*>(&regs) + reg_indices[static_cast<std::size_t>(r)]);
+}
+
 // Read a register in a process
-uint64_t get_reg_value(pid_t pid, Reg r) {
+inline uint64_t get_reg_value(pid_t pid, Reg r) {
     user_regs_struct regs{};
-    ptrace(PTRACE_GETREGS, pid, nullptr, &regs);
-
-    // Find the request register in the regs struct and read its value
-    auto iter = std::find_if(global_reg_descriptors.begin(), global_reg_descriptors.end(),
-                 [r](auto&& rd) { return rd.r == r; });
-    return *(reinterpret_cast<uint64_t*>(&regs) + (iter - global_reg_descriptors.begin()));
+    Stats::ptrace(PTRACE_GETREGS, pid, nullptr, &regs);
+    return reg_slot(regs, r);
 }
 
 // Set a register in a process
-void set_reg_value(pid_t pid, Reg r, uint64_t value) {
+inline void set_reg_value(pid_t pid, Reg r, uint64_t value) {
     user_regs_struct regs{};
-    ptrace(PTRACE_GETREGS, pid, nullptr, &regs);
-
-    // Find the request register in the regs struct and read its value
-    auto iter = std::find_if(global_reg_descriptors.begin(), global_reg_descriptors.end(),
-                             [r](auto&& rd) { return rd.r == r; });
-
-    if (iter == global_reg_descriptors.end()) {
-        // could not find register? should not be reached if we validate the reg name
-        throw std::out_of_range{"Unexpected register"};
-    }
+    Stats::ptrace(PTRACE_GETREGS, pid, nullptr, &regs);
 
     // Write the value into the appropriate reg in the regs struct and update via ptrace call
-    *(reinterpret_cast<uint64_t*>(&regs) + (iter - global_reg_descriptors.begin())) = value;
-    ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+    reg_slot(regs, r) = value;
+    Stats::ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
 }
 
-// Read a register from its DWARF number (validate it first)
-uint64_t get_reg_value_from_dwarf(pid_t pid, uint dwarf_num) {
-    auto iter = std::find_if(global_reg_descriptors.begin(), global_reg_descriptors.end(),
-                             [dwarf_num](auto&& rd){ return rd.dwarf_r == dwarf_num; });
-    if (iter == global_reg_descriptors.end()) {
+// Get the Reg from its DWARF number (validate it first)
+inline Reg get_reg_from_dwarf(uint dwarf_num) {
+    if (dwarf_num >= MAX_DWARF_REG || dwarf_reg_indices[dwarf_num] == -1) {
         throw std::out_of_range{"Unknown DWARF register number"};
     }
+    return global_reg_descriptors[dwarf_reg_indices[dwarf_num]].r;
+}
 
-    return get_reg_value(pid, iter->r);
+// Read a register from its DWARF number (validate it first)
+inline uint64_t get_reg_value_from_dwarf(pid_t pid, uint dwarf_num) {
+    return get_reg_value(pid, get_reg_from_dwarf(dwarf_num));
 }
 
 // Get the name of a Reg
-std::string get_reg_name(Reg r) {
-    auto iter = std::find_if(global_reg_descriptors.begin(), global_reg_descriptors.end(),
-                             [r](auto&& rd){ return rd.r == r; });
-    return iter->name;
+inline const std::string& get_reg_name(Reg r) {
+    return global_reg_descriptors[reg_indices[static_cast<std::size_t>(r)]].name;
 }
 
 // Get the Reg struct from its name
-Reg get_reg_from_name(const std::string& name) {
+inline Reg get_reg_from_name(const std::string& name) {
     auto iter = std::find_if(global_reg_descriptors.begin(), global_reg_descriptors.end(),
-                             [name](auto&& rd){ return rd.name == name; });
+                             [&name](auto&& rd){ return rd.name == name; });
+    if (iter == global_reg_descriptors.end()) {
+        throw std::out_of_range{"Unknown register " + name};
+    }
     return iter->r;
 }
 
 
+// Registers of a stopped thread, fetched with one PTRACE_GETREGS per stop.
+// Writes only touch the cached copy and are flushed with one PTRACE_SETREGS just before the thread resumes.
+class RegisterCache {
+public:
+    RegisterCache() = default;
+    explicit RegisterCache(pid_t pid) : _pid{pid} {}
+
+    void reset(pid_t pid) {
+        _pid = pid;
+        _valid = false;
+        _dirty = false;
+    }
+
+    uint64_t get(Reg r) {
+        return reg_slot(fill(), r);
+    }
+
+    void set(Reg r, uint64_t value) {
+        reg_slot(fill(), r) = value;
+        _dirty = true;
+    }
+
+    const user_regs_struct& get_all() {
+        return fill();
+    }
+
+    // Use saved registers (from a core file) instead of fetching them from a live thread
+    void load(const user_regs_struct& regs) {
+        _regs = regs;
+        _valid = true;
+        _dirty = false;
+    }
+
+    // Write back any modified registers (call before resuming the thread)
+    void flush() {
+        if (_dirty) {
+            Stats::ptrace(PTRACE_SETREGS, _pid, nullptr, &_regs);
+            _dirty = false;
+        }
+    }
+
+    // Forget the cached values (call when the thread resumes)
+    void invalidate() {
+        _valid = false;
+    }
+
+private:
+    pid_t _pid{};
+    user_regs_struct _regs{};
+    bool _valid = false;
+    bool _dirty = false;
+
+    user_regs_struct& fill() {
+        if (!_valid) {
+            Stats::ptrace(PTRACE_GETREGS, _pid, nullptr, &_regs);
+            _valid = true;
+        }
+        return _regs;
+    }
+};
+
+
 #endif //REGISTERS_H
@@ -0,0 +1,38 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef SOURCECACHE_H
+#define SOURCECACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Source files mapped into memory once, with the offset of every line start.
+// Printing a window of lines then only touches the lines in the window, however large the file is.
+class SourceCache {
+public:
+    struct File {
+        std::shared_ptr<const char> data;   // Unmapped when the last copy of the cache goes away
+        std::size_t size = 0;
+        std::vector<std::size_t> line_starts;
+
+        std::size_t num_lines() const;
+        std::string_view get_line(std::size_t line) const;  // 1-based, without the newline
+    };
+
+    // Get a file, mapping and indexing it on first use (nullptr if it cannot be opened)
+    const File* get(const std::string& path);
+
+private:
+    std::unordered_map<std::string, File> _files;
+
+    static void index_lines(const char *data, std::size_t size, std::vector<std::size_t>& line_starts);
+};
+
+
+#endif //SOURCECACHE_H
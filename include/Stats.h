@@ -0,0 +1,108 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Counts and latency histograms of the system calls the debugger makes on the debuggee (ptrace, waitpid and
+// memory transfers) and of the files it reads (/proc files, sources, the index cache and cores), kept per command
+// so that a slow command shows where its time goes.
+// Call sites go through Stats::ptrace, Stats::waitpid or Stats::timed. Configured with -DENABLE_STATS=OFF
+// (DEBUGGER_STATS undefined), these are plain inline forwards to the call and nothing is recorded.
+// Only the debugger thread makes these calls, so the counters are not synchronised.
+namespace Stats {
+    enum class Call {
+        PtraceResume,   // CONT, SINGLESTEP, SINGLEBLOCK, SYSCALL, DETACH
+        PtraceRegs,     // GETREGS, SETREGS, GETFPREGS, SETFPREGS
+        PtraceUser,     // PEEKUSER, POKEUSER (debug registers)
+        PtraceOther,
+        Waitpid,
+        MemoryRead,
+        MemoryWrite,
+        FileRead,       // Opening and reading (or mapping) a file, with the parsing done as it is read
+        Count,
+    };
+
+    inline Call ptrace_call(__ptrace_request request) {
+        switch (static_cast<int>(request)) {
+            case PTRACE_CONT: case PTRACE_SINGLESTEP: case PTRACE_SYSCALL: case PTRACE_DETACH:
+#ifdef PTRACE_SINGLEBLOCK
+            case PTRACE_SINGLEBLOCK:
+#endif
+                return Call::PtraceResume;
+            case PTRACE_GETREGS: case PTRACE_SETREGS: case PTRACE_GETFPREGS: case PTRACE_SETFPREGS:
+                return Call::PtraceRegs;
+            case PTRACE_PEEKUSER: case PTRACE_POKEUSER:
+                return Call::PtraceUser;
+            default:
+                return Call::PtraceOther;
+        }
+    }
+
+#ifdef DEBUGGER_STATS
+    void record(Call call, uint64_t ns);
+
+    // Run a call and record how long it took against the current command
+    template <typename F>
+    inline auto timed(Call call, F f) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = f();
+        record(call, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        return result;
+    }
+
+    // Calls made while it is alive are counted against the named command (prefix followed by name)
+    class CommandScope {
+    public:
+        explicit CommandScope(const std::string& name) : CommandScope({}, name) {}
+        CommandScope(std::string_view prefix, std::string_view name);
+        ~CommandScope();
+
+        CommandScope(const CommandScope&) = delete;
+        CommandScope& operator=(const CommandScope&) = delete;
+
+    private:
+        std::size_t _previous;
+        std::chrono::steady_clock::time_point _start;
+    };
+#else
+    template <typename F>
+    inline auto timed(Call, F f) {
+        return f();
+    }
+
+    class CommandScope {
+    public:
+        explicit CommandScope(const std::string&) {}
+        CommandScope(std::string_view, std::string_view) {}
+    };
+#endif
+
+    template <typename... Args>
+    inline long ptrace(__ptrace_request request, Args... args) {
+        return timed(ptrace_call(request), [&] { return ::ptrace(request, args...); });
+    }
+
+    inline pid_t waitpid(pid_t pid, int *status, int options) {
+        return timed(Call::Waitpid, [&] { return ::waitpid(pid, status, options); });
+    }
+
+    bool enabled();
+    uint64_t total_calls();     // Recorded so far, across all commands (0 when compiled out)
+    void print();
+    void dump_json(std::ostream& out);
+    void reset();
+}
+
+
+#endif //STATS_H
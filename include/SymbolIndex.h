@@ -0,0 +1,75 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "elf/elf++.hh"
+
+// Index over the .symtab/.dynsym entries of an ELF file.
+// Names are views into the mapped string tables, so queries never allocate. Exact names go through an
+// open-addressing hash table, prefix and glob queries through the name-sorted symbol array, and
+// address queries through an address-sorted permutation of it.
+class SymbolIndex {
+public:
+    enum class SymbolType {
+        NoType,
+        Object,
+        Function,
+        Section,
+        File,
+    };
+
+    struct Symbol {
+        SymbolType type;
+        std::string_view name;
+        std::uint64_t addr;
+        std::uint64_t size;
+    };
+
+    // Contiguous run of symbols within the index
+    struct SymbolRange {
+        const Symbol* first = nullptr;
+        const Symbol* last = nullptr;
+
+        const Symbol* begin() const { return first; }
+        const Symbol* end() const { return last; }
+        bool empty() const { return first == last; }
+        std::size_t size() const { return last - first; }
+    };
+
+    SymbolIndex() = default;
+
+    void build(const elf::elf& elf);
+    bool is_built() const { return _built; }
+
+    SymbolRange find(std::string_view name) const;
+    SymbolRange find_prefix(std::string_view prefix) const;
+    void find_glob(const std::string& pattern, std::vector<const Symbol*>& out) const;
+    const Symbol* find_by_address(std::uint64_t addr) const;
+
+    static SymbolType get_symbol_type(elf::stt symbol);
+
+private:
+    struct Slot {
+        std::uint32_t hash;
+        std::uint32_t first;    // Index of the first symbol with this name, plus one (0 marks an empty slot)
+        std::uint32_t count;
+    };
+
+    bool _built = false;
+    std::vector<Symbol> _symbols;       // Sorted by name, then address
+    std::vector<std::uint32_t> _by_addr;
+    std::vector<Slot> _slots;           // Power of two sized, linear probing
+
+    static std::uint32_t hash(std::string_view name);
+};
+
+
+#endif //SYMBOLINDEX_H
@@ -0,0 +1,58 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef SYSCALLFILTER_H
+#define SYSCALLFILTER_H
+
+#include <sys/user.h>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ProcessMemory.h"
+
+// Catching and tracing of the system calls of a launched process (x86-64), filtered in the kernel.
+// Before exec, the process installs a seccomp filter that returns SECCOMP_RET_TRACE for the selected system calls
+// only, so these stop it (reported as PTRACE_EVENT_SECCOMP) and every other one runs at full speed, instead of
+// stopping at each entry and exit as with PTRACE_SYSCALL. A filter cannot be changed once installed, so the set is
+// chosen at launch; which of its system calls are printed (traced) or stop the process (caught) can change later.
+class SyscallFilter {
+public:
+    // Numbers of a comma separated list of system call names (or numbers)
+    static std::vector<long> parse(const std::string& names);
+    static std::string get_name(long nr);
+
+    // Called by the launched process, before exec
+    static void install(const std::vector<long>& nrs);
+
+    // The system calls in the installed filter, all traced and none caught to begin with
+    void reset(const std::vector<long>& nrs);
+    bool empty() const { return _flags.empty(); }
+
+    bool is_traced(long nr) const;
+    bool is_caught(long nr) const;
+    // names is a list as for parse(), 'all' or 'none'
+    void set_traced(const std::string& names);
+    void set_caught(const std::string& names);
+    void print(std::ostream& out) const;
+
+    // strace-style: the call with its arguments (strings and buffers are read from the process), and its result
+    static std::string format_call(const user_regs_struct& regs, ProcessMemory& memory);
+    static std::string format_result(long nr, uint64_t result);
+    static bool returns(long nr);   // false for exit and exit_group
+
+private:
+    struct Flags {
+        bool traced = true;
+        bool caught = false;
+    };
+    std::map<long, Flags> _flags;
+
+    void set(const std::string& names, bool Flags::*flag);
+};
+
+
+#endif //SYSCALLFILTER_H
@@ -0,0 +1,31 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <sys/ptrace.h>
+#include <csignal>
+#include <string>
+
+#include "Registers.h"
+
+// Per-thread state of the debuggee
+struct Thread {
+    explicit Thread(pid_t tid) : tid{tid}, regs{tid} {}
+
+    pid_t tid;
+    RegisterCache regs;
+    bool started = false;           // Seen its first stop (new threads start with a SIGSTOP from the kernel)
+    bool running = false;           // Resumed and not stopped since
+    bool stop_requested = false;    // A SIGSTOP is on its way and must be swallowed
+    bool at_breakpoint = false;     // Stopped by one of our breakpoints (pc rewound onto it)
+    int pending_signal = 0;         // Signal to deliver when the thread is next resumed
+    int pending_status = -1;        // Wait status seen while stopping all threads, handled on the next wait
+    __ptrace_request last_request = PTRACE_CONT;
+    std::string syscall;            // A traced system call it is in, printed with its result when it returns
+};
+
+
+#endif //THREAD_H
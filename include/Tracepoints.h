@@ -0,0 +1,109 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef TRACEPOINTS_H
+#define TRACEPOINTS_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ProcessMemory.h"
+
+// Whether the instructions in code (at the absolute address addr) make no call and no jump out of [low, high), so
+// that running them at full speed cannot skip a function. False if they cannot all be decoded
+bool is_local_code(const uint8_t *code, std::size_t len, uint64_t addr, uint64_t low, uint64_t high);
+
+// Fast tracepoints: the instructions at a location are replaced by a jmp to a trampoline, which records the
+// registers into a ring buffer, runs the replaced instructions (relocated) and jumps back. Hits never stop the
+// process, so they cost tens of nanoseconds instead of the context switches and ptrace calls of a breakpoint.
+// The trampolines and the ring live in an area of shared memory (a memfd) that the process maps within reach of a
+// rel32 jmp from the code, and that we map too: trampolines are written straight into it, and a drainer thread
+// reads the ring as it fills. Writers reserve a slot with an atomic increment and never wait, so if the drainer
+// falls a whole ring behind the oldest records are overwritten (and counted as dropped).
+class Tracepoints {
+public:
+    // Layout of the shared area
+    static constexpr std::size_t CODE_OFFSET = 4096;            // After the ring header
+    static constexpr std::size_t CODE_SIZE = 60 * 1024;
+    static constexpr std::size_t RING_OFFSET = CODE_OFFSET + CODE_SIZE;
+    static constexpr std::size_t RING_SIZE = 16384;             // Records, a power of 2
+    static constexpr std::size_t MAX_RECENT = 16;               // Records kept per tracepoint for 'records'
+
+    // Written by the trampoline for every hit
+    struct Record {
+        uint64_t seq;       // Index in the ring + 1 once complete (0 while being written)
+        uint64_t id;        // Of the tracepoint
+        uint64_t tsc;       // Time stamp counter
+        uint64_t rflags;
+        uint64_t rsp;
+        uint64_t rax, rbx, rcx, rdx, rsi, rdi, rbp, r8, r9, r10, r11, r12, r13, r14, r15;
+    };
+
+    static std::size_t get_area_size();
+
+    Tracepoints() = default;
+    ~Tracepoints();
+
+    Tracepoints(const Tracepoints&) = delete;
+    Tracepoints& operator=(const Tracepoints&) = delete;
+
+    bool is_mapped() const { return _area != nullptr; }
+    void map(int fd, uint64_t remote);      // The process mapped the memfd fd at remote
+    void unmap();                           // Forget the area and every tracepoint (the process has gone)
+    bool in_reach(uint64_t addr) const;
+
+    // Patch a tracepoint at addr (absolute). check is called with the range of the instructions to be replaced,
+    // and throws if they must not be
+    unsigned add(uint64_t addr, ProcessMemory& memory, const std::function<void(uint64_t, std::size_t)>& check);
+    void remove(unsigned id, ProcessMemory& memory);
+    void remove_all(ProcessMemory& memory);
+    void reinsert(ProcessMemory& memory);   // Patch every tracepoint again (into a process restarted from a checkpoint)
+    bool overlaps(uint64_t addr) const;
+    bool empty() const { return _tracepoints.empty(); }
+
+    void print(std::ostream& out, uint64_t load_addr);
+    void print_records(unsigned id, std::ostream& out);
+    void set_log(const std::string& path);  // Every record is also written to this file ("" to stop)
+
+private:
+    struct Tracepoint {
+        uint64_t addr;
+        uint64_t trampoline;            // Remote address
+        std::vector<uint8_t> saved;     // The instructions the jmp replaced
+        uint64_t hits = 0;
+        std::deque<Record> recent;
+    };
+
+    uint8_t *_area = nullptr;   // Our mapping of the area
+    uint64_t _remote = 0;       // Where the process mapped it
+    std::size_t _code_used = 0;
+    uint64_t _record_fn = 0;    // Common routine that records the registers (remote address)
+    std::map<unsigned, Tracepoint> _tracepoints;
+    unsigned _next_id = 1;
+
+    // Shared with the drainer
+    std::mutex _lock;
+    uint64_t _tail = 0;         // Next record to read
+    uint64_t _dropped = 0;
+    std::ofstream _log;
+    std::thread _drainer;
+    std::atomic<bool> _stop {false};
+
+    void emit_record_fn();
+    std::size_t drain();
+    void deliver(const Record& record);
+    static void write_jump(const Tracepoint& tp, ProcessMemory& memory);
+};
+
+
+#endif //TRACEPOINTS_H
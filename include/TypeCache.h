@@ -0,0 +1,73 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef TYPECACHE_H
+#define TYPECACHE_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dwarf/dwarf++.hh"
+
+// Layout of a DWARF type: its size, member offsets, array strides and enumerators, decoded from its DIE once
+struct TypeLayout {
+    enum class Kind : uint8_t {
+        Void,
+        Base,
+        Enum,
+        Pointer,    // Also references
+        Struct,     // Also classes and unions
+        Array,      // One dimension, whose elements may be arrays themselves
+        Function,
+        Alias,      // typedef, const, volatile and restrict: the type is the target
+    };
+
+    enum class Encoding : uint8_t { Signed, Unsigned, SignedChar, UnsignedChar, Bool, Float };
+
+    struct Member {
+        std::string name;
+        uint64_t offset;            // In bytes, from the start of the enclosing object
+        uint16_t bit_offset = 0;    // For bit fields, from the least significant bit of the word at offset
+        uint16_t bit_size = 0;      // 0 if not a bit field
+        const TypeLayout *type;
+    };
+
+    Kind kind = Kind::Void;
+    Encoding encoding = Encoding::Signed;
+    std::string name;                   // As written in C, e.g. "struct point" or "char *"
+    uint64_t size = 0;                  // In bytes
+    const TypeLayout *target = nullptr; // Pointee, element or aliased type
+    uint64_t count = 0;                 // Array elements (0 if unknown, e.g. a flexible array member)
+    uint64_t stride = 0;                // Bytes from one array element to the next
+    std::vector<Member> members;
+    std::vector<std::pair<int64_t, std::string>> enumerators;
+
+    // The type itself, with typedefs and qualifiers removed
+    const TypeLayout& resolve() const;
+    const Member* find_member(const std::string& member_name, uint64_t& base) const;
+};
+
+// Type layouts keyed by the offset of their DIE, decoded on first use.
+// Layouts are never freed or moved while the cache lives, so they can point to each other
+// (a struct holding a pointer to its own type refers back to the same layout).
+class TypeCache {
+public:
+    const TypeLayout& get(const dwarf::die& type);
+    const TypeLayout& get_void();
+
+private:
+    std::deque<TypeLayout> _layouts;
+    std::unordered_map<dwarf::section_offset, const TypeLayout*> _by_offset;
+
+    void decode(const dwarf::die& type, TypeLayout& layout);
+    const TypeLayout& decode_array(const dwarf::die& type, const TypeLayout& element,
+                                   std::vector<dwarf::die>::const_iterator dim,
+                                   std::vector<dwarf::die>::const_iterator end);
+};
+
+
+#endif //TYPECACHE_H
@@ -0,0 +1,118 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef UNWINDER_H
+#define UNWINDER_H
+
+#include <sys/user.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "elf/elf++.hh"
+#include "ProcessMemory.h"
+
+// The top of a thread's stack, copied with one bulk read. Words outside the copy are read from the process.
+// The buffer is kept between reads, so a snapshot can be reused without allocating.
+class StackSnapshot {
+public:
+    void read(ProcessMemory& memory, uint64_t sp, std::size_t len);
+    bool read_word(uint64_t addr, uint64_t& value) const;
+
+private:
+    ProcessMemory *_memory = nullptr;
+    uint64_t _base = 0;
+    std::vector<uint8_t> _data;
+    std::size_t _size = 0;
+};
+
+// Call frame unwinder driven by the CFI of .eh_frame, and of .debug_frame for functions it does not cover.
+// build() only indexes the FDEs by address. The rule rows of an FDE are decoded when it is first used and cached,
+// so unwinding a frame is two binary searches plus applying the rules of one row.
+class Unwinder {
+public:
+    // Registers tracked while unwinding, in DWARF numbering: 0-15 are the general purpose registers (7 is rsp),
+    // 16 is the return address column
+    static constexpr std::size_t NUM_UNWIND_REGS = 17;
+
+    struct Frame {
+        uint64_t pc;
+        uint64_t cfa;   // Canonical frame address: the value of rsp before the call that created the frame
+    };
+
+    // Finds the unwinder of the module containing a PC and its load address (nullptr if there is none)
+    using ModuleLookup = std::function<const Unwinder*(uint64_t pc, uint64_t& load_addr)>;
+
+    void build(const elf::elf& elf);
+
+    // Unwind a stopped thread into at most max frames (innermost first), returning how many were found.
+    // Code without CFI is unwound through the frame pointer
+    std::size_t unwind(const user_regs_struct& regs, uint64_t load_addr, const StackSnapshot& stack,
+                       Frame *frames, std::size_t max) const;
+
+    // Unwind through several modules (e.g. shared libraries), using the CFI of the module each frame is in
+    static std::size_t unwind(const user_regs_struct& regs, const ModuleLookup& lookup, const StackSnapshot& stack,
+                              Frame *frames, std::size_t max);
+
+private:
+    enum class RuleType : uint8_t {
+        Undefined,
+        SameValue,
+        Offset,         // Saved at CFA + offset (for the CFA rule itself: register + offset)
+        ValOffset,      // Is CFA + offset
+        Register,       // Saved in another register
+        Expression,     // Saved at the address computed by a DWARF expression
+        ValExpression,  // Is the value computed by a DWARF expression
+    };
+
+    struct Rule {
+        RuleType type = RuleType::Undefined;
+        uint16_t reg = 0;
+        int64_t offset = 0;
+        const uint8_t *expr = nullptr;
+        std::size_t expr_len = 0;
+    };
+
+    struct Row {
+        uint64_t loc;
+        Rule cfa;
+        Rule regs[NUM_UNWIND_REGS];
+    };
+
+    struct Cie {
+        uint64_t code_align = 1;
+        int64_t data_align = 1;
+        uint64_t ra_reg = 16;
+        uint8_t fde_encoding = 0;
+        bool has_augmentation_data = false;
+        bool usable = true;     // False for augmentations we cannot parse
+        const uint8_t *instructions = nullptr;
+        const uint8_t *end = nullptr;
+    };
+
+    struct Fde {
+        uint64_t low;
+        uint64_t high;
+        uint32_t cie;
+        const uint8_t *instructions;
+        const uint8_t *end;
+        mutable std::vector<Row> rows;  // Sorted by loc, decoded on first use
+        mutable bool decoded = false;
+    };
+
+    std::vector<Cie> _cies;
+    std::vector<Fde> _fdes;     // Sorted by low address
+
+    void parse_section(const elf::section& section, bool eh_frame);
+    uint32_t parse_cie(const uint8_t *entry, const uint8_t *section_start, uint64_t section_addr, bool eh_frame);
+    const Row* find_row(uint64_t pc) const;
+    void decode(const Fde& fde) const;
+    void execute(const uint8_t *p, const uint8_t *end, const Cie& cie, Row& row, const Row& initial,
+                 std::vector<Row> *rows) const;
+    static bool evaluate(const uint8_t *expr, std::size_t len, const uint64_t *regs, uint32_t valid,
+                         const StackSnapshot& stack, uint64_t initial, bool push_initial, uint64_t& result);
+};
+
+
+#endif //UNWINDER_H
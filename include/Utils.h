@@ -14,7 +14,11 @@
 #include <string>
 #include <array>
 #include <iomanip>
+#include <algorithm>
 #include <elf.h>
+#include <sys/types.h>
+#include <fstream>
+#include "Stats.h"
 
 namespace Utils {
 // Splits a string into a vector of strings given a delimiter char
@@ -53,6 +57,47 @@ inline void print_hex(const uint64_t &num, bool full = false, bool end_line = tr
     if (end_line) std::cout << '\n';
 }
 
+// Print a hexdump (offset, 16 bytes in hex, ASCII) of a buffer that was read from address base.
+// Runs of identical lines are collapsed into a single '*', like hexdump -C.
+inline void print_hexdump(uint64_t base, const uint8_t *data, std::size_t len) {
+    const char *digits = "0123456789abcdef";
+    char line[96];
+    bool skipping = false;
+
+    for (std::size_t off = 0; off < len; off += 16) {
+        auto n = std::min<std::size_t>(16, len - off);
+        if (off >= 16 && n == 16 && std::equal(data + off, data + off + 16, data + off - 16)) {
+            if (!skipping) std::cout << "*\n";
+            skipping = true;
+            continue;
+        }
+        skipping = false;
+
+        auto p = line + snprintf(line, sizeof(line), "%016lx  ", static_cast<unsigned long>(base + off));
+        for (std::size_t i = 0; i < 16; i++) {
+            if (i < n) {
+                *p++ = digits[data[off + i] >> 4];
+                *p++ = digits[data[off + i] & 0xf];
+            } else {
+                *p++ = ' ';
+                *p++ = ' ';
+            }
+            *p++ = ' ';
+            if (i == 7) *p++ = ' ';
+        }
+        *p++ = ' ';
+        *p++ = '|';
+        for (std::size_t i = 0; i < n; i++) {
+            auto c = data[off + i];
+            *p++ = (c >= 0x20 && c < 0x7f) ? static_cast<char>(c) : '.';
+        }
+        *p++ = '|';
+        *p++ = '\n';
+        std::cout.write(line, p - line);
+    }
+    std::cout << std::flush;
+}
+
 // Function in C that checks if an ELF file is a shared object (PIE) or an executable
 inline bool is_elf_pie(const char *file) {
     Elf64_Ehdr header;
@@ -64,5 +109,33 @@ inline bool is_elf_pie(const char *file) {
     fclose(f);
     return header.e_type == ET_DYN; // type flag is set to position independent (dynamic)
 }
+
+// A line of /proc/<pid>/maps
+struct Mapping {
+    uint64_t start;
+    uint64_t end;
+    std::string perms;      // e.g. "r-xp"
+    uint64_t offset;
+    std::string path;       // Empty for anonymous mappings
+};
+
+// Read the mappings of a process, in address order
+inline std::vector<Mapping> read_maps(pid_t pid) {
+    return Stats::timed(Stats::Call::FileRead, [&] {
+        std::vector<Mapping> maps;
+        std::ifstream ifs {"/proc/" + std::to_string(pid) + "/maps"};
+        std::string line;
+        while (std::getline(ifs, line)) {
+            // Format: start-end perms offset dev inode path
+            std::istringstream ss {line};
+            std::string range, perms, offset, dev, inode, path;
+            ss >> range >> perms >> offset >> dev >> inode;
+            std::getline(ss >> std::ws, path);
+            maps.push_back(Mapping{std::stoul(range, nullptr, 16), std::stoul(range.substr(range.find('-') + 1), nullptr, 16),
+                                   perms, std::stoul(offset, nullptr, 16), path});
+        }
+        return maps;
+    });
+}
 }
 #endif //UTILS_H
@@ -0,0 +1,83 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef VALUEPRINTER_H
+#define VALUEPRINTER_H
+
+#include <sys/user.h>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DwarfContext.h"
+#include "ProcessMemory.h"
+
+// Prints variables of a stopped thread. An expression is a variable in scope at the PC (a local, parameter or global),
+// followed by any number of .member, ->member and [index], and optionally preceded by * or &, e.g. *list->head.
+// The variable is located by evaluating its DWARF location expression. Members and indices are then resolved through
+// the type layout cache to an offset, so only the pointers on the way are read; the bytes of the value itself
+// (a whole struct or array) are read with a single bulk transfer and formatted from the copy.
+class ValuePrinter {
+public:
+    // What location expressions may refer to
+    struct Frame {
+        const user_regs_struct& regs;
+        uint64_t pc;                    // Relative to the module
+        uint64_t load_addr;             // Of the module
+        std::function<uint64_t()> cfa;  // Unwinds the frame, so only called if an expression needs it
+    };
+
+    ValuePrinter(const DwarfContext& ctx, ProcessMemory& memory, Frame frame)
+            : _ctx{ctx}, _memory{memory}, _frame{std::move(frame)} {}
+
+    void print(const std::string& expression, std::ostream& out);
+
+private:
+    // Part of a value: in memory, in a register or computed by the location expression itself
+    struct Piece {
+        enum class Type : uint8_t { Memory, Register, Literal, Implicit, Unavailable };
+
+        Type type = Type::Memory;
+        uint64_t value = 0;             // Address, DWARF register number or the value itself
+        const uint8_t *data = nullptr;  // Bytes of an implicit value (value is their length)
+        std::size_t size = 0;           // In bytes, 0 for the whole value
+    };
+
+    // Where an object is: its variable's pieces, and an offset into them
+    struct Object {
+        std::vector<Piece> pieces;
+        uint64_t offset = 0;
+        const TypeLayout *type;
+        uint16_t bit_offset = 0;    // Of a bit field member
+        uint16_t bit_size = 0;
+    };
+
+    static constexpr std::size_t MAX_STACK = 64;
+    static constexpr std::size_t MAX_ELEMENTS = 200;        // Printed per array
+    static constexpr std::size_t MAX_STRING = 200;          // Read for a char *
+    static constexpr std::size_t MAX_VALUE_SIZE = 65536;    // Read for one value
+
+    const DwarfContext& _ctx;
+    ProcessMemory& _memory;
+    Frame _frame;
+    bool _has_frame_base = false;
+    uint64_t _frame_base = 0;
+
+    Object locate(const std::string& name);
+    void evaluate(const uint8_t *p, std::size_t len, std::vector<Piece>& pieces);
+    uint64_t get_reg(uint64_t dwarf_reg) const;
+    uint64_t get_frame_base();
+    std::size_t read(const Object& object, uint8_t *buf, std::size_t len);
+    Object dereference(const Object& pointer, uint64_t index);
+    static void select_member(Object& object, const std::string& name);
+
+    void format(const TypeLayout& type, const uint8_t *data, std::size_t avail, std::ostream& out);
+    void format_base(const TypeLayout& type, const uint8_t *data, std::ostream& out);
+    void format_string(const char *data, std::size_t len, std::ostream& out);
+};
+
+
+#endif //VALUEPRINTER_H
@@ -0,0 +1,41 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Threads shared by everything built in the background (the index of the program and of each shared library), one
+// per core but the one left for the REPL thread. Started on first use, and never stopped: they are not joined at
+// exit. Every job has an owner, whose queued jobs can be dropped and running ones waited for.
+class WorkerPool {
+public:
+    static WorkerPool& get();
+
+    std::size_t size() const { return _threads.size(); }
+    void submit(const void *owner, std::function<void()> job);
+    // Drop the jobs of owner still queued, and wait for its running ones to return
+    void cancel(const void *owner);
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _queued;
+    std::condition_variable _finished;
+    std::deque<std::pair<const void *, std::function<void()>>> _jobs;
+    std::vector<const void *> _running;     // Owner of each job being run
+    std::vector<std::thread> _threads;
+
+    WorkerPool();
+    void run();
+};
+
+
+#endif //WORKERPOOL_H
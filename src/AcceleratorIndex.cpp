@@ -0,0 +1,361 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "AcceleratorIndex.h"
+
+constexpr uint64_t DW_TAG_SUBPROGRAM = 0x2e;
+constexpr uint64_t DW_IDX_COMPILE_UNIT = 1;
+constexpr uint32_t GDB_INDEX_FUNCTION = 3;  // Symbol kind in the attributes of a .gdb_index CU vector entry
+
+template <typename T>
+static T read(const uint8_t *p) {
+    T value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t read_uleb128(const uint8_t *&p, const uint8_t *end) {
+    uint64_t result = 0;
+    unsigned shift = 0;
+    while (p < end) {
+        auto byte = *p++;
+        if (shift < 64) {
+            result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        }
+        shift += 7;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return result;
+}
+
+// Read a .debug_names attribute value of a fixed or LEB128 form (false for forms it cannot contain)
+static bool read_form(const uint8_t *&p, const uint8_t *end, uint64_t form, uint64_t& value) {
+    std::size_t size;
+    switch (form) {
+        case 0x0b: case 0x11: case 0x0c: size = 1; break;   // data1, ref1, flag
+        case 0x05: case 0x12: size = 2; break;              // data2, ref2
+        case 0x06: case 0x13: size = 4; break;              // data4, ref4
+        case 0x07: case 0x14: case 0x20: size = 8; break;   // data8, ref8, ref_sig8
+        case 0x19: value = 1; return true;                  // flag_present
+        case 0x0f: case 0x15: case 0x0d:                    // udata, ref_udata, sdata
+            value = read_uleb128(p, end);
+            return p <= end;
+        default:
+            return false;
+    }
+    if (p + size > end) {
+        return false;
+    }
+    value = 0;
+    std::memcpy(&value, p, size);
+    p += size;
+    return true;
+}
+
+void AcceleratorIndex::build(const elf::elf& elf) {
+    _ranges.clear();
+    _range_units.clear();
+    _gdb_index = nullptr;
+    _name_tables.clear();
+
+    // .gdb_index has both tables; otherwise fall back to .debug_aranges for addresses
+    auto& gdb_index = elf.get_section(".gdb_index");
+    if (gdb_index.valid()) {
+        read_gdb_index(gdb_index);
+    }
+    if (_ranges.empty()) {
+        auto& aranges = elf.get_section(".debug_aranges");
+        if (aranges.valid()) {
+            read_aranges(aranges);
+        }
+    }
+    if (_gdb_index == nullptr) {
+        auto& names = elf.get_section(".debug_names");
+        auto& str = elf.get_section(".debug_str");
+        if (names.valid() && str.valid()) {
+            _str = static_cast<const char *>(str.data());
+            _str_size = str.size();
+            read_debug_names(names);
+        }
+    }
+
+    std::sort(_ranges.begin(), _ranges.end(), [](auto& a, auto& b) { return a.low < b.low; });
+    for (auto& range : _ranges) {
+        _range_units.push_back(range.unit);
+    }
+    std::sort(_range_units.begin(), _range_units.end());
+    _range_units.erase(std::unique(_range_units.begin(), _range_units.end()), _range_units.end());
+}
+
+// .debug_aranges: one set per unit (header, then address/length pairs up to a 0, 0 terminator)
+void AcceleratorIndex::read_aranges(const elf::section& section) {
+    auto data = static_cast<const uint8_t *>(section.data());
+    auto size = section.size();
+    std::size_t pos = 0;
+    while (pos + 16 <= size) {
+        auto length = read<uint32_t>(data + pos);
+        if (length == 0xffffffff || pos + 4 + length > size) {
+            break;  // 64 bit DWARF is not used for x86-64 executables in practice
+        }
+        auto set_end = pos + 4 + length;
+        auto unit = read<uint32_t>(data + pos + 6);
+        auto address_size = data[pos + 10];
+        if (address_size != 8) {
+            pos = set_end;
+            continue;
+        }
+        // Tuples are aligned to twice the address size from the start of the set
+        for (auto p = pos + 16; p + 16 <= set_end; p += 16) {
+            auto low = read<uint64_t>(data + p);
+            auto len = read<uint64_t>(data + p + 8);
+            if (low == 0 && len == 0) {
+                break;
+            }
+            _ranges.push_back(AddressRange{low, low + len, unit});
+        }
+        pos = set_end;
+    }
+}
+
+// .gdb_index (versions 7 to 9): a CU list, an address area and a hash table of names into a constant pool
+void AcceleratorIndex::read_gdb_index(const elf::section& section) {
+    auto data = static_cast<const uint8_t *>(section.data());
+    auto size = section.size();
+    if (size < 28) {
+        return;
+    }
+    auto version = read<uint32_t>(data);
+    if (version < 7 || version > 9) {
+        return;
+    }
+    auto cu_list = read<uint32_t>(data + 4);
+    auto address_area = read<uint32_t>(data + 12);
+    auto symbol_table = read<uint32_t>(data + 16);
+    auto constant_pool = read<uint32_t>(data + (version >= 9 ? 24 : 20));
+    if (cu_list > address_area || address_area > symbol_table || symbol_table > constant_pool || constant_pool > size) {
+        return;
+    }
+    _gdb_index = data;
+    _gdb_index_size = size;
+
+    auto num_cus = (read<uint32_t>(data + 8) - cu_list) / 16;
+    for (auto p = address_area; p + 20 <= symbol_table; p += 20) {
+        auto cu = read<uint32_t>(data + p + 16);
+        if (cu < num_cus) {
+            _ranges.push_back(AddressRange{read<uint64_t>(data + p), read<uint64_t>(data + p + 8),
+                                           read<uint64_t>(data + cu_list + cu * 16)});
+        }
+    }
+}
+
+// .debug_names (DWARF 5): one or more name tables, each with its own unit list, hash table and abbreviations
+void AcceleratorIndex::read_debug_names(const elf::section& section) {
+    auto data = static_cast<const uint8_t *>(section.data());
+    auto size = section.size();
+    std::size_t pos = 0;
+    while (pos + 40 <= size) {
+        auto length = read<uint32_t>(data + pos);
+        if (length == 0xffffffff || pos + 4 + length > size) {
+            break;
+        }
+        auto table_end = data + pos + 4 + length;
+        if (read<uint16_t>(data + pos + 4) != 5) {
+            pos += 4 + length;
+            continue;
+        }
+
+        NameTable table{};
+        table.num_units = read<uint32_t>(data + pos + 8);
+        auto num_local_tus = read<uint32_t>(data + pos + 12);
+        auto num_foreign_tus = read<uint32_t>(data + pos + 16);
+        table.num_buckets = read<uint32_t>(data + pos + 20);
+        table.num_names = read<uint32_t>(data + pos + 24);
+        auto abbrev_size = read<uint32_t>(data + pos + 28);
+        auto augmentation_size = read<uint32_t>(data + pos + 32);
+
+        auto p = data + pos + 36 + ((augmentation_size + 3) & ~3u);
+        table.units = p;
+        p += 4ul * table.num_units + 4ul * num_local_tus + 8ul * num_foreign_tus;
+        table.buckets = p;
+        p += 4ul * table.num_buckets;
+        table.hashes = p;
+        p += table.num_buckets > 0 ? 4ul * table.num_names : 0;
+        table.string_offsets = p;
+        p += 4ul * table.num_names;
+        table.entry_offsets = p;
+        p += 4ul * table.num_names;
+        auto abbrev_end = p + abbrev_size;
+        table.entry_pool = abbrev_end;
+        table.end = table_end;
+        if (abbrev_end > table_end) {
+            break;
+        }
+
+        while (p < abbrev_end) {
+            NameTable::Abbrev abbrev{};
+            abbrev.code = read_uleb128(p, abbrev_end);
+            if (abbrev.code == 0) {
+                break;
+            }
+            abbrev.tag = read_uleb128(p, abbrev_end);
+            while (p < abbrev_end) {
+                auto idx = read_uleb128(p, abbrev_end);
+                auto form = read_uleb128(p, abbrev_end);
+                if (idx == 0 && form == 0) {
+                    break;
+                }
+                abbrev.attrs.emplace_back(idx, form);
+            }
+            table.abbrevs.push_back(std::move(abbrev));
+        }
+        _name_tables.push_back(std::move(table));
+        pos += 4 + length;
+    }
+}
+
+// Find the unit covering pc: the last range starting at or before it, if it ends after it
+bool AcceleratorIndex::find_unit(uint64_t pc, uint64_t& unit_offset) const {
+    auto iter = std::upper_bound(_ranges.begin(), _ranges.end(), pc,
+                                 [](uint64_t addr, const AddressRange& range) { return addr < range.low; });
+    if (iter == _ranges.begin() || pc >= (--iter)->high) {
+        return false;
+    }
+    unit_offset = iter->unit;
+    return true;
+}
+
+bool AcceleratorIndex::covers_unit(uint64_t unit_offset) const {
+    return std::binary_search(_range_units.begin(), _range_units.end(), unit_offset);
+}
+
+void AcceleratorIndex::find_units(std::string_view name, std::vector<uint64_t>& unit_offsets) const {
+    if (_gdb_index != nullptr) {
+        find_units_gdb_index(name, unit_offsets);
+    }
+    for (auto& table : _name_tables) {
+        find_units_debug_names(table, name, unit_offsets);
+    }
+    std::sort(unit_offsets.begin(), unit_offsets.end());
+    unit_offsets.erase(std::unique(unit_offsets.begin(), unit_offsets.end()), unit_offsets.end());
+}
+
+// Open addressing with the hash gdb uses (case insensitive since version 5), then the CU vector of the name
+void AcceleratorIndex::find_units_gdb_index(std::string_view name, std::vector<uint64_t>& unit_offsets) const {
+    auto data = _gdb_index;
+    auto version = read<uint32_t>(data);
+    auto cu_list = read<uint32_t>(data + 4);
+    auto num_cus = (read<uint32_t>(data + 8) - cu_list) / 16;
+    auto symbol_table = read<uint32_t>(data + 16);
+    auto constant_pool = read<uint32_t>(data + (version >= 9 ? 24 : 20));
+    auto num_slots = (constant_pool - symbol_table) / 8;
+    if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0) {
+        return;
+    }
+
+    uint32_t hash = 0;
+    for (unsigned char c : name) {
+        hash = hash * 67 + std::tolower(c) - 113;
+    }
+    auto mask = num_slots - 1;
+    auto index = hash & mask;
+    auto step = ((hash * 17) & mask) | 1;
+    for (std::size_t probes = 0; probes < num_slots; probes++, index = (index + step) & mask) {
+        auto slot = data + symbol_table + index * 8;
+        auto name_offset = read<uint32_t>(slot);
+        auto vector_offset = read<uint32_t>(slot + 4);
+        if (name_offset == 0 && vector_offset == 0) {
+            return;
+        }
+        if (constant_pool + name_offset >= _gdb_index_size) {
+            return;
+        }
+        auto candidate = reinterpret_cast<const char *>(data + constant_pool + name_offset);
+        if (strnlen(candidate, _gdb_index_size - constant_pool - name_offset) != name.size() ||
+            std::memcmp(candidate, name.data(), name.size()) != 0) {
+            continue;
+        }
+
+        auto vector = data + constant_pool + vector_offset;
+        if (vector + 4 > data + _gdb_index_size) {
+            return;
+        }
+        auto count = read<uint32_t>(vector);
+        for (uint32_t i = 0; i < count && vector + 8 + i * 4 <= data + _gdb_index_size; i++) {
+            auto entry = read<uint32_t>(vector + 4 + i * 4);
+            auto cu = entry & 0xffffff;
+            auto kind = (entry >> 28) & 7;
+            if (cu < num_cus && (kind == 0 || kind == GDB_INDEX_FUNCTION)) {
+                unit_offsets.push_back(read<uint64_t>(data + cu_list + cu * 16));
+            }
+        }
+        return;
+    }
+}
+
+// Hash the name (case folded DJB), walk the names of its bucket, then decode the entries of the match
+void AcceleratorIndex::find_units_debug_names(const NameTable& table, std::string_view name,
+                                              std::vector<uint64_t>& unit_offsets) const {
+    uint32_t hash = 5381;
+    for (unsigned char c : name) {
+        hash = hash * 33 + std::tolower(c);
+    }
+
+    uint32_t first = 1, last = table.num_names;     // Name indexes are 1 based
+    if (table.num_buckets > 0) {
+        first = read<uint32_t>(table.buckets + (hash % table.num_buckets) * 4);
+        if (first == 0) {
+            return;
+        }
+    }
+    for (auto i = first; i <= last; i++) {
+        if (table.num_buckets > 0) {
+            auto name_hash = read<uint32_t>(table.hashes + (i - 1) * 4);
+            if (name_hash % table.num_buckets != hash % table.num_buckets) {
+                break;  // Past the end of the bucket
+            }
+            if (name_hash != hash) {
+                continue;
+            }
+        }
+        auto str_offset = read<uint32_t>(table.string_offsets + (i - 1) * 4);
+        if (str_offset >= _str_size || strnlen(_str + str_offset, _str_size - str_offset) != name.size() ||
+            std::memcmp(_str + str_offset, name.data(), name.size()) != 0) {
+            continue;
+        }
+
+        auto p = table.entry_pool + read<uint32_t>(table.entry_offsets + (i - 1) * 4);
+        while (p < table.end) {
+            auto code = read_uleb128(p, table.end);
+            auto abbrev = std::find_if(table.abbrevs.begin(), table.abbrevs.end(),
+                                       [&](auto& a) { return a.code == code; });
+            if (code == 0 || abbrev == table.abbrevs.end()) {
+                break;
+            }
+            uint64_t unit = 0;  // A table of a single unit may leave it out
+            bool ok = true;
+            for (auto& [idx, form] : abbrev->attrs) {
+                uint64_t value;
+                if (!read_form(p, table.end, form, value)) {
+                    ok = false;
+                    break;
+                }
+                if (idx == DW_IDX_COMPILE_UNIT) {
+                    unit = value;
+                }
+            }
+            if (!ok) {
+                break;
+            }
+            if (abbrev->tag == DW_TAG_SUBPROGRAM && unit < table.num_units) {
+                unit_offsets.push_back(read<uint32_t>(table.units + unit * 4));
+            }
+        }
+        return;
+    }
+}
@@ -0,0 +1,757 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include "AcceleratorIndex.h"
+#include "AddressIndex.h"
+#include "IndexCache.h"
+#include "Utils.h"
+#include "WorkerPool.h"
+
+constexpr int UNIT_PENDING = 0;
+constexpr int UNIT_INDEXING = 1;
+constexpr int UNIT_DONE = 2;
+constexpr int UNIT_READING_FILES = 3;   // A query holds it while it reads its file table, then hands it back
+constexpr int MAX_NAME_DEPTH = 4;   // Guards against cyclic specification/abstract_origin references
+
+// Layout of the cached index (bump when any of the structs below or in the header change)
+constexpr uint32_t CACHE_VERSION = 2;
+enum CacheSection : uint32_t {
+    CACHE_UNITS = 1,
+    CACHE_LINES,
+    CACHE_FUNCTIONS,
+    CACHE_NAMES,
+    CACHE_FILES,
+    CACHE_STRINGS,
+    CACHE_SEQUENCES,
+    CACHE_DEFERRED,
+};
+
+// An array that is either built in memory or a view of the mapped cache file
+template <typename T>
+struct Table {
+    std::vector<T> owned;
+    const T *first = nullptr;
+    std::size_t count = 0;
+
+    void own() {
+        first = owned.data();
+        count = owned.size();
+    }
+    void view(const T *data, std::size_t size) {
+        first = data;
+        count = size;
+    }
+    const T *begin() const { return first; }
+    const T *end() const { return first + count; }
+};
+
+// A function name (in the string pool of its unit, or of the cache file) and its entry address
+struct NameEntry {
+    uint32_t name;
+    uint32_t length;
+    uint64_t addr;
+};
+
+// A function whose name is declared in another unit (resolved once every unit is indexed)
+struct DeferredName {
+    uint64_t addr;
+    uint32_t die;               // Index into the DIE table of its unit
+    uint32_t cu;
+};
+
+// A line sequence and the unit it belongs to, for units the accelerator tables do not cover
+struct SequenceRange {
+    uint64_t low;
+    uint64_t high;
+    uint64_t unit;
+};
+
+struct CachedUnit {
+    uint64_t offset;            // In .debug_info
+    uint32_t first_line;
+    uint32_t num_lines;
+    uint32_t first_function;
+    uint32_t num_functions;
+    uint32_t first_name;
+    uint32_t num_names;
+    uint32_t first_deferred;
+    uint32_t num_deferred;
+};
+
+struct CachedString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// The tables of one compilation unit, written once by whichever thread indexes it (or mapped from the cache)
+struct AddressIndex::Unit {
+    std::atomic<int> state {UNIT_PENDING};
+    Table<LineRange> lines;                 // Sorted by address
+    Table<FunctionRange> functions;         // Sorted by address
+    Table<NameEntry> names;                 // Sorted by name
+    Table<DeferredName> deferred;
+    std::string name_pool;
+    const char *strings = nullptr;          // The pool the names point into
+    std::vector<std::pair<uint64_t, uint64_t>> sequences;   // Address ranges of its line sequences
+
+    // Not cached: a unit loaded from the cache walks its DIEs again the first time one is needed
+    std::vector<dwarf::die> dies;
+    bool has_dies = false;
+    std::once_flag dies_loaded;
+
+    std::string_view name(const NameEntry& entry) const { return {strings + entry.name, entry.length}; }
+};
+
+struct AddressIndex::State {
+    dwarf::dwarf dw;
+    std::vector<uint64_t> unit_offsets;     // Offset of each unit in .debug_info, ascending
+    std::vector<Unit> units;
+    AcceleratorIndex accelerator;
+    bool accelerator_complete = false;      // The address table covers every unit
+    IndexCache cache;
+
+    std::mutex mutex;                       // Guards the file table and unit completion
+    std::condition_variable unit_done;
+    std::deque<std::string> files;
+    std::unordered_map<std::string, uint32_t> file_ids;
+
+    std::once_flag merged;
+    Table<SequenceRange> sequences;         // Of all units, sorted by address (once every unit is done)
+
+    std::once_flag deferred_resolved;       // On the REPL thread, after every unit is done
+    std::vector<std::pair<std::string, uint64_t>> deferred_names;  // Sorted by name
+
+    std::atomic<std::size_t> next {0};      // Next unit for a worker to claim
+    std::atomic<std::size_t> num_done {0};
+    std::atomic<bool> cancel {false};     // Tells the jobs running in the worker pool to stop
+
+    State(const dwarf::dwarf& dw, std::size_t num_units) : dw(dw), units(num_units) {}
+
+    ~State() {
+        cancel = true;
+        WorkerPool::get().cancel(this);
+    }
+};
+
+AddressIndex::AddressIndex() = default;
+AddressIndex::~AddressIndex() = default;
+AddressIndex::AddressIndex(AddressIndex&&) noexcept = default;
+AddressIndex& AddressIndex::operator=(AddressIndex&&) noexcept = default;
+
+// Map the index from the cache, or else read the accelerator tables and start indexing the units in the background
+void AddressIndex::build(const dwarf::dwarf& dw, const elf::elf& elf) {
+    auto& cus = dw.compilation_units();
+    auto state = std::make_unique<State>(dw, cus.size());
+    for (const auto& cu : cus) {
+        state->unit_offsets.push_back(cu.get_section_offset());
+    }
+
+    state->cache = IndexCache{elf, "dwarf", CACHE_VERSION};
+    if (state->cache.load()) {
+        if (load_cache(*state)) {
+            _state = std::move(state);
+            return;
+        }
+        state->cache.invalidate();
+    }
+
+    // libelfin loads sections into a shared map on first use, so load them all before any worker runs
+    for (auto type : {dwarf::section_type::info, dwarf::section_type::abbrev, dwarf::section_type::line,
+                      dwarf::section_type::str, dwarf::section_type::ranges, dwarf::section_type::loc}) {
+        try {
+            dw.get_section(type);
+        } catch (const dwarf::format_error&) {}     // Not in this file
+    }
+
+    state->accelerator.build(elf);
+    state->accelerator_complete = !cus.empty() &&
+            std::all_of(state->unit_offsets.begin(), state->unit_offsets.end(),
+                        [&](uint64_t offset) { return state->accelerator.covers_unit(offset); });
+
+    // The REPL thread indexes the units its queries need itself, so it is not part of the pool
+    auto& pool = WorkerPool::get();
+    auto num_workers = std::min(pool.size(), cus.size());
+    for (std::size_t i = 0; i < num_workers; i++) {
+        pool.submit(state.get(), [s = state.get()] { run_worker(*s); });
+    }
+    _state = std::move(state);
+}
+
+// Point the units at the tables of the mapped cache file, checking every index into them first
+bool AddressIndex::load_cache(State& state) {
+    const CachedUnit *units;
+    const LineRange *lines;
+    const FunctionRange *functions;
+    const NameEntry *names;
+    const CachedString *files;
+    const char *strings;
+    const SequenceRange *sequences;
+    const DeferredName *deferred;
+    std::size_t num_units, num_lines, num_functions, num_names, num_files, num_strings, num_sequences, num_deferred;
+    auto& cache = state.cache;
+    if (!cache.get(CACHE_UNITS, units, num_units) || !cache.get(CACHE_LINES, lines, num_lines) ||
+        !cache.get(CACHE_FUNCTIONS, functions, num_functions) || !cache.get(CACHE_NAMES, names, num_names) ||
+        !cache.get(CACHE_FILES, files, num_files) || !cache.get(CACHE_STRINGS, strings, num_strings) ||
+        !cache.get(CACHE_SEQUENCES, sequences, num_sequences) || !cache.get(CACHE_DEFERRED, deferred, num_deferred) ||
+        num_units != state.units.size()) {
+        return false;
+    }
+
+    auto in_strings = [&](uint64_t offset, uint64_t length) { return offset + length <= num_strings; };
+    for (std::size_t i = 0; i < num_files; i++) {
+        if (!in_strings(files[i].offset, files[i].length)) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < num_names; i++) {
+        if (!in_strings(names[i].name, names[i].length)) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < num_lines; i++) {
+        if (lines[i].file >= num_files) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < num_sequences; i++) {
+        if (sequences[i].unit >= num_units) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < num_units; i++) {
+        auto& cached = units[i];
+        if (cached.offset != state.unit_offsets[i] ||
+            uint64_t{cached.first_line} + cached.num_lines > num_lines ||
+            uint64_t{cached.first_function} + cached.num_functions > num_functions ||
+            uint64_t{cached.first_name} + cached.num_names > num_names ||
+            uint64_t{cached.first_deferred} + cached.num_deferred > num_deferred) {
+            return false;
+        }
+        for (std::size_t j = cached.first_deferred; j < cached.first_deferred + cached.num_deferred; j++) {
+            if (deferred[j].cu != i) {
+                return false;
+            }
+        }
+        for (std::size_t j = cached.first_function; j < cached.first_function + cached.num_functions; j++) {
+            if (functions[j].cu != i) {
+                return false;
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < num_units; i++) {
+        auto& unit = state.units[i];
+        unit.lines.view(lines + units[i].first_line, units[i].num_lines);
+        unit.functions.view(functions + units[i].first_function, units[i].num_functions);
+        unit.names.view(names + units[i].first_name, units[i].num_names);
+        unit.deferred.view(deferred + units[i].first_deferred, units[i].num_deferred);
+        unit.strings = strings;
+        unit.state = UNIT_DONE;
+    }
+    for (std::size_t i = 0; i < num_files; i++) {
+        state.files.emplace_back(strings + files[i].offset, files[i].length);
+    }
+    state.sequences.view(sequences, num_sequences);
+    state.num_done = num_units;
+    std::call_once(state.merged, [] {});
+    return true;
+}
+
+// Write the tables of every unit to the cache, rebasing the per-unit name pools onto one string pool
+void AddressIndex::save_cache(State& state) {
+    std::vector<CachedUnit> units;
+    std::vector<LineRange> lines;
+    std::vector<FunctionRange> functions;
+    std::vector<NameEntry> names;
+    std::vector<DeferredName> deferred;
+    std::vector<CachedString> files;
+    std::string strings;
+
+    for (std::size_t i = 0; i < state.units.size(); i++) {
+        auto& unit = state.units[i];
+        units.push_back(CachedUnit{state.unit_offsets[i], static_cast<uint32_t>(lines.size()),
+                                   static_cast<uint32_t>(unit.lines.count), static_cast<uint32_t>(functions.size()),
+                                   static_cast<uint32_t>(unit.functions.count), static_cast<uint32_t>(names.size()),
+                                   static_cast<uint32_t>(unit.names.count), static_cast<uint32_t>(deferred.size()),
+                                   static_cast<uint32_t>(unit.deferred.count)});
+        lines.insert(lines.end(), unit.lines.begin(), unit.lines.end());
+        functions.insert(functions.end(), unit.functions.begin(), unit.functions.end());
+        deferred.insert(deferred.end(), unit.deferred.begin(), unit.deferred.end());
+        auto base = static_cast<uint32_t>(strings.size());
+        strings += unit.name_pool;
+        for (auto& entry : unit.names) {
+            names.push_back(NameEntry{base + entry.name, entry.length, entry.addr});
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock {state.mutex};
+        for (auto& path : state.files) {
+            files.push_back(CachedString{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(path.size())});
+            strings += path;
+        }
+    }
+
+    state.cache.save({
+        {CACHE_UNITS, units.data(), units.size() * sizeof(CachedUnit)},
+        {CACHE_LINES, lines.data(), lines.size() * sizeof(LineRange)},
+        {CACHE_FUNCTIONS, functions.data(), functions.size() * sizeof(FunctionRange)},
+        {CACHE_NAMES, names.data(), names.size() * sizeof(NameEntry)},
+        {CACHE_FILES, files.data(), files.size() * sizeof(CachedString)},
+        {CACHE_STRINGS, strings.data(), strings.size()},
+        {CACHE_SEQUENCES, state.sequences.begin(), state.sequences.count * sizeof(SequenceRange)},
+        {CACHE_DEFERRED, deferred.data(), deferred.size() * sizeof(DeferredName)},
+    });
+}
+
+// Claim units in order until all are taken
+void AddressIndex::run_worker(State& state) {
+    while (!state.cancel) {
+        auto unit = state.next++;
+        if (unit >= state.units.size()) {
+            break;
+        }
+        if (claim(state, state.units[unit])) {
+            index_unit(state, unit);
+        }
+    }
+}
+
+// Take a unit no thread has claimed for indexing, waiting for a query reading its file table to hand it back
+bool AddressIndex::claim(State& state, Unit& u) {
+    auto expected = UNIT_PENDING;
+    while (!u.state.compare_exchange_strong(expected, UNIT_INDEXING)) {
+        if (expected != UNIT_READING_FILES) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock {state.mutex};
+        state.unit_done.wait(lock, [&] { return u.state != UNIT_READING_FILES; });
+        expected = UNIT_PENDING;
+    }
+    return true;
+}
+
+// Get a unit's tables, indexing the unit on this thread if no worker has claimed it yet
+AddressIndex::Unit& AddressIndex::ensure(State& state, std::size_t unit) {
+    auto& u = state.units[unit];
+    if (u.state == UNIT_DONE) {
+        return u;
+    }
+    if (claim(state, u)) {
+        index_unit(state, unit);
+    } else {
+        std::unique_lock<std::mutex> lock {state.mutex};
+        state.unit_done.wait(lock, [&] { return u.state == UNIT_DONE; });
+    }
+    return u;
+}
+
+// Once every unit is done: merge their line sequences, then save the index for the next session
+void AddressIndex::finish(State& state) {
+    std::call_once(state.merged, [&] {
+        for (std::size_t unit = 0; unit < state.units.size(); unit++) {
+            for (auto& [low, high] : state.units[unit].sequences) {
+                state.sequences.owned.push_back(SequenceRange{low, high, unit});
+            }
+        }
+        std::sort(state.sequences.owned.begin(), state.sequences.owned.end(),
+                  [](auto& a, auto& b) { return a.low < b.low; });
+        state.sequences.own();
+        save_cache(state);
+    });
+}
+
+void AddressIndex::wait() const {
+    if (_state == nullptr) {
+        return;
+    }
+    auto& state = *_state;
+    for (std::size_t unit = 0; unit < state.units.size(); unit++) {
+        ensure(state, unit);
+    }
+    finish(state);
+}
+
+// Turn each row of a line table into the [address, next address) interval it covers. File indexes are local to
+// the unit until its paths are interned
+static void add_line_table(const dwarf::line_table& table, std::vector<AddressIndex::LineRange>& lines,
+                           std::vector<std::pair<uint64_t, uint64_t>>& sequences,
+                           std::unordered_map<std::string, uint32_t>& file_ids) {
+    bool open = false;
+    uint64_t sequence_start = 0;
+    AddressIndex::LineRange prev{};
+
+    for (const auto& entry : table) {
+        if (open && entry.address > prev.low) {    // Zero-length rows are shadowed by the row that follows them
+            prev.high = entry.address;
+            lines.push_back(prev);
+        }
+        if (!open) {
+            sequence_start = entry.address;
+        } else if (entry.end_sequence && entry.address > sequence_start) {
+            sequences.emplace_back(sequence_start, entry.address);
+        }
+
+        open = !entry.end_sequence;
+        if (open) {
+            auto id = file_ids.emplace(entry.file->path, static_cast<uint32_t>(file_ids.size())).first->second;
+            prev = AddressIndex::LineRange{entry.address, 0, entry.line, id, entry.is_stmt};
+        }
+    }
+}
+
+// Subprograms with code (not just declarations), in the order their DIEs are numbered
+static bool has_code(const dwarf::die& die) {
+    return die.tag == dwarf::DW_TAG::subprogram && (die.has(dwarf::DW_AT::low_pc) || die.has(dwarf::DW_AT::ranges));
+}
+
+// Whether a reference stays within the unit of its DIE (DW_FORM_ref_addr and the like may point anywhere)
+static bool is_local_reference(const dwarf::value& value) {
+    auto form = value.get_form();
+    return form == dwarf::DW_FORM::ref1 || form == dwarf::DW_FORM::ref2 || form == dwarf::DW_FORM::ref4 ||
+           form == dwarf::DW_FORM::ref8 || form == dwarf::DW_FORM::ref_udata;
+}
+
+// Name of a subprogram; an out-of-line definition or instance takes it from its declaration. With cross_unit,
+// a declaration in another unit is not followed (following it makes libelfin load that unit, which another thread
+// may be parsing): cross_unit is set instead
+static std::string function_name(const dwarf::die& die, bool *cross_unit = nullptr, int depth = 0) {
+    if (die.has(dwarf::DW_AT::name)) {
+        return dwarf::at_name(die);
+    }
+    for (auto attr : {dwarf::DW_AT::specification, dwarf::DW_AT::abstract_origin}) {
+        if (die.has(attr) && depth < MAX_NAME_DEPTH) {
+            auto value = die[attr];
+            if (cross_unit != nullptr && !is_local_reference(value)) {
+                *cross_unit = true;
+                return "";
+            }
+            return function_name(value.as_reference(), cross_unit, depth + 1);
+        }
+    }
+    return "";
+}
+
+// Build the tables of one unit, then publish it to the queries waiting for it
+void AddressIndex::index_unit(State& state, std::size_t unit) {
+    auto& u = state.units[unit];
+    const auto& cu = state.dw.compilation_units()[unit];
+    std::unordered_map<std::string, uint32_t> file_ids;
+
+    try {
+        add_line_table(cu.get_line_table(), u.lines.owned, u.sequences, file_ids);
+
+        for (const auto& die : cu.root()) {
+            if (!has_code(die)) {
+                continue;
+            }
+            auto die_idx = static_cast<uint32_t>(u.dies.size());
+            u.dies.push_back(die);
+            auto entry = UINT64_MAX;
+            for (auto range : die_pc_range(die)) {
+                if (range.second > range.first) {
+                    u.functions.owned.push_back(FunctionRange{range.first, range.second, die_idx,
+                                                              static_cast<uint32_t>(unit)});
+                    entry = std::min(entry, range.first);
+                }
+            }
+            if (die.has(dwarf::DW_AT::low_pc)) {
+                entry = dwarf::at_low_pc(die);
+            }
+            bool cross_unit = false;
+            auto name = function_name(die, &cross_unit);
+            if (cross_unit && entry != UINT64_MAX) {
+                u.deferred.owned.push_back(DeferredName{entry, die_idx, static_cast<uint32_t>(unit)});
+            } else if (!name.empty() && entry != UINT64_MAX) {
+                u.names.owned.push_back(NameEntry{static_cast<uint32_t>(u.name_pool.size()),
+                                                  static_cast<uint32_t>(name.size()), entry});
+                u.name_pool += name;
+            }
+        }
+    } catch (const std::exception&) {}  // A malformed unit keeps whatever was read before the error
+    u.has_dies = true;
+
+    auto by_address = [](auto& a, auto& b) { return a.low < b.low || (a.low == b.low && a.high < b.high); };
+    std::sort(u.lines.owned.begin(), u.lines.owned.end(), by_address);
+    std::sort(u.functions.owned.begin(), u.functions.owned.end(), by_address);
+    u.strings = u.name_pool.data();
+    std::sort(u.names.owned.begin(), u.names.owned.end(),
+              [&](auto& a, auto& b) { return u.name(a) < u.name(b); });
+    u.lines.owned.shrink_to_fit();
+    u.functions.owned.shrink_to_fit();
+    u.lines.own();
+    u.functions.own();
+    u.names.own();
+    u.deferred.own();
+
+    // Intern the unit's paths into the shared file table, then switch its rows over to the shared ids
+    std::vector<uint32_t> global_ids(file_ids.size());
+    {
+        std::lock_guard<std::mutex> lock {state.mutex};
+        for (auto& [path, id] : file_ids) {
+            auto ins = state.file_ids.emplace(path, static_cast<uint32_t>(state.files.size()));
+            if (ins.second) {
+                state.files.push_back(path);
+            }
+            global_ids[id] = ins.first->second;
+        }
+    }
+    for (auto& line : u.lines.owned) {
+        line.file = global_ids[line.file];
+    }
+
+    {
+        std::lock_guard<std::mutex> lock {state.mutex};
+        u.state = UNIT_DONE;
+    }
+    state.unit_done.notify_all();
+
+    if (++state.num_done == state.units.size()) {
+        finish(state);
+    }
+}
+
+// Binary search for the last interval starting at or before pc, then check that it covers pc
+template <typename T>
+static const T* find_covering(const Table<T>& table, uint64_t pc) {
+    auto iter = std::upper_bound(table.begin(), table.end(), pc,
+                                 [](uint64_t addr, const T& entry) { return addr < entry.low; });
+    if (iter == table.begin()) {
+        return nullptr;
+    }
+    --iter;
+    return pc < iter->high ? iter : nullptr;
+}
+
+// Get the (indexed) unit covering pc. Without an accelerator entry, this waits for every unit to be indexed
+// unless the accelerator tables are known to cover all of them
+const AddressIndex::Unit* AddressIndex::unit_for(uint64_t pc) const {
+    if (_state == nullptr) {
+        return nullptr;
+    }
+    auto& state = *_state;
+    uint64_t offset;
+    if (state.accelerator.find_unit(pc, offset)) {
+        auto iter = std::lower_bound(state.unit_offsets.begin(), state.unit_offsets.end(), offset);
+        if (iter != state.unit_offsets.end() && *iter == offset) {
+            return &ensure(state, iter - state.unit_offsets.begin());
+        }
+    }
+    if (state.accelerator_complete) {
+        return nullptr;
+    }
+    wait();
+    auto sequence = find_covering(state.sequences, pc);
+    return sequence != nullptr ? &state.units[sequence->unit] : nullptr;
+}
+
+// Get the line table row covering pc
+const AddressIndex::LineRange* AddressIndex::find_line(uint64_t pc) const {
+    auto unit = unit_for(pc);
+    return unit != nullptr ? find_covering(unit->lines, pc) : nullptr;
+}
+
+// Get the subprogram range covering pc
+const AddressIndex::FunctionRange* AddressIndex::find_function(uint64_t pc) const {
+    auto unit = unit_for(pc);
+    return unit != nullptr ? find_covering(unit->functions, pc) : nullptr;
+}
+
+// Get the line table rows (of the unit of low) whose start address is within [low, high)
+std::pair<const AddressIndex::LineRange*, const AddressIndex::LineRange*>
+AddressIndex::lines_in(uint64_t low, uint64_t high) const {
+    auto unit = unit_for(low);
+    if (unit == nullptr) {
+        return {nullptr, nullptr};
+    }
+    auto cmp = [](const LineRange& entry, uint64_t addr) { return entry.low < addr; };
+    auto first = std::lower_bound(unit->lines.begin(), unit->lines.end(), low, cmp);
+    auto last = std::lower_bound(first, unit->lines.end(), high, cmp);
+    return {first, last};
+}
+
+// Get the line table of every unit, once all are indexed
+std::vector<std::pair<const AddressIndex::LineRange*, const AddressIndex::LineRange*>> AddressIndex::all_lines() const {
+    std::vector<std::pair<const LineRange*, const LineRange*>> tables;
+    if (_state == nullptr) {
+        return tables;
+    }
+    wait();
+    for (auto& unit : _state->units) {
+        tables.emplace_back(unit.lines.begin(), unit.lines.end());
+    }
+    return tables;
+}
+
+// Get the row after the given one
+const AddressIndex::LineRange* AddressIndex::next_line(const LineRange* entry) const {
+    auto unit = unit_for(entry->low);
+    if (unit == nullptr) {
+        return nullptr;
+    }
+    auto next = entry + 1;
+    return entry >= unit->lines.begin() && next < unit->lines.end() ? next : nullptr;
+}
+
+// Look a function up in the units the name tables list for it (or in every unit if there are no name tables)
+bool AddressIndex::find_function_by_name(const std::string& name, uint64_t& addr) const {
+    if (_state == nullptr) {
+        return false;
+    }
+    auto& state = *_state;
+    std::vector<std::size_t> units;
+    if (state.accelerator.has_names()) {
+        std::vector<uint64_t> offsets;
+        state.accelerator.find_units(name, offsets);
+        for (auto offset : offsets) {
+            auto iter = std::lower_bound(state.unit_offsets.begin(), state.unit_offsets.end(), offset);
+            if (iter != state.unit_offsets.end() && *iter == offset) {
+                units.push_back(iter - state.unit_offsets.begin());
+            }
+        }
+    } else {
+        for (std::size_t unit = 0; unit < state.units.size(); unit++) {
+            units.push_back(unit);
+        }
+    }
+
+    bool has_deferred = false;
+    for (auto idx : units) {
+        auto& unit = ensure(state, idx);
+        auto iter = std::lower_bound(unit.names.begin(), unit.names.end(), name,
+                                     [&](auto& entry, const std::string& n) { return unit.name(entry) < n; });
+        if (iter != unit.names.end() && unit.name(*iter) == name) {
+            addr = iter->addr;
+            return true;
+        }
+        has_deferred |= unit.deferred.count != 0;
+    }
+    if (!has_deferred) {
+        return false;
+    }
+
+    // Names declared in another unit are resolved here, once no worker is parsing units any more
+    wait();
+    std::call_once(state.deferred_resolved, [&] {
+        for (auto& unit : state.units) {
+            for (auto& deferred : unit.deferred) {
+                try {
+                    auto resolved = function_name(function_die(FunctionRange{0, 0, deferred.die, deferred.cu}));
+                    if (!resolved.empty()) {
+                        state.deferred_names.emplace_back(resolved, deferred.addr);
+                    }
+                } catch (const std::exception&) {}
+            }
+        }
+        std::sort(state.deferred_names.begin(), state.deferred_names.end());
+    });
+    auto iter = std::lower_bound(state.deferred_names.begin(), state.deferred_names.end(), name,
+                                 [](auto& entry, const std::string& n) { return entry.first < n; });
+    if (iter != state.deferred_names.end() && iter->first == name) {
+        addr = iter->second;
+        return true;
+    }
+    return false;
+}
+
+// Whether the file table of a unit's line table has a path ending in file. A unit no thread has claimed is held while
+// the table is read (its indexing reuses it); one already claimed counts as a match, and is waited for by the caller
+bool AddressIndex::unit_has_file(State& state, std::size_t unit, const std::string& file) {
+    auto& u = state.units[unit];
+    auto expected = UNIT_PENDING;
+    if (!u.state.compare_exchange_strong(expected, UNIT_READING_FILES)) {
+        return true;
+    }
+    bool found = false;
+    try {
+        auto& table = state.dw.compilation_units()[unit].get_line_table();
+        for (unsigned i = 0; !found; i++) {
+            found = Utils::is_suffixed_by(file, table.get_file(i)->path);
+        }
+    } catch (const std::out_of_range&) {    // Past the last file
+    } catch (const std::exception&) {
+        found = true;   // Let the indexing deal with it
+    }
+    {
+        std::lock_guard<std::mutex> lock {state.mutex};
+        u.state = UNIT_PENDING;
+    }
+    state.unit_done.notify_all();
+    return found;
+}
+
+// Find the lowest addressed statement of a line, in the first unit that has one. Only the units whose line table
+// lists the file are waited for
+bool AddressIndex::find_source_line(const std::string& file, unsigned line, uint64_t& addr) const {
+    if (_state == nullptr) {
+        return false;
+    }
+    auto& state = *_state;
+    std::vector<std::size_t> units;
+    for (std::size_t unit = 0; unit < state.units.size(); unit++) {
+        if (state.units[unit].state == UNIT_DONE || unit_has_file(state, unit, file)) {
+            ensure(state, unit);
+            units.push_back(unit);
+        }
+    }
+
+    std::vector<bool> matches;
+    {
+        std::lock_guard<std::mutex> lock {state.mutex};
+        for (auto& path : state.files) {
+            matches.push_back(Utils::is_suffixed_by(file, path));
+        }
+    }
+
+    for (auto idx : units) {
+        for (auto& entry : state.units[idx].lines) {
+            if (entry.is_stmt && entry.line == line && matches[entry.file]) {
+                addr = entry.low;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+const std::string& AddressIndex::file_path(const LineRange& entry) const {
+    std::lock_guard<std::mutex> lock {_state->mutex};
+    return _state->files[entry.file];   // Elements of a deque stay put as it grows
+}
+
+// Get the DIE of a function, walking its unit again if the unit came from the cache
+const dwarf::die& AddressIndex::function_die(const FunctionRange& entry) const {
+    auto& state = *_state;
+    auto& unit = state.units[entry.cu];
+    if (!unit.has_dies) {
+        std::call_once(unit.dies_loaded, [&] {
+            try {
+                for (const auto& die : state.dw.compilation_units()[entry.cu].root()) {
+                    if (has_code(die)) {
+                        unit.dies.push_back(die);
+                    }
+                }
+            } catch (const std::exception&) {}
+        });
+    }
+    if (entry.die >= unit.dies.size()) {
+        throw std::out_of_range{"Cannot find the DIE of a cached function"};
+    }
+    return unit.dies[entry.die];
+}
+
+IndexCache::Status AddressIndex::get_cache_status() const {
+    return _state != nullptr ? _state->cache.get_status() : IndexCache::Status::Disabled;
+}
+
+const std::string& AddressIndex::get_cache_path() const {
+    static const std::string none;
+    return _state != nullptr ? _state->cache.get_path() : none;
+}
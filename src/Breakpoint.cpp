@@ -2,31 +2,75 @@
 // Created by alexcons on 22/05/2021.
 //
 
-#include <sys/ptrace.h>
+#include <algorithm>
+#include <chrono>
 #include "Breakpoint.h"
 
-// Enable the breakpoint by replacing the byte at the address with INT3
-void Breakpoint::enable() {
+// Enable the breakpoint by replacing the byte at the address with INT3.
+// Goes through the memory layer rather than PTRACE_PEEKDATA/POKEDATA, which need the thread _pid to be stopped.
+void Breakpoint::enable(ProcessMemory& memory) {
     if (!_enabled) {
         // Read byte at the given address of the debuggee process' memory
-        auto data = ptrace(PTRACE_PEEKDATA, _pid, _addr, nullptr);
-        _saved_byte = static_cast<uint8_t>(data & 0xff);  // Only want the bottom byte
+        if (memory.read(_addr, &_saved_byte, 1) != 1) {
+            return;
+        }
 
         // Write int3 instruction into process' memory at the breakpoint address
-        ptrace(PTRACE_POKEDATA, _pid, _addr, (data & ~0xff) | BREAKPOINT_INT3);
-        _enabled = true;
+        uint8_t int3 = BREAKPOINT_INT3;
+        _enabled = memory.write_forced(_addr, &int3, 1) == 1;
     }
 }
 
 // Disable the breakpoint by restoring the saved byte back at the address
-void Breakpoint::disable() {
+void Breakpoint::disable(ProcessMemory& memory) {
     if (_enabled) {
-        // Read byte at the given address of the process' memory
-        auto data = ptrace(PTRACE_PEEKDATA, _pid, _addr, nullptr);
-        auto restored_byte = (data & ~0xff) | _saved_byte;
-
         // Write the saved byte back in place of the INT3 instruction
-        ptrace(PTRACE_POKEDATA, _pid, _addr, restored_byte);
-        _enabled = false;
+        _enabled = memory.write_forced(_addr, &_saved_byte, 1) != 1;
+    }
+}
+
+// Count a hit and decide whether it should be reported: the condition (if any) must hold and the ignore
+// count must be used up
+bool Breakpoint::should_stop(const user_regs_struct& regs, ProcessMemory& memory) {
+    _hit_count++;
+
+    if (_condition) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = _condition->evaluate(regs, memory);
+        auto end = std::chrono::steady_clock::now();
+        _eval_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        _eval_count++;
+        if (result == 0) {
+            return false;
+        }
+    }
+
+    if (_ignore_count > 0) {
+        _ignore_count--;
+        return false;
     }
+    return true;
+}
+
+// Enable all the given breakpoints (already enabled ones are skipped)
+void Breakpoint::enable_all(ProcessMemory& memory, std::vector<Breakpoint*>& bps) {
+    patch_all(memory, bps, true);
+}
+
+// Disable all the given breakpoints, restoring their original bytes
+void Breakpoint::disable_all(ProcessMemory& memory, std::vector<Breakpoint*>& bps) {
+    patch_all(memory, bps, false);
+}
+
+// Leave out the breakpoints already in that state, then patch the rest a page at a time
+void Breakpoint::patch_all(ProcessMemory& memory, std::vector<Breakpoint*>& bps, bool enable) {
+    bps.erase(std::remove_if(bps.begin(), bps.end(), [enable](Breakpoint* bp) { return bp->_enabled == enable; }),
+              bps.end());
+    std::sort(bps.begin(), bps.end(), [](Breakpoint* a, Breakpoint* b) { return a->_addr < b->_addr; });
+    // The same breakpoint twice would save the int3 patched in for the first as its original byte
+    bps.erase(std::unique(bps.begin(), bps.end()), bps.end());
+
+    patch_int3s(memory, bps, enable, [](Breakpoint* bp) { return bp->_addr; },
+                [](Breakpoint* bp) -> uint8_t& { return bp->_saved_byte; },
+                [](Breakpoint* bp) -> bool& { return bp->_enabled; });
 }
@@ -0,0 +1,169 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <cctype>
+#include <stdexcept>
+#include "Condition.h"
+#include "Registers.h"
+
+// Precedence climbing parser emitting postfix bytecode
+struct Condition::Parser {
+    const std::string& src;
+    std::size_t pos = 0;
+    std::vector<Instr>& code;
+    std::size_t depth = 0;      // Stack depth the code emitted so far will reach
+
+    void emit(Op op, uint64_t imm = 0) {
+        code.push_back(Instr{op, imm});
+        if (op == Op::Const || op == Op::Reg) {
+            if (++depth > MAX_STACK) throw std::invalid_argument{"Condition is too deeply nested"};
+        } else if (op >= Op::Mul) {
+            depth--;    // Binary operators pop two values and push one
+        }
+    }
+
+    void skip_spaces() {
+        while (pos < src.size() && std::isspace(static_cast<unsigned char>(src[pos]))) pos++;
+    }
+
+    bool accept(const char *tok) {
+        skip_spaces();
+        auto len = std::char_traits<char>::length(tok);
+        if (src.compare(pos, len, tok) != 0) return false;
+        // Do not take '&' from '&&', '<' from '<<' or '<=', etc.
+        if (len == 1 && pos + 1 < src.size()) {
+            auto next = src[pos + 1];
+            if ((tok[0] == '&' || tok[0] == '|') && next == tok[0]) return false;
+            if ((tok[0] == '<' || tok[0] == '>') && (next == tok[0] || next == '=')) return false;
+            if ((tok[0] == '!' || tok[0] == '=') && next == '=') return false;
+        }
+        pos += len;
+        return true;
+    }
+
+    [[noreturn]] void fail(const std::string& what) {
+        throw std::invalid_argument{what + " at position " + std::to_string(pos) + " of condition '" + src + "'"};
+    }
+
+    void parse_primary() {
+        skip_spaces();
+        if (pos >= src.size()) fail("Unexpected end");
+
+        if (accept("(")) {
+            parse_binary(0);
+            if (!accept(")")) fail("Expected ')'");
+        } else if (std::isdigit(static_cast<unsigned char>(src[pos]))) {
+            std::size_t len;
+            auto val = std::stoull(src.substr(pos), &len, 0);
+            pos += len;
+            emit(Op::Const, val);
+        } else {
+            if (src[pos] == '$') pos++;
+            auto start = pos;
+            while (pos < src.size() && (std::isalnum(static_cast<unsigned char>(src[pos])) || src[pos] == '_')) pos++;
+            if (start == pos) fail("Expected a number, register or '('");
+            try {
+                auto r = get_reg_from_name(src.substr(start, pos - start));
+                emit(Op::Reg, reg_indices[static_cast<std::size_t>(r)]);
+            } catch (const std::out_of_range&) {
+                fail("Unknown register '" + src.substr(start, pos - start) + "'");
+            }
+        }
+    }
+
+    void parse_unary() {
+        if (accept("-")) { parse_unary(); emit(Op::Neg); }
+        else if (accept("!")) { parse_unary(); emit(Op::Not); }
+        else if (accept("~")) { parse_unary(); emit(Op::BitNot); }
+        else if (accept("*")) { parse_unary(); emit(Op::Deref); }
+        else parse_primary();
+    }
+
+    // Binary operators by increasing precedence level
+    struct BinaryOp { const char *tok; int prec; Op op; };
+
+    void parse_binary(int min_prec) {
+        static const BinaryOp ops[] = {
+            {"||", 1, Op::Or}, {"&&", 2, Op::And}, {"|", 3, Op::BitOr}, {"^", 4, Op::BitXor}, {"&", 5, Op::BitAnd},
+            {"==", 6, Op::Eq}, {"!=", 6, Op::Ne}, {"<=", 7, Op::Le}, {">=", 7, Op::Ge}, {"<<", 8, Op::Shl},
+            {">>", 8, Op::Shr}, {"<", 7, Op::Lt}, {">", 7, Op::Gt}, {"+", 9, Op::Add}, {"-", 9, Op::Sub},
+            {"*", 10, Op::Mul}, {"/", 10, Op::Div}, {"%", 10, Op::Mod},
+        };
+
+        parse_unary();
+        while (true) {
+            const BinaryOp *found = nullptr;
+            auto saved = pos;
+            for (auto& op : ops) {
+                if (op.prec >= min_prec && accept(op.tok)) {
+                    found = &op;
+                    break;
+                }
+                pos = saved;
+            }
+            if (found == nullptr) return;
+            parse_binary(found->prec + 1);  // All operators are left associative
+            emit(found->op);
+        }
+    }
+};
+
+// Compile a condition, throwing std::invalid_argument on syntax errors
+Condition Condition::compile(const std::string& source) {
+    Condition cond;
+    cond._source = source;
+    Parser parser{source, 0, cond._code};
+    parser.parse_binary(0);
+    parser.skip_spaces();
+    if (parser.pos != source.size()) {
+        parser.fail("Unexpected character");
+    }
+    cond._code.shrink_to_fit();
+    return cond;
+}
+
+// Evaluate the condition against the registers and memory of a stopped thread
+uint64_t Condition::evaluate(const user_regs_struct& regs, ProcessMemory& memory) const {
+    uint64_t stack[MAX_STACK];
+    std::size_t sp = 0;
+    auto words = reinterpret_cast<const uint64_t *>(&regs);
+
+    for (auto& instr : _code) {
+        switch (instr.op) {
+            case Op::Const: stack[sp++] = instr.imm; continue;
+            case Op::Reg: stack[sp++] = words[instr.imm]; continue;
+            case Op::Deref: stack[sp - 1] = memory.read_word(stack[sp - 1]); continue;
+            case Op::Neg: stack[sp - 1] = -stack[sp - 1]; continue;
+            case Op::Not: stack[sp - 1] = !stack[sp - 1]; continue;
+            case Op::BitNot: stack[sp - 1] = ~stack[sp - 1]; continue;
+            default: break;
+        }
+
+        auto b = stack[--sp];
+        auto& a = stack[sp - 1];
+        auto sa = static_cast<int64_t>(a), sb = static_cast<int64_t>(b);
+        switch (instr.op) {
+            case Op::Mul: a = a * b; break;
+            case Op::Div: a = b == 0 ? 0 : static_cast<uint64_t>(sa / sb); break;
+            case Op::Mod: a = b == 0 ? 0 : static_cast<uint64_t>(sa % sb); break;
+            case Op::Add: a = a + b; break;
+            case Op::Sub: a = a - b; break;
+            case Op::Shl: a = b >= 64 ? 0 : a << b; break;
+            case Op::Shr: a = b >= 64 ? 0 : a >> b; break;
+            case Op::Lt: a = sa < sb; break;
+            case Op::Le: a = sa <= sb; break;
+            case Op::Gt: a = sa > sb; break;
+            case Op::Ge: a = sa >= sb; break;
+            case Op::Eq: a = a == b; break;
+            case Op::Ne: a = a != b; break;
+            case Op::BitAnd: a = a & b; break;
+            case Op::BitXor: a = a ^ b; break;
+            case Op::BitOr: a = a | b; break;
+            case Op::And: a = a && b; break;
+            case Op::Or: a = a || b; break;
+            default: break;
+        }
+    }
+    return sp > 0 ? stack[sp - 1] : 0;
+}
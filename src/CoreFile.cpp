@@ -0,0 +1,408 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/procfs.h>
+#include <sys/ptrace.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "CoreFile.h"
+#include "Utils.h"
+#include "Stats.h"
+
+constexpr std::size_t DUMP_CHUNK_SIZE = 4 * 1024 * 1024;  // Memory copied per bulk read while dumping
+constexpr const char *NOTE_NAME = "CORE";
+
+static_assert(sizeof(elf_gregset_t) == sizeof(user_regs_struct), "NT_PRSTATUS registers are a user_regs_struct");
+
+// A mapping of /proc/<pid>/maps, and where it goes in the core
+struct Region {
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    uint32_t flags;     // PF_R, PF_W, PF_X
+    bool dumped;        // Contents are written (unreadable mappings only take up address space)
+    std::string path;
+};
+
+static std::vector<Region> read_regions(pid_t pid) {
+    std::vector<Region> regions;
+    for (auto& map : Utils::read_maps(pid)) {
+        auto& perms = map.perms;
+        Region region{};
+        region.start = map.start;
+        region.end = map.end;
+        region.offset = map.offset;
+        region.flags = (perms[0] == 'r' ? PF_R : 0) | (perms[1] == 'w' ? PF_W : 0) | (perms[2] == 'x' ? PF_X : 0);
+        // The kernel's own pages cannot be read through the process (and are the same in every process)
+        region.dumped = perms[0] == 'r' && map.path.compare(0, 5, "[vvar") != 0 && map.path != "[vsyscall]";
+        region.path = map.path;
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream ifs{path, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+}
+
+// Append an ELF note (name and descriptor are padded to 4 bytes)
+static void add_note(std::string& notes, uint32_t type, const void *desc, std::size_t len) {
+    Elf64_Nhdr header{};
+    header.n_namesz = std::strlen(NOTE_NAME) + 1;
+    header.n_descsz = len;
+    header.n_type = type;
+    notes.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    notes.append(NOTE_NAME, header.n_namesz);
+    notes.resize((notes.size() + 3) & ~3ul, '\0');
+    notes.append(static_cast<const char *>(desc), len);
+    notes.resize((notes.size() + 3) & ~3ul, '\0');
+}
+
+// NT_PRSTATUS followed by NT_FPREGSET (the FP registers belong to the thread of the preceding NT_PRSTATUS)
+static void add_thread_notes(std::string& notes, const CoreFile::ThreadState& thread) {
+    elf_prstatus status{};
+    status.pr_pid = thread.tid;
+    status.pr_cursig = thread.signal;
+    status.pr_info.si_signo = thread.signal;
+    std::memcpy(&status.pr_reg, &thread.regs, sizeof(thread.regs));
+    status.pr_fpvalid = 1;
+    add_note(notes, NT_PRSTATUS, &status, sizeof(status));
+
+    user_fpregs_struct fpregs{};
+    Stats::ptrace(PTRACE_GETFPREGS, thread.tid, nullptr, &fpregs);
+    add_note(notes, NT_FPREGSET, &fpregs, sizeof(fpregs));
+}
+
+// NT_FILE: the file mappings, so a debugger can find the executable and shared libraries
+static void add_file_note(std::string& notes, const std::vector<Region>& regions, std::size_t page_size) {
+    std::vector<uint64_t> entries;
+    std::string names;
+    for (auto& region : regions) {
+        if (region.path.empty() || region.path[0] != '/') {
+            continue;
+        }
+        entries.insert(entries.end(), {region.start, region.end, region.offset / page_size});
+        names.append(region.path.c_str(), region.path.size() + 1);
+    }
+    std::string desc;
+    uint64_t header[2] = {entries.size() / 3, page_size};
+    desc.append(reinterpret_cast<const char *>(header), sizeof(header));
+    desc.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(uint64_t));
+    desc += names;
+    add_note(notes, NT_FILE, desc.data(), desc.size());
+}
+
+static void write_all(int fd, const void *buf, std::size_t len, off_t offset) {
+    auto p = static_cast<const char *>(buf);
+    while (len > 0) {
+        auto n = pwrite(fd, p, len, offset);
+        if (n <= 0) {
+            throw std::invalid_argument{std::string{"Could not write core file: "} + std::strerror(errno)};
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+// Copy a region into the core a chunk at a time, writing only the runs of pages that are not all zero
+static uint64_t dump_region(int fd, ProcessMemory& memory, const Region& region, uint64_t file_offset,
+                            std::vector<uint8_t>& buf, std::size_t page_size) {
+    uint64_t written = 0;
+    for (auto addr = region.start; addr < region.end; addr += buf.size()) {
+        auto len = std::min<uint64_t>(buf.size(), region.end - addr);
+        std::size_t got = 0;
+        while (got < len) {
+            got += memory.read(addr + got, buf.data() + got, len - got);
+            if (got < len) {
+                // Skip the page that could not be read (it stays a hole, i.e. zeros)
+                auto skip = std::min<uint64_t>(page_size - (addr + got) % page_size, len - got);
+                std::memset(buf.data() + got, 0, skip);
+                got += skip;
+            }
+        }
+
+        std::size_t run_start = 0;
+        for (std::size_t off = 0; off <= len; off += page_size) {
+            bool zero = true;
+            if (off < len) {
+                auto words = reinterpret_cast<const uint64_t *>(buf.data() + off);
+                auto num_words = std::min<uint64_t>(page_size, len - off) / sizeof(uint64_t);
+                zero = std::all_of(words, words + num_words, [](uint64_t w) { return w == 0; });
+            }
+            if (zero) {
+                if (off > run_start) {
+                    write_all(fd, buf.data() + run_start, off - run_start, file_offset + (addr - region.start) + run_start);
+                    written += off - run_start;
+                }
+                run_start = off + page_size;
+            }
+        }
+    }
+    return written;
+}
+
+// Write the core: ELF header, program headers (PT_NOTE, then one PT_LOAD per mapping), notes, then the memory
+// of each mapping at a page aligned offset. Returns the number of bytes of memory written (the rest are holes)
+uint64_t CoreFile::dump(pid_t pid, ProcessMemory& memory, const std::vector<ThreadState>& threads,
+                        const std::string& path) {
+    auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto regions = read_regions(pid);
+    auto proc = "/proc/" + std::to_string(pid);
+
+    std::string notes;
+    if (!threads.empty()) {
+        add_thread_notes(notes, threads[0]);
+    }
+    elf_prpsinfo info{};
+    info.pr_pid = pid;
+    info.pr_sname = 't';
+    auto comm = read_file(proc + "/comm");
+    std::strncpy(info.pr_fname, comm.substr(0, comm.find('\n')).c_str(), sizeof(info.pr_fname) - 1);
+    auto args = read_file(proc + "/cmdline");
+    std::replace(args.begin(), args.end(), '\0', ' ');
+    std::strncpy(info.pr_psargs, args.c_str(), sizeof(info.pr_psargs) - 1);
+    add_note(notes, NT_PRPSINFO, &info, sizeof(info));
+    auto auxv = read_file(proc + "/auxv");
+    add_note(notes, NT_AUXV, auxv.data(), auxv.size());
+    add_file_note(notes, regions, page_size);
+    for (std::size_t i = 1; i < threads.size(); i++) {
+        add_thread_notes(notes, threads[i]);
+    }
+
+    Elf64_Ehdr ehdr{};
+    std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_ident[EI_OSABI] = ELFOSABI_NONE;
+    ehdr.e_type = ET_CORE;
+    ehdr.e_machine = EM_X86_64;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_phoff = sizeof(ehdr);
+    ehdr.e_ehsize = sizeof(ehdr);
+    ehdr.e_phentsize = sizeof(Elf64_Phdr);
+    ehdr.e_phnum = regions.size() + 1;
+
+    std::vector<Elf64_Phdr> phdrs(regions.size() + 1);
+    uint64_t offset = sizeof(ehdr) + phdrs.size() * sizeof(Elf64_Phdr);
+    phdrs[0].p_type = PT_NOTE;
+    phdrs[0].p_offset = offset;
+    phdrs[0].p_filesz = notes.size();
+    offset += notes.size();
+    for (std::size_t i = 0; i < regions.size(); i++) {
+        offset = (offset + page_size - 1) & ~(page_size - 1);
+        auto& phdr = phdrs[i + 1];
+        phdr.p_type = PT_LOAD;
+        phdr.p_flags = regions[i].flags;
+        phdr.p_offset = offset;
+        phdr.p_vaddr = regions[i].start;
+        phdr.p_memsz = regions[i].end - regions[i].start;
+        phdr.p_filesz = regions[i].dumped ? phdr.p_memsz : 0;
+        phdr.p_align = page_size;
+        offset += phdr.p_filesz;
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        throw std::invalid_argument{"Could not create " + path + ": " + std::strerror(errno)};
+    }
+    uint64_t written = 0;
+    try {
+        write_all(fd, &ehdr, sizeof(ehdr), 0);
+        write_all(fd, phdrs.data(), phdrs.size() * sizeof(Elf64_Phdr), sizeof(ehdr));
+        write_all(fd, notes.data(), notes.size(), static_cast<off_t>(phdrs[0].p_offset));
+
+        std::vector<uint8_t> buf(DUMP_CHUNK_SIZE);
+        for (std::size_t i = 0; i < regions.size(); i++) {
+            if (regions[i].dumped) {
+                written += dump_region(fd, memory, regions[i], phdrs[i + 1].p_offset, buf, page_size);
+            }
+        }
+        // Trailing zero pages were skipped too, so set the size explicitly
+        if (ftruncate(fd, static_cast<off_t>(offset)) == -1) {
+            throw std::invalid_argument{std::string{"Could not write core file: "} + std::strerror(errno)};
+        }
+    } catch (const std::invalid_argument&) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return written;
+}
+
+// Map a core file read-only and index its segments and notes
+CoreFile::CoreFile(const std::string& path) {
+    int fd = Stats::timed(Stats::Call::FileRead, [&] { return open(path.c_str(), O_RDONLY | O_CLOEXEC); });
+    struct stat st{};
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        throw std::invalid_argument{"Could not open " + path + ": " + std::strerror(errno)};
+    }
+    _size = st.st_size;
+    auto map = Stats::timed(Stats::Call::FileRead, [&] {
+        auto map = _size != 0 ? mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        return map;
+    });
+    if (map == MAP_FAILED) {
+        throw std::invalid_argument{"Could not map " + path};
+    }
+    _data = static_cast<const uint8_t *>(map);
+
+    auto fail = [&](const std::string& reason) {
+        munmap(const_cast<uint8_t *>(_data), _size);
+        throw std::invalid_argument{path + " is not a core file: " + reason};
+    };
+    auto& ehdr = *reinterpret_cast<const Elf64_Ehdr *>(_data);
+    if (_size < sizeof(ehdr) || std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 || ehdr.e_ident[EI_CLASS] != ELFCLASS64) {
+        fail("not a 64 bit ELF file");
+    }
+    if (ehdr.e_type != ET_CORE || ehdr.e_machine != EM_X86_64) {
+        fail("not an x86-64 core");
+    }
+    if (ehdr.e_phentsize != sizeof(Elf64_Phdr) || ehdr.e_phoff + ehdr.e_phnum * sizeof(Elf64_Phdr) > _size) {
+        fail("truncated program headers");
+    }
+
+    auto phdrs = reinterpret_cast<const Elf64_Phdr *>(_data + ehdr.e_phoff);
+    for (std::size_t i = 0; i < ehdr.e_phnum; i++) {
+        auto& phdr = phdrs[i];
+        // Contents cut off by a truncated file read as zeros
+        auto filesz = phdr.p_offset < _size ? std::min<uint64_t>(phdr.p_filesz, _size - phdr.p_offset) : 0;
+        if (phdr.p_type == PT_LOAD) {
+            _segments.push_back(Segment{phdr.p_vaddr, phdr.p_memsz, filesz, phdr.p_offset});
+        } else if (phdr.p_type == PT_NOTE) {
+            parse_notes(_data + phdr.p_offset, filesz);
+        }
+    }
+    std::sort(_segments.begin(), _segments.end(), [](auto& a, auto& b) { return a.vaddr < b.vaddr; });
+    if (_threads.empty()) {
+        fail("no thread registers");
+    }
+    if (_pid == 0) {
+        _pid = _threads[0].tid;
+    }
+}
+
+CoreFile::~CoreFile() {
+    munmap(const_cast<uint8_t *>(_data), _size);
+}
+
+void CoreFile::parse_notes(const uint8_t *notes, std::size_t len) {
+    std::size_t pos = 0;
+    while (pos + sizeof(Elf64_Nhdr) <= len) {
+        auto& header = *reinterpret_cast<const Elf64_Nhdr *>(notes + pos);
+        auto desc_pos = pos + sizeof(header) + ((header.n_namesz + 3) & ~3u);
+        if (desc_pos + header.n_descsz > len) {
+            break;
+        }
+        auto desc = notes + desc_pos;
+        pos = desc_pos + ((header.n_descsz + 3) & ~3u);
+
+        switch (header.n_type) {
+            case NT_PRSTATUS:
+                if (header.n_descsz >= sizeof(elf_prstatus)) {
+                    auto& status = *reinterpret_cast<const elf_prstatus *>(desc);
+                    ThreadState thread{status.pr_pid, status.pr_cursig, {}};
+                    std::memcpy(&thread.regs, &status.pr_reg, sizeof(thread.regs));
+                    _threads.push_back(thread);
+                }
+                break;
+            case NT_PRPSINFO:
+                if (header.n_descsz >= sizeof(elf_prpsinfo)) {
+                    _pid = reinterpret_cast<const elf_prpsinfo *>(desc)->pr_pid;
+                }
+                break;
+            case NT_AUXV:
+                for (auto entry = reinterpret_cast<const Elf64_auxv_t *>(desc);
+                     reinterpret_cast<const uint8_t *>(entry + 1) <= desc + header.n_descsz; entry++) {
+                    if (entry->a_type == AT_PHDR) {
+                        _phdr = entry->a_un.a_val;
+                    }
+                }
+                break;
+            case NT_FILE:
+            {
+                // count, page size, count * (start, end, offset in pages), then count NUL terminated paths
+                auto words = reinterpret_cast<const uint64_t *>(desc);
+                if (header.n_descsz < 2 * sizeof(uint64_t)) {
+                    break;
+                }
+                auto count = words[0];
+                auto page_size = words[1];
+                if ((2 + count * 3) * sizeof(uint64_t) > header.n_descsz) {
+                    break;
+                }
+                auto name = reinterpret_cast<const char *>(words + 2 + count * 3);
+                auto end = reinterpret_cast<const char *>(desc + header.n_descsz);
+                for (uint64_t i = 0; i < count && name < end; i++) {
+                    auto entry = words + 2 + i * 3;
+                    std::string path{name, strnlen(name, end - name)};
+                    _mappings.push_back(Mapping{entry[0], entry[1], entry[2] * page_size, path});
+                    name += path.size() + 1;
+                }
+                break;
+            }
+            default:;
+        }
+    }
+}
+
+// Read memory of the process; addresses in a segment but past its contents (not dumped) read as zeros
+std::size_t CoreFile::read(uint64_t addr, void *buf, std::size_t len) const {
+    std::size_t done = 0;
+    auto out = static_cast<uint8_t *>(buf);
+    while (done < len) {
+        auto cur = addr + done;
+        auto iter = std::upper_bound(_segments.begin(), _segments.end(), cur,
+                                     [](uint64_t a, const Segment& s) { return a < s.vaddr; });
+        if (iter == _segments.begin() || cur >= (--iter)->vaddr + iter->memsz) {
+            break;
+        }
+        auto off = cur - iter->vaddr;
+        auto n = std::min<uint64_t>(len - done, iter->memsz - off);
+        auto in_file = off < iter->filesz ? std::min<uint64_t>(n, iter->filesz - off) : 0;
+        std::memcpy(out + done, _data + iter->offset + off, in_file);
+        std::memset(out + done + in_file, 0, n - in_file);
+        done += n;
+    }
+    return done;
+}
+
+// The mapping of the executable (the file that the program headers were loaded from)
+const CoreFile::Mapping* CoreFile::get_exe_mapping() const {
+    for (auto& mapping : _mappings) {
+        if (_phdr >= mapping.start && _phdr < mapping.end) {
+            return &mapping;
+        }
+    }
+    return nullptr;
+}
+
+std::string CoreFile::get_exe_path() const {
+    auto exe = get_exe_mapping();
+    return exe != nullptr ? exe->path : "";
+}
+
+// Start of the executable's mapping at file offset 0 (as read_abs_load_addr finds it in a live process)
+uint64_t CoreFile::get_load_addr() const {
+    auto exe = get_exe_mapping();
+    if (exe == nullptr) {
+        return 0;
+    }
+    for (auto& mapping : _mappings) {
+        if (mapping.path == exe->path && mapping.offset == 0) {
+            return mapping.start;
+        }
+    }
+    return exe->start - exe->offset;
+}
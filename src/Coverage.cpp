@@ -0,0 +1,142 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include <map>
+
+#include "Breakpoint.h"
+#include "Coverage.h"
+
+// Gather the statements of every unit and plant an int3 at each address, batched by page
+void Coverage::start(const std::string& path, const DwarfContext& ctx, uint64_t load_addr, ProcessMemory& memory,
+                     const std::function<bool(uint64_t)>& has_breakpoint) {
+    _statements.clear();
+    for (auto [first, last] : ctx.get_all_lines()) {
+        for (auto row = first; row != last; row++) {
+            // Rows without code (or line) are end markers and compiler artifacts
+            if (row->is_stmt && row->line != 0 && row->low < row->high) {
+                _statements.push_back({row->low + load_addr, row});
+            }
+        }
+    }
+    std::stable_sort(_statements.begin(), _statements.end(),
+                     [](const Statement& a, const Statement& b) { return a.addr < b.addr; });
+
+    std::vector<Statement*> to_plant;
+    for (std::size_t i = 0; i < _statements.size(); i++) {
+        auto addr = _statements[i].addr;
+        if ((i == 0 || _statements[i - 1].addr != addr) && !has_breakpoint(addr)) {
+            to_plant.push_back(&_statements[i]);
+        }
+    }
+    patch_all(memory, to_plant, true);
+    _planted = std::count_if(_statements.begin(), _statements.end(), [](const Statement& s) { return s.planted; });
+    _path = path;
+    _running = true;
+}
+
+// Remove the int3s that are left, batched by page
+void Coverage::stop(ProcessMemory& memory) {
+    std::vector<Statement*> to_remove;
+    for (auto& s : _statements) {
+        if (s.planted) {
+            to_remove.push_back(&s);
+        }
+    }
+    patch_all(memory, to_remove, false);
+    _running = false;
+}
+
+// Get the statements at an address (an empty range if there are none)
+std::pair<Coverage::Statement*, Coverage::Statement*> Coverage::find(uint64_t addr) {
+    auto cmp = [](const Statement& s, uint64_t a) { return s.addr < a; };
+    auto first = std::lower_bound(_statements.data(), _statements.data() + _statements.size(), addr, cmp);
+    auto last = first;
+    while (last != _statements.data() + _statements.size() && last->addr == addr) {
+        last++;
+    }
+    return {first, last};
+}
+
+// Mark the statements at an address as hit and take out their int3 for good. Runs on every trap, so it must stay
+// cheap: no allocation, one write at most
+bool Coverage::hit(uint64_t addr, ProcessMemory& memory) {
+    if (!_running) {
+        return false;
+    }
+    auto [first, last] = find(addr);
+    if (first == last) {
+        return false;
+    }
+    // Another thread may have hit it first: the trap was still ours, unless the program has an int3 there itself
+    bool ours = first->planted || first->saved_byte != BREAKPOINT_INT3;
+    if (first->planted && memory.write_forced(addr, &first->saved_byte, 1) == 1) {
+        first->planted = false;
+    }
+    for (auto s = first; s != last; s++) {
+        s->hit = true;
+    }
+    return ours;
+}
+
+// Put back the original byte under a breakpoint about to be set
+void Coverage::take(uint64_t addr, ProcessMemory& memory) {
+    if (!_running) {
+        return;
+    }
+    auto [first, last] = find(addr);
+    if (first != last && first->planted && memory.write_forced(addr, &first->saved_byte, 1) == 1) {
+        first->planted = false;
+    }
+}
+
+// Plant the int3 again where a breakpoint was removed, unless the statement was hit meanwhile
+void Coverage::put_back(uint64_t addr, ProcessMemory& memory) {
+    if (!_running) {
+        return;
+    }
+    auto [first, last] = find(addr);
+    if (first == last || first->planted || first->hit || memory.read(addr, &first->saved_byte, 1) != 1) {
+        return;
+    }
+    uint8_t int3 = BREAKPOINT_INT3;
+    first->planted = memory.write_forced(addr, &int3, 1) == 1;
+}
+
+// Plant or take out the int3s of statements sorted by address
+void Coverage::patch_all(ProcessMemory& memory, std::vector<Statement*>& statements, bool plant) {
+    patch_int3s(memory, statements, plant, [](Statement* s) { return s->addr; },
+                [](Statement* s) -> uint8_t& { return s->saved_byte; },
+                [](Statement* s) -> bool& { return s->planted; });
+}
+
+// Write one lcov record per source file, with a DA line per statement line (hit if any of its addresses was)
+void Coverage::report(const DwarfContext& ctx, std::ostream& lcov, std::ostream& out) const {
+    std::map<std::string, std::map<uint32_t, bool>> files;
+    for (auto& s : _statements) {
+        auto& hit = files[ctx.get_file_name(*s.row)][s.row->line];
+        hit = hit || s.hit;
+    }
+
+    std::size_t total = 0;
+    std::size_t covered = 0;
+    lcov << std::dec << "TN:\n";
+    for (auto& [file, lines] : files) {
+        std::size_t file_covered = 0;
+        lcov << "SF:" << file << '\n';
+        for (auto [line, hit] : lines) {
+            lcov << "DA:" << line << ',' << (hit ? 1 : 0) << '\n';
+            file_covered += hit;
+        }
+        lcov << "LF:" << lines.size() << "\nLH:" << file_covered << "\nend_of_record\n";
+        total += lines.size();
+        covered += file_covered;
+    }
+
+    out << "Covered " << std::dec << covered << " of " << total << " lines in " << files.size() << " files";
+    if (total != 0) {
+        out << " (" << covered * 100 / total << "%)";
+    }
+    out << '\n';
+}
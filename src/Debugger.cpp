@@ -8,64 +8,640 @@
 #include <sys/ptrace.h>
 #include <unistd.h>
 #include <sys/personality.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <thread>
 
 #include "Debugger.h"
 #include "Utils.h"
 #include "Registers.h"
+#include "PerfCounter.h"
+#include "Profiler.h"
+#include "Stats.h"
+#include "ValuePrinter.h"
 
 constexpr bool DEBUG_MODE = true;
+constexpr std::size_t MAX_PROFILE_STACKS = 16384;
+constexpr double MAX_PROFILE_SECONDS = 86400;      // Keeps seconds * hz within the tick counter
+constexpr std::size_t MAX_BACKTRACE = 256;
+constexpr std::size_t STACK_SNAPSHOT_SIZE = 64 * 1024;      // Enough for most stacks, deeper frames are read on demand
+constexpr std::size_t PROFILE_SNAPSHOT_SIZE = 16 * 1024;    // Smaller, as it is read for every thread at every sample
 
-// Launch the process to be debugged (called by child)
-void Debugger::launch_process(const char *prog_name, pid_t pid) {
+// Debug a core file: threads, registers and memory all come from the core, and there is no process to run
+Debugger::Debugger(std::unique_ptr<CoreFile> core, const std::string& prog_name) {
+    _core = std::move(core);
+    _prog_name = prog_name.empty() ? _core->get_exe_path() : prog_name;
+    _pid = _core->get_pid();
+    _abs_load_addr = Utils::is_elf_pie(_prog_name.c_str()) ? _core->get_load_addr() : 0;
+    _dwarf_ctx = DwarfContext{_prog_name};
+    _memory.reset(_core.get());
+    _hw_breakpoints.reset(_pid);
+    for (auto& state : _core->get_threads()) {
+        auto& thread = _threads.emplace(state.tid, state.tid).first->second;
+        thread.regs.load(state.regs);
+        thread.started = true;
+    }
+    // The thread that caused the dump comes first
+    _thread = &_threads.at(_core->get_threads()[0].tid);
+    _stop_signal = _core->get_threads()[0].signal;
+}
+
+// Launch the process to be debugged (called by child), filtering the given system calls
+void Debugger::launch_process(const char *prog_name, pid_t pid, const std::vector<long>& syscalls) {
     personality(ADDR_NO_RANDOMIZE);                 // Disable address space randomisation
     ptrace(PTRACE_TRACEME, pid, nullptr, nullptr);  // Trace the child process (pid = 0)
+    if (!syscalls.empty()) {
+        raise(SIGSTOP);     // Until the debugger asks for the filter's stops, without which the system calls fail
+        SyscallFilter::install(syscalls);
+    }
     execl(prog_name, prog_name, nullptr);                  // Start program
 }
 
-// Wait for any signal to be sent to the child process
+// Attach to a running process. Everything that does not need the process stopped (DWARF and symbol indexes,
+// the load address) is done first, so the process only pauses while its threads are seized and interrupted
+void Debugger::attach() {
+    _dwarf_ctx.prepare();
+    _abs_load_addr = Utils::is_elf_pie(_prog_name.c_str()) ? read_abs_load_addr(_pid) : 0;
+    auto debug_state = _modules.init(_pid);    // Only the link_map walk needs the process stopped
+    _seized = true;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<pid_t> tids;
+    std::size_t count;
+    std::string task_dir = "/proc/" + std::to_string(_pid) + "/task";
+    do {
+        // Threads created while we are seizing the others are found on the next pass
+        count = tids.size();
+        auto dir = opendir(task_dir.c_str());
+        if (dir == nullptr) {
+            break;
+        }
+        while (auto entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            pid_t tid = std::stoi(entry->d_name);
+            if (std::find(tids.begin(), tids.end(), tid) == tids.end() &&
+                Stats::ptrace(PTRACE_SEIZE, tid, nullptr, PTRACE_O_TRACECLONE) == 0) {
+                Stats::ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr);
+                tids.push_back(tid);
+            }
+        }
+        closedir(dir);
+    } while (tids.size() != count);
+
+    if (tids.empty()) {
+        std::cerr << "Could not attach to process " << _pid << ": " << std::strerror(errno) << '\n';
+        exit(EXIT_FAILURE);
+    }
+
+    for (auto tid : tids) {
+        auto& thread = add_thread(tid);
+        thread.running = true;
+        thread.stop_requested = true;
+        int wait_status;
+        if (Stats::waitpid(tid, &wait_status, __WALL) == -1) {
+            continue;
+        }
+        thread.running = false;
+        if (!swallow_stop(thread, wait_status)) {
+            thread.pending_status = wait_status;
+            _pending.push_back(tid);
+        }
+    }
+
+    watch_modules(debug_state);
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Attached to process " << _pid << " (" << tids.size() << " threads), stopped in "
+              << us.count() << " us\n";
+}
+
+// COMMAND: Detach from the process, leaving it running as if it had never been traced
+void Debugger::detach() {
+    if (!_syscalls.empty()) {
+        throw std::invalid_argument{"Cannot detach: the filtered system calls would fail with ENOSYS without us"};
+    }
+    for (auto& [tid, thread] : _threads) {
+        int wait_status;
+        // New threads that have not reported their first stop yet must be stopped to be detached
+        if (thread.running && Stats::waitpid(tid, &wait_status, __WALL) != -1) {
+            thread.running = false;
+            if (!swallow_stop(thread, wait_status)) {
+                thread.pending_status = wait_status;
+            }
+        }
+
+        // A stop collected but not handled yet is given back: breakpoint traps are rewound, signals delivered
+        if (thread.pending_status != -1 && WIFSTOPPED(thread.pending_status) && (thread.pending_status >> 16) == 0) {
+            auto sig = WSTOPSIG(thread.pending_status);
+            auto pc = thread.regs.get(Reg::rip);
+            if (sig == SIGTRAP && (_breakpoints.count(pc - 1 - _abs_load_addr) != 0 || _coverage.hit(pc - 1, _memory))) {
+                thread.regs.set(Reg::rip, pc - 1);
+            } else if (sig != SIGTRAP && sig != SIGSTOP) {
+                thread.pending_signal = sig;
+            }
+        }
+    }
+
+    // Restore the original bytes of every breakpoint, a page at a time
+    std::vector<Breakpoint*> bps;
+    for (auto& [addr, bp] : _breakpoints) {
+        bps.push_back(&bp);
+    }
+    Breakpoint::disable_all(_memory, bps);
+    _breakpoints.clear();
+    _tracepoints.remove_all(_memory);   // Every thread is still stopped, so none runs a half-restored jmp
+    if (_coverage.is_running()) {
+        _coverage.stop(_memory);
+    }
+    try {
+        _hw_breakpoints.clear();
+    } catch (const std::invalid_argument&) {}
+
+    for (auto& [tid, thread] : _threads) {
+        // A SIGSTOP we sent but never collected would stop the process after we leave, so consume it first
+        if (!_seized && thread.stop_requested) {
+            int wait_status;
+            do {
+                resume_thread(thread, PTRACE_SINGLESTEP);
+            } while (Stats::waitpid(tid, &wait_status, __WALL) != -1 && swallow_stop(thread, wait_status));
+        }
+        thread.regs.flush();
+        Stats::ptrace(PTRACE_DETACH, tid, nullptr, static_cast<long>(thread.pending_signal));
+    }
+
+    std::cout << "Detached from process " << std::dec << _pid << '\n';
+    exit(EXIT_SUCCESS);
+}
+
+// Wait until a thread stops in a way that should be reported, then stop all the other threads.
+// Events of every thread are collected with a single waitpid(-1) and dispatched through the thread map
 void Debugger::wait_for_signal() {
+    bool reported = false;
+    while (!reported) {
+        handle_next_event(true, reported);
+    }
+    stop_all_threads();
+}
+
+// Take the next event (a status collected while stopping the threads, or a new one) and handle it, setting
+// reported if it is a stop to report. Without block, returns false straight away if no thread has an event
+bool Debugger::handle_next_event(bool block, bool& reported) {
     int wait_status;
-    waitpid(_pid, &wait_status, 0); // wait for signal in the debuggee
+    pid_t tid;
+    if (_resumed_all && !_pending.empty()) {
+        tid = _pending.front();
+        _pending.pop_front();
+        wait_status = _threads.at(tid).pending_status;
+        _threads.at(tid).pending_status = -1;
+    } else {
+        tid = Stats::waitpid(-1, &wait_status, __WALL | (block ? 0 : WNOHANG));
+        if (tid == 0 || (tid == -1 && errno == EINTR)) {
+            return false;
+        }
+        if (tid == -1) {
+            std::cout << "Process finished running.\n";
+            exit(EXIT_SUCCESS);
+        }
+        // Checkpoints and forks of the process are children of ours too, but never threads of the process
+        if (handle_checkpoint_event(tid, wait_status) || handle_fork_event(tid, wait_status)) {
+            reported = false;
+            return true;
+        }
+    }
+
+    // A new thread may report its first stop before its parent reports the clone
+    auto iter = _threads.find(tid);
+    auto& thread = iter != _threads.end() ? iter->second : add_thread(tid);
+    reported = handle_event(thread, wait_status);
+    return true;
+}
 
-    // Get the signal information and handle specific signal
-    siginfo_t info;
-    ptrace(PTRACE_GETSIGINFO, _pid, nullptr, &info);
+// Handle one wait status of a thread. Returns true if the stop should be reported (the thread is then current)
+bool Debugger::handle_event(Thread& thread, int status) {
+    auto tid = thread.tid;
+    thread.running = false;
+
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+        if (tid == _pid) {
+            if (_coverage.is_running()) {
+                _coverage.abandon();
+                try {
+                    write_coverage();
+                } catch (const std::invalid_argument& e) {
+                    std::cerr << e.what() << '\n';
+                }
+            }
+            if (_exit_on_finish && _checkpoints.empty()) {
+                std::cout << "Process finished running.\n";
+                exit(EXIT_SUCCESS);
+            }
+            if (_exit_on_finish) {
+                std::cout << "Process finished running; 'restart <n>' goes back to a checkpoint.\n";
+            }
+            _exited = true;
+            _exit_status = status;
+            return true;
+        }
+        bool was_current = &thread == _thread;
+        _hw_breakpoints.remove_thread(tid);
+        _threads.erase(tid);
+        if (was_current) {
+            std::cout << "Thread " << std::dec << tid << " exited\n";
+            // The main thread may have exited before it (its exit is only reported once the last thread is gone)
+            auto main = _threads.find(_pid);
+            if (main == _threads.end() && _threads.empty()) {
+                _exited = true;
+                _exit_status = status;
+                return true;
+            }
+            _thread = main != _threads.end() ? &main->second : &_threads.begin()->second;
+            return !_resumed_all;   // Nothing else is running that we could wait for
+        }
+        return false;
+    }
+
+    // The process forked a child under the system call filter, which is traced from now on (see handle_fork_event)
+    if ((status >> 16) == PTRACE_EVENT_FORK || (status >> 16) == PTRACE_EVENT_VFORK) {
+        unsigned long new_pid;
+        Stats::ptrace(PTRACE_GETEVENTMSG, tid, nullptr, &new_pid);
+        _forks.emplace(static_cast<pid_t>(new_pid), false);
+        resume_thread(thread, thread.last_request);
+        return false;
+    }
+
+    // A new thread was created (it starts with a SIGSTOP, handled below)
+    if ((status >> 16) == PTRACE_EVENT_CLONE) {
+        unsigned long new_tid;
+        Stats::ptrace(PTRACE_GETEVENTMSG, tid, nullptr, &new_tid);
+        add_thread(static_cast<pid_t>(new_tid));
+        resume_thread(thread, thread.last_request);
+        return false;
+    }
+
+    // Our own SIGSTOP: resume the thread as it was, but keep new threads stopped if the others are too
+    bool is_new = !thread.started;
+    if (swallow_stop(thread, status)) {
+        if (!is_new || _resumed_all) {
+            resume_thread(thread, thread.last_request);
+        }
+        return false;
+    }
+
+    // Group stops of seized threads are not reported (the debugger decides when threads stop)
+    if ((status >> 16) == PTRACE_EVENT_STOP) {
+        if (_resumed_all || &thread == _thread) {
+            resume_thread(thread, thread.last_request);
+        }
+        return false;
+    }
 
-    switch (info.si_signo) {
+    // A system call selected by the seccomp filter is about to run, or one we traced has returned
+    if ((status >> 16) == PTRACE_EVENT_SECCOMP || WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+        return handle_syscall(thread, (status >> 16) == PTRACE_EVENT_SECCOMP);
+    }
+
+    switch (WSTOPSIG(status)) {
         case SIGTRAP:
-            handle_sigtrap(info);
-            break;
+        {
+            siginfo_t info;
+            Stats::ptrace(PTRACE_GETSIGINFO, tid, nullptr, &info);
+            // A line reached for the first time under 'coverage run': its int3 is gone for good, so go on as if
+            // it had never been there
+            if (_coverage.is_running() && (info.si_code == SI_KERNEL || info.si_code == TRAP_BRKPT)) {
+                auto addr = thread.regs.get(Reg::rip) - 1;
+                if (_coverage.hit(addr, _memory) && _breakpoints.count(addr - _abs_load_addr) == 0) {
+                    thread.regs.set(Reg::rip, addr);
+                    if (_resumed_all || &thread == _thread) {
+                        resume_thread(thread, thread.last_request);
+                    }
+                    return false;
+                }
+            }
+            auto prev = _thread;
+            _thread = &thread;
+            _stop_signal = SIGTRAP;
+            auto report = handle_sigtrap(info);
+            if (&thread == prev && !_resumed_all) {
+                return true;    // The thread being stepped is the only one running
+            }
+            // Other threads run past the temporary breakpoints of the stepping engine
+            if (report && !(_stepping && thread.at_breakpoint && &thread != prev)) {
+                return true;
+            }
+            _thread = prev;
+            step_over_breakpoint(thread);
+            if (_resumed_all) {
+                resume_thread(thread, PTRACE_CONT);
+            }
+            return false;
+        }
         case SIGSEGV:
         {
-            auto line_entry = _dwarf_ctx.get_line_from_pc(get_offset_pc());
-            std::cout << "Oops, you got a segfault on line " << std::dec << line_entry->line << ":\n";
-            _dwarf_ctx.print_source(line_entry->file->path, line_entry->line, 1);
-            exit(EXIT_SUCCESS); // TODO: query to run again?
+            _thread = &thread;
+            _stop_signal = SIGSEGV;
+            if (!_exit_on_finish) {
+                return true;    // Whoever drives us decides whether the signal is delivered
+            }
+            // Stop so the state can still be inspected (or saved with gcore); continuing delivers the signal
+            thread.pending_signal = SIGSEGV;
+            std::cout << "Oops, thread " << std::dec << tid << " got a segfault";
+            try {
+                auto& line_entry = _dwarf_ctx.get_line_from_pc(get_offset_pc());
+                std::cout << " on line " << line_entry.line << ":\n";
+                _dwarf_ctx.print_source(_dwarf_ctx.get_file_name(line_entry), line_entry.line, 1);
+            } catch (const std::out_of_range&) {
+                std::cout << " at 0x" << std::hex << get_offset_pc() << '\n';
+            }
+            return true;
         }
         default:
-            std::cout << "Process finished running.\n";
-            exit(EXIT_SUCCESS); // TODO: not sure if this is correct, process may get any signal (like a pipe)
+            // Pass any other signal on to the thread
+            thread.pending_signal = WSTOPSIG(status);
+            if (_resumed_all || &thread == _thread) {
+                resume_thread(thread, thread.last_request);
+            }
+            return false;
+    }
+}
+
+// Handle the entry into a filtered system call (stopping if it is caught while all threads run, printing it if it is
+// traced), or the exit from one that is traced. Returns true if the stop should be reported.
+// A traced system call is resumed with PTRACE_SYSCALL (see resume_thread), so that the thread stops once more when it
+// returns and the call is printed with its result on one line. This is only done for threads that were continued
+// (a step must end where it would have)
+bool Debugger::handle_syscall(Thread& thread, bool entry) {
+    auto& regs = thread.regs.get_all();
+    auto nr = static_cast<long>(regs.orig_rax);
+    auto resume = _resumed_all || &thread == _thread;
+    if (!entry) {
+        std::cout << "Thread " << std::dec << thread.tid << ": " << thread.syscall << " = "
+                  << SyscallFilter::format_result(nr, regs.rax) << std::endl;
+        thread.syscall.clear();
+        if (resume) {
+            resume_thread(thread, PTRACE_CONT);
+        }
+        return false;
+    }
+
+    if (_syscalls.is_caught(nr) && _resumed_all) {
+        _thread = &thread;
+        _stop_signal = SIGTRAP;
+        std::cout << "Thread " << std::dec << thread.tid << " caught system call "
+                  << SyscallFilter::format_call(regs, _memory) << std::endl;
+        return true;
+    }
+    if (_syscalls.is_traced(nr)) {
+        auto call = SyscallFilter::format_call(regs, _memory);
+        if (resume && thread.last_request == PTRACE_CONT && SyscallFilter::returns(nr)) {
+            thread.syscall = std::move(call);
+        } else {
+            std::cout << "Thread " << std::dec << thread.tid << ": " << call << " = ?" << std::endl;
+        }
+    }
+    if (resume) {
+        resume_thread(thread, thread.last_request);
+    }
+    return false;
+}
+
+// The process a thread belongs to (Tgid in /proc/<tid>/status), or -1 if it is gone
+static pid_t thread_group(pid_t tid) {
+    return Stats::timed(Stats::Call::FileRead, [&] {
+        std::ifstream status {"/proc/" + std::to_string(tid) + "/status"};
+        std::string line;
+        while (std::getline(status, line)) {
+            if (Utils::is_prefixed_by("Tgid:", line)) {
+                return static_cast<pid_t>(std::stoi(line.substr(5)));
+            }
+        }
+        return static_cast<pid_t>(-1);
+    });
+}
+
+// Handle a stop of a fork of the process (or of a child of one), which inherited the system call filter. Returns
+// false if pid is not one. Its filtered system calls run, its signals are delivered, and none of its stops is
+// reported. Its text has our int3s in it (a vfork child even shares our memory), so it steps over a breakpoint
+// with the original byte put back for the one instruction
+bool Debugger::handle_fork_event(pid_t pid, int status) {
+    auto iter = _forks.find(pid);
+    if (iter == _forks.end()) {
+        // Its first stop may come before the fork is reported: tell it apart from a new thread of the process
+        if (_syscalls.empty() || _threads.count(pid) != 0 || thread_group(pid) == _pid) {
+            return false;
+        }
+        iter = _forks.emplace(pid, false).first;
+    }
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+        _forks.erase(iter);
+        return true;
+    }
+
+    int signal = 0;
+    auto event = status >> 16;
+    if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
+        unsigned long new_pid;
+        Stats::ptrace(PTRACE_GETEVENTMSG, pid, nullptr, &new_pid);
+        _forks.emplace(static_cast<pid_t>(new_pid), false);
+    } else if (!iter->second) {
+        // Its first stop, a SIGSTOP. An exec must not send it a SIGTRAP as it would to any traced process
+        iter->second = true;
+        Stats::ptrace(PTRACE_SETOPTIONS, pid, nullptr, trace_options() | PTRACE_O_TRACEEXEC);
+    } else if (event == 0 && WSTOPSIG(status) == SIGTRAP) {
+        user_regs_struct regs{};
+        Stats::ptrace(PTRACE_GETREGS, pid, nullptr, &regs);
+        auto bp = _breakpoints.find(regs.rip - 1 - _abs_load_addr);
+        if (bp == _breakpoints.end() || !bp->second.is_enabled()) {
+            signal = SIGTRAP;
+        } else {
+            ProcessMemory memory {pid};
+            uint8_t byte = bp->second.get_saved_byte();
+            uint8_t int3 = BREAKPOINT_INT3;
+            regs.rip--;
+            Stats::ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+            memory.write_forced(regs.rip, &byte, 1);
+            int wait_status = 0;
+            Stats::ptrace(PTRACE_SINGLESTEP, pid, nullptr, nullptr);
+            while (Stats::waitpid(pid, &wait_status, __WALL) != -1 && WIFSTOPPED(wait_status)) {
+                if ((wait_status >> 16) == 0 && WSTOPSIG(wait_status) == SIGTRAP) {
+                    break;
+                } else if ((wait_status >> 16) == 0) {
+                    signal = WSTOPSIG(wait_status);
+                }
+                Stats::ptrace(PTRACE_SINGLESTEP, pid, nullptr, nullptr);
+            }
+            if (!WIFSTOPPED(wait_status)) {
+                _forks.erase(iter);
+                return true;
+            }
+            memory.write_forced(regs.rip, &int3, 1);
+        }
+    } else if (event == 0) {
+        signal = WSTOPSIG(status);
+    }
+    Stats::ptrace(PTRACE_CONT, pid, nullptr, signal);
+    return true;
+}
+
+// COMMAND: Trace or catch (stop at) system calls of the filter, given as in 'syscalls <names>' at launch, 'all' or
+// 'none'. Without names, list them
+void Debugger::set_syscall_flags(const std::vector<std::string>& args, bool caught) {
+    if (_syscalls.empty()) {
+        throw std::out_of_range{"No system calls are filtered (start the debugger with 'syscalls <names> <program>')"};
+    }
+    if (args.size() < 3) {
+        _syscalls.print(std::cout);
+        return;
+    }
+    std::string names;
+    for (std::size_t i = 2; i < args.size(); i++) {
+        names += args[i] + ',';
+    }
+    names.pop_back();
+    if (caught) {
+        _syscalls.set_caught(names);
+    } else {
+        _syscalls.set_traced(names);
+    }
+}
+
+// Start tracking a thread (new threads start with a SIGSTOP from the kernel)
+Thread& Debugger::add_thread(pid_t tid) {
+    auto result = _threads.emplace(tid, tid);
+    auto& thread = result.first->second;
+    if (result.second) {
+        thread.running = true;
+        thread.stop_requested = true;
+    }
+    return thread;
+}
+
+// Swallow the stop we requested (a SIGSTOP, or PTRACE_EVENT_STOP for seized threads), returning false for any
+// other status
+bool Debugger::swallow_stop(Thread& thread, int status) {
+    if (!thread.stop_requested || !WIFSTOPPED(status)) {
+        return false;
+    }
+    auto event = status >> 16;
+    if (event != PTRACE_EVENT_STOP && (event != 0 || WSTOPSIG(status) != SIGSTOP)) {
+        return false;
+    }
+    thread.stop_requested = false;
+    if (!thread.started) {
+        thread.started = true;
+        _hw_breakpoints.add_thread(thread.tid);  // Debug registers are not inherited by new threads
+    }
+    return true;
+}
+
+// Stop every running thread after a reported stop. Other events they reach first are kept for the next wait
+void Debugger::stop_all_threads() {
+    _resumed_all = false;
+    for (auto& [tid, thread] : _threads) {
+        if (thread.running && !thread.stop_requested) {
+            if (_seized) {
+                Stats::ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr);
+            } else {
+                syscall(SYS_tgkill, _pid, tid, SIGSTOP);
+            }
+            thread.stop_requested = true;
+        }
+    }
+    for (auto& [tid, thread] : _threads) {
+        int wait_status;
+        if (!thread.running || Stats::waitpid(tid, &wait_status, __WALL) == -1) {
+            continue;
+        }
+        thread.running = false;
+        if (!swallow_stop(thread, wait_status)) {
+            thread.pending_status = wait_status;
+            _pending.push_back(tid);
+        }
     }
 }
 
 // Handle a SIGTRAP (due to a breakpoint or single stepping)
-void Debugger::handle_sigtrap(siginfo_t info) {
+bool Debugger::handle_sigtrap(siginfo_t info) {
+    _stop_hw_slot = -1;
     switch (info.si_code) {
         // Breakpoint is hit (either of the following codes)
         case SI_KERNEL:
         case TRAP_BRKPT:
         {
             set_pc(get_pc() - 1);   // Go back one instruction to execute the original instruction next
+            _thread->at_breakpoint = true;
             auto rel_addr = get_offset_pc();
-            std::cout << "Hit breakpoint at 0x" << std::hex << rel_addr << std::endl;
+            if (rel_addr == _debug_state_bp) {
+                // The dynamic linker changed its list of loaded objects. It also stops here before a change, with
+                // the list half-way: the old one is kept until the stop after it
+                if (!_modules.update(_pid, _memory)) {
+                    if constexpr(DEBUG_MODE) {
+                        std::cout << "(DEBUGGING) Loaded objects are changing\n";
+                    }
+                }
+                if (!_report_debug_state) {
+                    return false;
+                }
+            }
+            if (_stepping) {
+                return true;
+            }
+
+            // Conditions are checked here, in the wait loop, so false hits resume without reaching the prompt
+            auto iter = _breakpoints.find(rel_addr);
+            if (iter != _breakpoints.end() && !iter->second.should_stop(_thread->regs.get_all(), _memory)) {
+                return false;
+            }
+
+            _last_breakpoint = rel_addr;
+            std::cout << "Thread " << std::dec << _thread->tid << " hit breakpoint at 0x" << std::hex << rel_addr
+                      << std::endl;
+            if (iter != _breakpoints.end() && iter->second.get_condition() != nullptr) {
+                auto& bp = iter->second;
+                std::cout << "Condition '" << bp.get_condition()->get_source() << "' held after " << std::dec
+                          << bp.get_eval_count() << " evaluations (" << bp.get_eval_ns() / bp.get_eval_count()
+                          << " ns each on average)\n";
+            }
             print_source_lines(rel_addr, 1);
-            return;
+            return true;
+        }
+        // Hardware breakpoint or watchpoint (DR6 says which slot fired)
+        case TRAP_HWBKPT:
+        {
+            auto slot = _hw_breakpoints.get_triggered(_thread->tid);
+            _stop_hw_slot = slot;
+            if (slot == -1) {
+                return true;
+            }
+            auto& hw = _hw_breakpoints.get_slot(slot);
+            auto rel_addr = get_offset_pc();
+            if (hw.type == HardwareBreakpoints::Type::Execute) {
+                // Instruction breakpoints are faults, so the PC is already at the breakpoint address
+                std::cout << "Hit hardware breakpoint " << slot << " at 0x" << std::hex << rel_addr << std::endl;
+            } else {
+                uint64_t value = 0;
+                _memory.read(hw.addr, &value, hw.len);
+                std::cout << "Watchpoint " << slot << " (" << to_string(hw.type) << ") triggered on 0x" << std::hex
+                          << hw.addr - _abs_load_addr << ", value is now 0x" << value << std::endl;
+            }
+            print_source_lines(rel_addr, 1);
+            return true;
         }
         // Single stepping (do nothing)
         case TRAP_TRACE:
-            return;
+            return true;
         default:;   // Ignore unknown SIGTRAPs
     }
+    return true;
 }
 
 
@@ -83,22 +659,107 @@ inline void Debugger::init_abs_load_addr_on_launch() {
     }
 }
 
+// Wait for a launched process to stop at its first instruction (attached processes are stopped already)
+void Debugger::start() {
+    print_index_status();
+    if (_core != nullptr) {
+        std::cout << "Core of process " << std::dec << _pid << " (" << _threads.size() << " threads), thread "
+                  << _thread->tid << " stopped by signal " << _stop_signal << " (" << strsignal(_stop_signal) << ")\n";
+        print_source_lines(get_offset_pc(), 1);
+    } else if (!_seized) {
+        if (!_syscalls.empty()) {
+            // The child stopped itself before installing its filter: the options must be set before it is
+            int wait_status;
+            Stats::waitpid(_pid, &wait_status, __WALL);
+            Stats::ptrace(PTRACE_SETOPTIONS, _pid, nullptr, trace_options());
+            Stats::ptrace(PTRACE_CONT, _pid, nullptr, nullptr);
+        }
+
+        // Wait until signal is sent to the child (at launch or by software interrupt)
+        wait_for_signal();
+        init_abs_load_addr_on_launch(); // Only has effect once: on launch of child process
+
+        // Report new threads, and kill the debuggee if the debugger dies
+        Stats::ptrace(PTRACE_SETOPTIONS, _pid, nullptr, trace_options());
+        init_modules();
+    }
+}
+
+// Report whether the program's debug index was mapped from the cache or is being built (and cached for next time)
+void Debugger::print_index_status() {
+    auto& path = _dwarf_ctx.get_index_cache_path();
+    switch (_dwarf_ctx.get_index_cache_status()) {
+        case IndexCache::Status::Hit:
+            std::cout << "Debug index: cache hit (" << path << ")\n";
+            break;
+        case IndexCache::Status::Miss:
+            std::cout << "Debug index: cache miss, indexing in the background (" << path << ")\n";
+            break;
+        case IndexCache::Status::Stale:
+            std::cout << "Debug index: cached index is out of date, rebuilding (" << path << ")\n";
+            break;
+        case IndexCache::Status::NoBuildId:
+            std::cout << "Debug index: not cached (the program has no build ID)\n";
+            break;
+        case IndexCache::Status::NoCacheDir:
+            std::cout << "Debug index: not cached (no cache directory: set XDG_CACHE_HOME or HOME)\n";
+            break;
+        case IndexCache::Status::Disabled:
+            break;
+    }
+}
+
 // Run the debugger
 void Debugger::run() {
-    // Wait until signal is sent to the child (at launch or by software interrupt)
-    wait_for_signal();
-    init_abs_load_addr_on_launch(); // Only has effect once: on launch of child process
+    start();
 
     // Use linenoise library to handle user input and keep a history of commands
     char *cmd;
     while ((cmd = linenoise("> ")) != nullptr) {
-        handle(cmd);
+        try {
+            handle(cmd);
+        } catch (const std::logic_error& e) {   // e.g. a location that cannot be found
+            std::cerr << e.what() << '\n';
+        }
         linenoiseHistoryAdd(cmd);
         linenoiseFree(cmd);
     }
 }
 
 
+// Commands in the order a (possibly abbreviated) command word is matched against them: it runs the first one it
+// abbreviates, or equals for exact ones. Most need a live process, some also inspect a core or an exited process
+struct Command {
+    const char *name;
+    bool exact;
+    bool on_core;
+    bool on_exit;
+};
+static const Command commands[] = {
+    {"continue", false, false, false}, {"break", false, false, false}, {"ignore", false, false, false},
+    {"hbreak", false, false, false}, {"watch", false, false, false}, {"hdelete", false, false, false},
+    {"stepi", false, false, false}, {"stepl", false, false, false}, {"next", false, false, false},
+    {"finish", false, false, false}, {"backtrace", false, true, false}, {"list", false, true, true},
+    {"registers", false, true, false}, {"memory", false, true, false}, {"print", false, true, false},
+    {"profile", false, false, false}, {"gcore", false, false, false}, {"checkpoint", false, false, true},
+    {"catch", false, false, false}, {"trace", true, false, false}, {"restart", false, false, true},
+    {"detach", false, false, false}, {"thread", true, false, false}, {"threads", false, true, false},
+    {"tracepoint", false, false, false}, {"coverage", false, false, false}, {"modules", false, false, false},
+    {"symbol", false, true, true}, {"stats", false, true, true},
+};
+
+static const Command* find_command(const std::string& cmd) {
+    if (cmd.empty()) {
+        return nullptr;
+    }
+    for (auto& command : commands) {
+        if (command.exact ? cmd == command.name : Utils::is_prefixed_by(cmd, command.name)) {
+            return &command;
+        }
+    }
+    return nullptr;
+}
+
 // Handle user commands
 void Debugger::handle(const std::string& line) {
     auto args = Utils::split_by(line, ' ');
@@ -106,93 +767,769 @@ void Debugger::handle(const std::string& line) {
 
     // TODO: check number of args, etc. MORE ROBUST COMMAND PARSING
 
-    if (Utils::is_prefixed_by(cmd, "continue")) {
+    auto command = find_command(cmd);
+    if (command == nullptr) {
+        std::cerr << "Unknown command\n";
+        return;
+    }
+    std::string_view name = command->name;
+
+    // A core file can be inspected, but there is no process to run (nor registers or memory to write)
+    if (_core != nullptr && (!command->on_core ||
+                             ((name == "registers" || name == "memory") && args.size() > 1 &&
+                              Utils::is_prefixed_by(args[1], "write")))) {
+        std::cerr << "Not available when debugging a core file\n";
+        return;
+    }
+
+    // Once the process has exited, only a checkpoint can bring it back
+    if (_exited && _core == nullptr && !command->on_exit) {
+        std::cerr << "The process has exited\n";
+        return;
+    }
+
+    // System calls made on the debuggee from here on are counted against this command
+    Stats::CommandScope stats_scope {cmd};
+
+    if (name == "continue") {
         continue_execution();
-    } else if (Utils::is_prefixed_by(cmd, "break")) {
-        if (args[1][0] == '0' && args[1][1] == 'x') {   // 0xADDRESS
-            set_breakpoint_cmd(args[1]);
-        } else if (args[1].find(':') != std::string::npos) {    // file:line
-            auto file_line = Utils::split_by(args[1], ':');
-            set_breakpoint_at_source_line(file_line[0], std::stoi(file_line[1]));
-        } else {    // function
-            set_breakpoint_at_function(args[1]);
-        }
-    } else if (Utils::is_prefixed_by(cmd, "stepi")) {
+    } else if (name == "break") {
+        // 0xADDRESS, file:line or function, optionally followed by 'if <condition>'
+        auto addr = resolve_location(args[1]);
+        auto cond_pos = line.find(" if ");
+        if (cond_pos != std::string::npos) {
+            set_breakpoint_condition(addr, line.substr(cond_pos + 4));
+        } else {
+            set_breakpoint(addr);
+        }
+    } else if (name == "ignore") {
+        // ignore [0xADDRESS] <count>, defaulting to the last breakpoint that was hit
+        if (args.size() > 2) {
+            set_ignore_count(std::stoul(args[1], nullptr, 16), std::stoul(args[2]));
+        } else {
+            set_ignore_count(_last_breakpoint, std::stoul(args[1]));
+        }
+    } else if (name == "hbreak") {
+        set_hw_breakpoint(resolve_location(args[1]));
+    } else if (name == "watch") {
+        auto addr = std::stoul(args[1], nullptr, 16);
+        auto len = args.size() > 2 ? std::stoul(args[2]) : sizeof(uint64_t);
+        auto mode = args.size() > 3 ? args[3] : "w";
+        if (mode != "w" && mode != "r" && mode != "rw") {
+            throw std::invalid_argument{"Unknown watchpoint mode '" + mode + "' (valid modes: w, r, rw)"};
+        }
+        // x86 has no read-only watchpoints, so reads are always watched together with writes
+        set_watchpoint(addr, len, mode == "w" ? HardwareBreakpoints::Type::Write : HardwareBreakpoints::Type::ReadWrite);
+    } else if (name == "hdelete") {
+        remove_hw_breakpoint(std::stoi(args[1]));
+    } else if (name == "stepi") {
         single_step_instruction();
         std::cout << "Stepped over one instruction.\n";
         print_source_lines(get_offset_pc());
-    } else if (Utils::is_prefixed_by(cmd, "stepl")) {
-        step_in();
+    } else if (name == "stepl") {
+        // stepl [count]: count also reads a perf counter for the instructions run
+        step_in(args.size() > 1 && args[1] == "count");
         std::cout << "Stepped into line.\n";
         print_source_lines(get_offset_pc());
-    } else if (Utils::is_prefixed_by(cmd, "next")) {
+    } else if (name == "next") {
         step_over();
         std::cout << "Stepped over one line.\n";
         print_source_lines(get_offset_pc());
-    } else if (Utils::is_prefixed_by(cmd, "finish")) {
+    } else if (name == "finish") {
         step_out();
         std::cout << "Stepped until end of function.\n";
-    } else if (Utils::is_prefixed_by(cmd, "registers")) {
+    } else if (name == "backtrace") {
+        print_backtrace();
+    } else if (name == "list") {
+        // Around the current line, or around a 0xADDRESS, file:line or function
+        print_source_lines(args.size() > 1 ? resolve_location(args[1]) : get_offset_pc(), 5);
+    } else if (name == "registers") {
         if (Utils::is_prefixed_by(args[1], "print")) {
             print_registers();
         } else if (Utils::is_prefixed_by(args[1], "read")) {
-            auto val = get_reg_value(_pid, get_reg_from_name(args[2]));
+            auto val = _thread->regs.get(get_reg_from_name(args[2]));
             Utils::print_hex(val, true);
         } else if (Utils::is_prefixed_by(args[1], "write")) {
             auto val = std::stol(args[3], nullptr, 16);
-            set_reg_value(_pid, get_reg_from_name(args[2]), val);
+            _thread->regs.set(get_reg_from_name(args[2]), val);
             std::cout << "Wrote value "; Utils::print_hex(val, false, false);
             std::cout << " to register " << args[2] << '\n';
         } else {
             std::cerr << "Usage: 'print', 'read <reg>' or 'write <reg> <val>'\n";
         }
-    } else if (Utils::is_prefixed_by(cmd, "memory")) {
-        auto addr = std::stol(args[2], nullptr, 16);
+    } else if (name == "memory") {
+        auto addr = std::stoul(args[2], nullptr, 16);
         if (Utils::is_prefixed_by(args[1], "read")) {
-            Utils::print_hex(read_memory(addr));
+            if (args.size() > 3) {
+                dump_memory(addr, std::stoul(args[3], nullptr, 0));
+            } else {
+                Utils::print_hex(read_memory(addr));
+            }
         } else if (Utils::is_prefixed_by(args[1], "write")) {
-            auto val = std::stol(args[3], nullptr, 16);
+            auto val = std::stoul(args[3], nullptr, 16);
             write_memory(addr, val);
+        } else if (Utils::is_prefixed_by(args[1], "dump")) {
+            auto end = std::stoul(args[3], nullptr, 16);
+            dump_memory(addr, end > addr ? end - addr : 0);
         } else {
-            std::cerr << "Usage: 'print', 'read <reg>' or 'write <reg> <val>'\n";
+            std::cerr << "Usage: 'read <addr> [len]', 'write <addr> <val>' or 'dump <start> <end>'\n";
+        }
+    } else if (name == "print") {
+        // print <variable>[.member|->member|[index]...], optionally after * or &
+        if (args.size() > 1) {
+            print_variable(line.substr(line.find(' ') + 1));
+        } else {
+            std::cerr << "Usage: 'print <variable>'\n";
         }
-    } else if (Utils::is_prefixed_by(cmd, "symbol")) {
-        auto symbols = _dwarf_ctx.lookup_symbol(args[1]);
-        for (auto&& s : symbols) {
+    } else if (name == "profile") {
+        // profile <seconds> [hz] [file]
+        profile(std::stod(args[1]), args.size() > 2 ? std::stoul(args[2]) : 99, args.size() > 3 ? args[3] : "");
+    } else if (name == "gcore") {
+        generate_core(args.size() > 1 ? args[1] : "core." + std::to_string(_pid));
+    } else if (name == "checkpoint") {
+        // checkpoint [list | delete <n>]
+        if (args.size() < 2) {
+            checkpoint();
+        } else if (Utils::is_prefixed_by(args[1], "list")) {
+            print_checkpoints();
+        } else if (Utils::is_prefixed_by(args[1], "delete") && args.size() > 2) {
+            delete_checkpoint(std::stoul(args[2]));
+        } else {
+            std::cerr << "Usage: 'checkpoint', 'checkpoint list' or 'checkpoint delete <n>'\n";
+        }
+    } else if (name == "catch" || name == "trace") {
+        // catch syscall [<name>,... | all | none], trace syscall [<name>,... | all | none]
+        if (args.size() > 1 && Utils::is_prefixed_by(args[1], "syscall")) {
+            set_syscall_flags(args, name != "trace");
+        } else {
+            std::cerr << "Usage: 'catch syscall [<name>,... | all | none]' or 'trace syscall [<name>,... | all | none]'\n";
+        }
+    } else if (name == "restart") {
+        if (args.size() < 2) {
+            std::cerr << "Usage: 'restart <n>'\n";
+        } else {
+            restart(std::stoul(args[1]));
+        }
+    } else if (name == "detach") {
+        detach();
+    } else if (name == "thread") {
+        select_thread(std::stoi(args[1]));
+    } else if (name == "threads") {
+        print_threads();
+    } else if (name == "tracepoint") {
+        // tracepoint <location> | list | delete <n> | records <n> | log <file|off>
+        if (args.size() < 2) {
+            std::cerr << "Usage: 'tracepoint <location>', 'list', 'delete <n>', 'records <n>' or 'log <file|off>'\n";
+        } else if (args[1] == "list") {
+            _tracepoints.print(std::cout, _abs_load_addr);
+        } else if (args[1] == "delete") {
+            _tracepoints.remove(std::stoul(args[2]), _memory);
+        } else if (args[1] == "records") {
+            _tracepoints.print_records(std::stoul(args[2]), std::cout);
+        } else if (args[1] == "log") {
+            _tracepoints.set_log(args.size() > 2 && args[2] != "off" ? args[2] : "");
+        } else {
+            set_tracepoint(resolve_location(args[1]));
+        }
+    } else if (name == "coverage") {
+        // coverage run [file] | report | stop
+        if (args.size() >= 2 && args[1] == "run") {
+            start_coverage(args.size() > 2 ? args[2] : "coverage.info");
+        } else if (args.size() >= 2 && args[1] == "report") {
+            write_coverage();
+        } else if (args.size() >= 2 && args[1] == "stop") {
+            stop_coverage();
+        } else {
+            std::cerr << "Usage: 'coverage run [file]', 'coverage report' or 'coverage stop'\n";
+        }
+    } else if (name == "modules") {
+        print_modules();
+    } else if (name == "symbol") {
+        auto print_symbol = [](const DwarfContext::Symbol& s) {
             std::cout << s.name << ' ' << to_string(s.type) << " 0x" << std::hex << s.addr << '\n';
+        };
+        if (args[1][0] == '0' && args[1][1] == 'x') {   // 0xADDRESS
+            auto s = _dwarf_ctx.lookup_symbol_by_address(std::stol(args[1], nullptr, 16));
+            if (s != nullptr) {
+                print_symbol(*s);
+            }
+        } else if (args[1].find_first_of("*?[") != std::string::npos) {    // glob pattern
+            std::vector<const DwarfContext::Symbol*> symbols;
+            _dwarf_ctx.lookup_symbol_glob(args[1], symbols);
+            for (auto s : symbols) {
+                print_symbol(*s);
+            }
+        } else {
+            for (auto& s : _dwarf_ctx.lookup_symbol(args[1])) {
+                print_symbol(s);
+            }
+        }
+    } else if (name == "stats") {
+        // stats [json [file] | reset]
+        if (args.size() < 2) {
+            Stats::print();
+        } else if (Utils::is_prefixed_by(args[1], "json")) {
+            if (args.size() > 2) {
+                std::ofstream out {args[2]};
+                Stats::dump_json(out);
+            } else {
+                Stats::dump_json(std::cout);
+            }
+        } else if (Utils::is_prefixed_by(args[1], "reset")) {
+            Stats::reset();
         }
-    } else {
-        std::cerr << "Unknown command\n";
     }
 }
 
+// Set the system calls the launched process filters, all traced to begin with (see SyscallFilter)
+void Debugger::filter_syscalls(const std::vector<long>& nrs) {
+    _syscalls.reset(nrs);
+}
+
 // COMMAND: Continue execution
 void Debugger::continue_execution() {
-    // Step over any possible breakpoint and continue execution
-    single_step_instruction();
-    ptrace(PTRACE_CONT, _pid, nullptr, nullptr);
+    // Resume all threads (stepping them over any breakpoint first), until a stop that should be reported
+    resume_all();
     wait_for_signal();
 }
 
+// COMMAND: Sample the call stacks of all threads hz times per second, then print them as collapsed stacks (one
+// 'outer;...;inner count' line per distinct stack, the input of flame graph tools) to stdout or a file
+void Debugger::profile(double seconds, unsigned hz, const std::string& out_path) {
+    if (!(seconds > 0) || seconds > MAX_PROFILE_SECONDS) {     // Also rejects NaN
+        std::cerr << "Duration must be between 0 and " << MAX_PROFILE_SECONDS << " seconds\n";
+        return;
+    }
+    if (hz == 0 || hz > 10000) {
+        std::cerr << "Sampling frequency must be between 1 and 10000 Hz\n";
+        return;
+    }
+    auto num_ticks = static_cast<uint64_t>(seconds * hz);
+    auto interval = std::chrono::nanoseconds{1000000000 / hz};
+    Profiler profiler{std::min<std::size_t>(num_ticks * _threads.size() + 1, MAX_PROFILE_STACKS)};
+    uint64_t pcs[Profiler::MAX_DEPTH];
+    std::chrono::nanoseconds paused{0};
+
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    bool reported = false;
+    resume_all();
+    for (uint64_t tick = 0; tick < num_ticks && !reported; tick++) {
+        next += interval;
+        std::this_thread::sleep_until(next);
+
+        auto stop_start = std::chrono::steady_clock::now();
+        stop_all_threads();
+        for (auto& [tid, thread] : _threads) {
+            if (thread.started && thread.pending_status == -1) {
+                profiler.add(pcs, sample_stack(thread, pcs));
+            }
+        }
+        resume_all();
+
+        // Events caught while stopping the threads are handled as usual; one that should be reported ends the profile
+        while (!reported && !_pending.empty()) {
+            auto& thread = _threads.at(_pending.front());
+            _pending.pop_front();
+            auto wait_status = thread.pending_status;
+            thread.pending_status = -1;
+            reported = handle_event(thread, wait_status);
+        }
+        paused += std::chrono::steady_clock::now() - stop_start;
+    }
+    stop_all_threads();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Symbolise every distinct PC once, merging stacks that only differ in PCs within the same functions
+    std::unordered_map<uint64_t, std::string> names;
+    std::map<std::string, uint64_t> collapsed;
+    std::unordered_map<uint64_t, uint64_t> leaf_counts;
+    profiler.for_each([&](const uint64_t *stack, std::size_t depth, uint64_t count) {
+        std::string line;
+        for (auto i = depth; i-- > 0;) {
+            // Return addresses point after the call, which may already be the next function or line
+            auto pc = i == 0 ? stack[i] : stack[i] - 1;
+            auto iter = names.find(pc);
+            if (iter == names.end()) {
+                iter = names.emplace(pc, get_frame_name(pc)).first;
+            }
+            line += iter->second;
+            line += i == 0 ? ' ' : ';';
+        }
+        collapsed[line] += count;
+        leaf_counts[stack[0]] += count;
+    });
+
+    std::ofstream ofs;
+    if (!out_path.empty()) {
+        ofs.open(out_path);
+    }
+    auto& out = out_path.empty() ? std::cout : ofs;
+    for (auto& [line, count] : collapsed) {
+        out << line << std::dec << count << '\n';
+    }
+
+    // Hottest source lines, by samples whose innermost PC is on them
+    std::unordered_map<std::string, uint64_t> line_counts;
+    for (auto& [pc, count] : leaf_counts) {
+        uint64_t load_addr;
+        auto ctx = get_context(pc, load_addr);
+        try {
+            if (ctx != nullptr) {
+                auto& entry = ctx->get_line_from_pc(pc - load_addr);
+                line_counts[ctx->get_file_name(entry) + ":" + std::to_string(entry.line)] += count;
+            }
+        } catch (const std::out_of_range&) {}
+    }
+    std::vector<std::pair<std::string, uint64_t>> hot_lines(line_counts.begin(), line_counts.end());
+    std::sort(hot_lines.begin(), hot_lines.end(), [](auto& a, auto& b) { return a.second > b.second; });
+    if (hot_lines.size() > 10) {
+        hot_lines.resize(10);
+    }
+
+    auto total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    std::cout << "Profiled " << std::dec << profiler.get_samples() << " samples (" << profiler.size()
+              << " distinct stacks, " << profiler.get_dropped() << " dropped) over " << total_ns / 1000000
+              << " ms; the process was paused " << (total_ns > 0 ? paused.count() * 100 / total_ns : 0)
+              << "% of the time\n";
+    for (auto& [source_line, count] : hot_lines) {
+        std::cout << "  " << source_line << ' ' << count * 100 / std::max<uint64_t>(profiler.get_samples(), 1)
+                  << "%\n";
+    }
+    if (!out_path.empty()) {
+        std::cout << "Wrote collapsed stacks to " << out_path << '\n';
+    }
+}
+
+// COMMAND: Write a core file of the stopped process. Breakpoints are lifted for the dump, so the core shows the
+// original code
+void Debugger::generate_core(const std::string& path) {
+    std::vector<CoreFile::ThreadState> threads;
+    threads.push_back(CoreFile::ThreadState{_thread->tid, _stop_signal, _thread->regs.get_all()});
+    for (auto& [tid, thread] : _threads) {
+        if (&thread != _thread && thread.started) {
+            threads.push_back(CoreFile::ThreadState{tid, thread.pending_signal, thread.regs.get_all()});
+        }
+    }
+
+    std::vector<Breakpoint*> bps;
+    for (auto& [addr, bp] : _breakpoints) {
+        bps.push_back(&bp);
+    }
+    Breakpoint::disable_all(_memory, bps);
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        auto written = CoreFile::dump(_pid, _memory, threads, path);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "Saved core file " << path << ": " << std::dec << written / (1024 * 1024) << " MB of memory ("
+                  << "zero pages skipped) in " << us.count() / 1000 << " ms, "
+                  << (us.count() > 0 ? written / us.count() : 0) << " MB/s\n";
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n';
+    }
+    Breakpoint::enable_all(_memory, bps);
+}
+
+// Ptrace options of the threads of the process
+long Debugger::trace_options() const {
+    // An attached process must survive us, a launched one (or a fork of it) must not. The stops of a system call
+    // filter must be asked for, and exits from system calls we trace told apart from SIGTRAPs. Forks inherit the
+    // filter, so they are traced too: their filtered system calls would fail with ENOSYS otherwise
+    return PTRACE_O_TRACECLONE | (_seized ? 0 : PTRACE_O_EXITKILL) |
+           (_syscalls.empty() ? 0 : PTRACE_O_TRACESECCOMP | PTRACE_O_TRACESYSGOOD |
+                                    PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK);
+}
+
+// Make a stopped thread call fork(), by pointing it at a syscall instruction patched over its PC. The thread's
+// registers and text are restored afterwards, and the child is left stopped (and traced) in the same state, with
+// the same breakpoints inserted. A signal that arrives meanwhile is returned in signal, to be delivered later
+pid_t Debugger::inject_fork(pid_t tid, ProcessMemory& memory, long options, int& signal) {
+    static const uint8_t syscall_insn[] = {0x0f, 0x05};
+    user_regs_struct regs{};
+    Stats::ptrace(PTRACE_GETREGS, tid, nullptr, &regs);
+    uint8_t saved[sizeof(syscall_insn)];
+    if (memory.read(regs.rip, saved, sizeof(saved)) != sizeof(saved) ||
+        memory.write_forced(regs.rip, syscall_insn, sizeof(syscall_insn)) != sizeof(syscall_insn)) {
+        throw std::invalid_argument{"Cannot patch the code of process " + std::to_string(tid)};
+    }
+
+    auto call = regs;
+    call.rax = SYS_fork;
+    call.orig_rax = -1;     // Not in a system call, which the kernel could otherwise restart
+    Stats::ptrace(PTRACE_SETREGS, tid, nullptr, &call);
+    Stats::ptrace(PTRACE_SETOPTIONS, tid, nullptr, options | PTRACE_O_TRACEFORK);
+
+    // The fork is reported first, then the end of the step over the syscall
+    pid_t child = -1;
+    int wait_status;
+    Stats::ptrace(PTRACE_SINGLESTEP, tid, nullptr, nullptr);
+    while (Stats::waitpid(tid, &wait_status, __WALL) != -1 && WIFSTOPPED(wait_status)) {
+        if ((wait_status >> 16) == PTRACE_EVENT_FORK) {
+            unsigned long new_pid;
+            Stats::ptrace(PTRACE_GETEVENTMSG, tid, nullptr, &new_pid);
+            child = static_cast<pid_t>(new_pid);
+        } else if ((wait_status >> 16) == PTRACE_EVENT_SECCOMP) {
+            // fork() is filtered: stepping on runs it
+        } else if (WSTOPSIG(wait_status) == SIGTRAP) {
+            break;
+        } else if ((wait_status >> 16) == 0) {
+            signal = WSTOPSIG(wait_status);
+        }
+        Stats::ptrace(PTRACE_SINGLESTEP, tid, nullptr, nullptr);
+    }
+
+    Stats::ptrace(PTRACE_SETOPTIONS, tid, nullptr, options);
+    memory.write_forced(regs.rip, saved, sizeof(saved));
+    Stats::ptrace(PTRACE_SETREGS, tid, nullptr, &regs);
+    if (child <= 0) {
+        throw std::invalid_argument{"fork() failed in process " + std::to_string(tid)};
+    }
+
+    // The child starts with a stop of its own, just after the syscall and with our patch in its copy of the text
+    while (Stats::waitpid(child, &wait_status, __WALL) != -1 && !WIFSTOPPED(wait_status)) {}
+    ProcessMemory child_memory {child};
+    child_memory.write_forced(regs.rip, saved, sizeof(saved));
+    Stats::ptrace(PTRACE_SETREGS, child, nullptr, &regs);
+    Stats::ptrace(PTRACE_SETOPTIONS, child, nullptr, options | PTRACE_O_EXITKILL);
+    return child;
+}
+
+// Make a stopped thread run a system call, like inject_fork, returning its result (-errno on failure)
+long Debugger::inject_syscall(Thread& thread, long nr, std::initializer_list<uint64_t> args) {
+    static const uint8_t syscall_insn[] = {0x0f, 0x05};
+    thread.regs.flush();
+    user_regs_struct regs{};
+    Stats::ptrace(PTRACE_GETREGS, thread.tid, nullptr, &regs);
+    uint8_t saved[sizeof(syscall_insn)];
+    if (_memory.read(regs.rip, saved, sizeof(saved)) != sizeof(saved) ||
+        _memory.write_forced(regs.rip, syscall_insn, sizeof(syscall_insn)) != sizeof(syscall_insn)) {
+        throw std::invalid_argument{"Cannot patch the code of process " + std::to_string(thread.tid)};
+    }
+
+    auto call = regs;
+    call.rax = nr;
+    call.orig_rax = -1;
+    unsigned long long *arg_regs[] = {&call.rdi, &call.rsi, &call.rdx, &call.r10, &call.r8, &call.r9};
+    std::size_t i = 0;
+    for (auto arg : args) {
+        *arg_regs[i++] = arg;
+    }
+    Stats::ptrace(PTRACE_SETREGS, thread.tid, nullptr, &call);
+
+    int wait_status;
+    Stats::ptrace(PTRACE_SINGLESTEP, thread.tid, nullptr, nullptr);
+    while (Stats::waitpid(thread.tid, &wait_status, __WALL) != -1 && WIFSTOPPED(wait_status)) {
+        if ((wait_status >> 16) == PTRACE_EVENT_SECCOMP) {
+            // Filtered: stepping on runs it
+        } else if (WSTOPSIG(wait_status) == SIGTRAP) {
+            break;
+        } else if ((wait_status >> 16) == 0) {
+            thread.pending_signal = WSTOPSIG(wait_status);
+        }
+        Stats::ptrace(PTRACE_SINGLESTEP, thread.tid, nullptr, nullptr);
+    }
+
+    Stats::ptrace(PTRACE_GETREGS, thread.tid, nullptr, &call);
+    _memory.write_forced(regs.rip, saved, sizeof(saved));
+    Stats::ptrace(PTRACE_SETREGS, thread.tid, nullptr, &regs);
+    return static_cast<long>(call.rax);
+}
+
+// COMMAND: Save the state of the process in a forked copy of it. Its pages are shared copy-on-write, so this
+// takes about as long as a fork. Only the current thread is copied
+void Debugger::checkpoint() {
+    if (_exited) {
+        throw std::out_of_range{"The process has exited"};
+    }
+    if (_coverage.is_running()) {
+        throw std::invalid_argument{"Cannot checkpoint while measuring coverage (the copy would keep its int3s)"};
+    }
+    auto start = std::chrono::steady_clock::now();
+    _thread->regs.flush();
+    Checkpoint cp {inject_fork(_thread->tid, _memory, trace_options(), _thread->pending_signal), get_pc()};
+    cp.tracepoints = _tracepoints.is_mapped();  // The area is shared, so the copy uses it too
+    for (auto& [addr, bp] : _breakpoints) {
+        if (bp.is_enabled()) {
+            cp.breakpoints.emplace_back(bp.get_address(), bp.get_saved_byte());
+        }
+    }
+    auto id = _next_checkpoint++;
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Checkpoint " << std::dec << id << ": process " << cp.pid << " at " << get_frame_name(cp.pc)
+              << ", taken in " << us.count() << " us\n";
+    _checkpoints.emplace(id, std::move(cp));
+}
+
+// COMMAND: Go back to a checkpoint. The process is replaced by a new fork of the checkpoint, so the checkpoint
+// itself is left as it was and can be restarted again
+void Debugger::restart(unsigned id) {
+    auto iter = _checkpoints.find(id);
+    if (iter == _checkpoints.end()) {
+        throw std::out_of_range{"No checkpoint " + std::to_string(id)};
+    }
+    auto& cp = iter->second;
+    ProcessMemory cp_memory {cp.pid};
+    int signal = 0;
+    auto pid = inject_fork(cp.pid, cp_memory, trace_options() | PTRACE_O_EXITKILL, signal);
+    kill_process();
+
+    _pid = pid;
+    _threads.clear();
+    _pending.clear();
+    _thread = &_threads.emplace(pid, pid).first->second;
+    _thread->started = true;
+    _resumed_all = false;
+    _exited = false;
+    _stop_signal = SIGTRAP;
+    _memory.reset(pid);
+    _hw_breakpoints.retarget(pid);
+
+    // The copy has the breakpoints of the time of the checkpoint: bring it in line with the ones we have now
+    std::unordered_map<std::uintptr_t, uint8_t> inserted {cp.breakpoints.begin(), cp.breakpoints.end()};
+    for (auto& [addr, bp] : _breakpoints) {
+        if (bp.is_enabled() && inserted.erase(bp.get_address()) == 0) {
+            uint8_t int3 = BREAKPOINT_INT3;
+            _memory.write_forced(bp.get_address(), &int3, 1);
+        }
+    }
+    for (auto& [addr, byte] : inserted) {
+        _memory.write_forced(addr, &byte, 1);
+    }
+    // Likewise for the tracepoints (whose trampolines are never removed, so any left in the copy still work)
+    if (_tracepoints.is_mapped() && cp.tracepoints) {
+        _tracepoints.reinsert(_memory);
+    } else if (_tracepoints.is_mapped()) {
+        std::cout << "The checkpoint is older than the tracepoints, which are deleted\n";
+        _tracepoints.unmap();
+    }
+    // Checkpoints predate any coverage run, so the copy has none of its int3s
+    if (_coverage.is_running()) {
+        std::cout << "Coverage is no longer measured\n";
+        _coverage.abandon();
+    }
+    if (!_modules.update(_pid, _memory)) {
+        std::cout << "Shared libraries were being loaded or unloaded: they are listed once that is done\n";
+    }
+
+    std::cout << "Restarted checkpoint " << std::dec << id << " as process " << pid << '\n';
+    print_source_lines(get_offset_pc(), 1);
+}
+
+// COMMAND: List the checkpoints
+void Debugger::print_checkpoints() {
+    for (auto& [id, cp] : _checkpoints) {
+        std::cout << std::dec << id << ": process " << cp.pid << " at " << get_frame_name(cp.pc);
+        try {
+            auto& line_entry = _dwarf_ctx.get_line_from_pc(cp.pc - _abs_load_addr);
+            std::cout << " (" << _dwarf_ctx.get_file_name(line_entry) << ':' << line_entry.line << ')';
+        } catch (const std::out_of_range&) {}
+        std::cout << '\n';
+    }
+}
+
+// COMMAND: Delete a checkpoint, killing its process
+void Debugger::delete_checkpoint(unsigned id) {
+    auto iter = _checkpoints.find(id);
+    if (iter == _checkpoints.end()) {
+        throw std::out_of_range{"No checkpoint " + std::to_string(id)};
+    }
+    kill(iter->second.pid, SIGKILL);
+    Stats::waitpid(iter->second.pid, nullptr, __WALL);
+    _checkpoints.erase(iter);
+}
+
+// A checkpoint reported an event (a signal sent to its process group, say): it is left stopped, as resuming it
+// would change the state it saved, or forgotten if it was killed. Returns false if pid is not a checkpoint
+bool Debugger::handle_checkpoint_event(pid_t pid, int status) {
+    for (auto iter = _checkpoints.begin(); iter != _checkpoints.end(); iter++) {
+        if (iter->second.pid == pid) {
+            if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                std::cout << "Checkpoint " << std::dec << iter->first << " is gone (process " << pid << " ended)\n";
+                _checkpoints.erase(iter);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// Kill the process (unless it has exited already) and collect all of its threads
+void Debugger::kill_process() {
+    if (_exited) {
+        return;
+    }
+    kill(_pid, SIGKILL);
+    auto collect = [](pid_t tid) {
+        int wait_status;
+        while (Stats::waitpid(tid, &wait_status, __WALL) != -1 && !WIFEXITED(wait_status) && !WIFSIGNALED(wait_status)) {}
+    };
+    // The exit of the main thread is only reported once the other threads are gone
+    for (auto& [tid, thread] : _threads) {
+        if (tid != _pid) {
+            collect(tid);
+        }
+    }
+    collect(_pid);
+}
+
+// Unwind the stack of a stopped thread, filling pcs innermost first. Returns the depth
+std::size_t Debugger::sample_stack(Thread& thread, uint64_t *pcs) {
+    Unwinder::Frame frames[Profiler::MAX_DEPTH];
+    auto depth = unwind(thread, frames, Profiler::MAX_DEPTH, PROFILE_SNAPSHOT_SIZE);
+    for (std::size_t i = 0; i < depth; i++) {
+        pcs[i] = frames[i].pc;
+    }
+    return depth;
+}
+
+// Unwind the stack of a stopped thread with its CFI, from one bulk read of the top of the stack
+std::size_t Debugger::unwind(Thread& thread, Unwinder::Frame *frames, std::size_t max, std::size_t snapshot_size) {
+    auto& regs = thread.regs.get_all();
+    _stack.read(_memory, regs.rsp, snapshot_size);
+    return Unwinder::unwind(regs, [this](uint64_t pc, uint64_t& load_addr) -> const Unwinder* {
+        auto ctx = get_context(pc, load_addr);
+        return ctx != nullptr ? &ctx->get_unwinder() : nullptr;
+    }, _stack, frames, max);
+}
+
+// Name of the function containing an absolute PC, from DWARF or else the symbol table
+std::string Debugger::get_frame_name(uint64_t pc) {
+    uint64_t load_addr;
+    auto ctx = get_context(pc, load_addr);
+    if (ctx == nullptr) {
+        return "[unknown]";
+    }
+    auto rel_pc = pc - load_addr;
+    try {
+        auto die = ctx->get_function_from_pc(rel_pc);
+        if (die.has(dwarf::DW_AT::name)) {
+            return dwarf::at_name(die);
+        }
+    } catch (const std::out_of_range&) {}
+
+    auto symbol = ctx->lookup_symbol_by_address(rel_pc);
+    return symbol != nullptr ? std::string{symbol->name} : "[unknown]";
+}
+
+// Track shared libraries: break where the dynamic linker reports changes to its list of loaded objects
+void Debugger::init_modules() {
+    watch_modules(_modules.init(_pid));
+}
+
+// Break on _dl_debug_state (absolute, found by ModuleMap::init) and read the current list of shared libraries
+void Debugger::watch_modules(uint64_t debug_state) {
+    if (debug_state == 0) {
+        return;     // Statically linked
+    }
+    _debug_state_bp = debug_state - _abs_load_addr;
+    if (_breakpoints.count(_debug_state_bp) == 0) {
+        set_breakpoint(_debug_state_bp, false);
+    }
+    if (!_modules.update(_pid, _memory)) {
+        std::cout << "Shared libraries are being loaded or unloaded: they are listed once that is done\n";
+    }
+}
+
+// DWARF, symbols and CFI for an absolute address: those of the shared library it is in, or else the program's
+DwarfContext* Debugger::get_context(uint64_t pc, uint64_t& load_addr) {
+    auto module = _modules.find(pc);
+    if (module == nullptr) {
+        load_addr = _abs_load_addr;
+        return &_dwarf_ctx;
+    }
+    load_addr = module->load_addr;
+    return _modules.get_context(*module);
+}
+
+// COMMAND: List the shared libraries of the debuggee
+void Debugger::print_modules() {
+    for (auto& module : _modules.get_modules()) {
+        std::cout << "0x" << std::hex << module.low << "-0x" << module.high << ' ' << module.path
+                  << (_modules.is_loaded(module) ? " (symbols loaded)" : "") << '\n';
+    }
+}
+
+// COMMAND: List the threads of the debuggee
+void Debugger::print_threads() {
+    for (auto& [tid, thread] : _threads) {
+        if (!thread.started) {
+            continue;
+        }
+        std::cout << (&thread == _thread ? "* " : "  ") << std::dec << tid << " 0x" << std::hex
+                  << thread.regs.get(Reg::rip) - _abs_load_addr << '\n';
+    }
+}
+
+// COMMAND: Switch the current thread
+void Debugger::select_thread(pid_t tid) {
+    auto iter = _threads.find(tid);
+    if (iter == _threads.end() || !iter->second.started) {
+        std::cerr << "No such thread\n";
+        return;
+    }
+    _thread = &iter->second;
+    std::cout << "Switched to thread " << std::dec << tid << '\n';
+    print_source_lines(get_offset_pc(), 1);
+}
+
 // COMMAND: Set breakpoint
 void Debugger::set_breakpoint_cmd(const std::string& address) {
     // TODO: more robust address parsing (same for memory/register writing)
     set_breakpoint(std::stol(address, nullptr, 16)); // assumes address is 0xADDR
 }
 
+// Get the relative address of a location given as 0xADDRESS, file:line or a function name
+std::uintptr_t Debugger::resolve_location(const std::string& location) {
+    if (location[0] == '0' && location[1] == 'x') {
+        return std::stol(location, nullptr, 16);
+    } else if (location.find(':') != std::string::npos) {
+        auto file_line = Utils::split_by(location, ':');
+        return _dwarf_ctx.get_source_line(file_line[0], std::stoi(file_line[1]));
+    }
+    try {
+        return _dwarf_ctx.get_function_by_name(location);
+    } catch (const std::out_of_range&) {}
+
+    // A function of a shared library, from its symbol table (relative to the program, like every breakpoint).
+    // Only the module it is found in loads its DWARF, which then indexes while the program runs to the breakpoint
+    for (auto& module : _modules.get_modules()) {
+        auto symbols = _modules.get_symbols(module.path);
+        if (symbols == nullptr) {
+            continue;
+        }
+        for (auto& symbol : symbols->find(location)) {
+            if (symbol.type == SymbolIndex::SymbolType::Function && symbol.addr != 0) {
+                _modules.get_context(module);
+                return module.load_addr + symbol.addr - _abs_load_addr;
+            }
+        }
+    }
+    throw std::out_of_range{"Cannot find function " + location};
+}
+
 // Sets (and enables) a breakpoint at an address
 void Debugger::set_breakpoint(std::uintptr_t addr, bool print) {
+    if (_tracepoints.overlaps(addr + _abs_load_addr)) {
+        throw std::invalid_argument{"Cannot set a breakpoint in the instructions replaced by a tracepoint"};
+    }
     if (print) { std::cout << "Set breakpoint at address "; Utils::print_hex(addr); }
+    _coverage.take(addr + _abs_load_addr, _memory);
     Breakpoint bp {_pid, addr + _abs_load_addr};
-    bp.enable();
+    bp.enable(_memory);
     _breakpoints[addr] = bp;    // Index by relative address (without absolute load addr)
 }
 
 // Removes (and disables) a breakpoint
 void Debugger::remove_breakpoint(std::uintptr_t addr, bool print) {
     if (_breakpoints.count(addr) != 0) {
-        _breakpoints[addr].disable();
+        _breakpoints[addr].disable(_memory);
+        if (_breakpoints[addr].is_enabled()) {
+            std::cerr << "Could not remove the breakpoint at 0x" << std::hex << addr << std::dec << '\n';
+            return;
+        }
         _breakpoints.erase(addr);
+        _coverage.put_back(addr + _abs_load_addr, _memory);
         if (print) { std::cout << "Removed breakpoint at address "; Utils::print_hex(addr); }
     }
 }
@@ -200,11 +1537,243 @@ void Debugger::remove_breakpoint(std::uintptr_t addr, bool print) {
 // Disables a breakpoint without removing it
 void Debugger::disable_breakpoint(std::uintptr_t addr, bool print) {
     if (_breakpoints.count(addr) != 0) {
-        _breakpoints[addr].disable();
+        _breakpoints[addr].disable(_memory);
         if (print) { std::cout << "Disabled breakpoint at address "; Utils::print_hex(addr); }
     }
 }
 
+// Sets a breakpoint that only stops when a condition holds (the condition is compiled once, here)
+void Debugger::set_breakpoint_condition(std::uintptr_t addr, const std::string& condition) {
+    try {
+        auto cond = std::make_shared<const Condition>(Condition::compile(condition));
+        if (_breakpoints.count(addr) == 0) {
+            set_breakpoint(addr);
+        }
+        _breakpoints[addr].set_condition(cond);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+// Ignore the next count hits of a breakpoint
+void Debugger::set_ignore_count(std::uintptr_t addr, uint64_t count) {
+    if (_breakpoints.count(addr) == 0) {
+        std::cerr << "No breakpoint at that address\n";
+        return;
+    }
+    _breakpoints[addr].set_ignore_count(count);
+    std::cout << "Will ignore next " << std::dec << count << " hits of breakpoint at "; Utils::print_hex(addr);
+}
+
+// Sets (and enables) breakpoints at many addresses at once, patching each page with a single transfer
+void Debugger::set_breakpoints(const std::vector<std::uintptr_t>& addrs) {
+    std::vector<Breakpoint*> bps;
+    bps.reserve(addrs.size());
+    for (auto addr : addrs) {
+        auto& bp = _breakpoints[addr];
+        if (!bp.is_enabled()) {
+            _coverage.take(addr + _abs_load_addr, _memory);
+            bp = Breakpoint{_pid, addr + _abs_load_addr};
+        }
+        bps.push_back(&bp);
+    }
+    Breakpoint::enable_all(_memory, bps);
+}
+
+// Removes (and disables) breakpoints at many addresses at once, restoring each page with a single transfer
+void Debugger::remove_breakpoints(const std::vector<std::uintptr_t>& addrs) {
+    std::vector<Breakpoint*> bps;
+    bps.reserve(addrs.size());
+    for (auto addr : addrs) {
+        auto iter = _breakpoints.find(addr);
+        if (iter != _breakpoints.end()) {
+            bps.push_back(&iter->second);
+        }
+    }
+    Breakpoint::disable_all(_memory, bps);
+    for (auto addr : addrs) {
+        auto iter = _breakpoints.find(addr);
+        if (iter == _breakpoints.end()) {
+            continue;
+        }
+        // An int3 that could not be written back stays tracked, so that hitting it is still recognised
+        if (iter->second.is_enabled()) {
+            std::cerr << "Could not remove the breakpoint at 0x" << std::hex << addr << std::dec << '\n';
+            continue;
+        }
+        _breakpoints.erase(iter);
+        _coverage.put_back(addr + _abs_load_addr, _memory);
+    }
+}
+
+// Sets a hardware breakpoint at an address (text is left untouched)
+void Debugger::set_hw_breakpoint(std::uintptr_t addr) {
+    try {
+        auto slot = _hw_breakpoints.set(addr + _abs_load_addr, HardwareBreakpoints::Type::Execute, 1);
+        std::cout << "Set hardware breakpoint " << slot << " at address "; Utils::print_hex(addr);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+// Sets a data watchpoint on len bytes at an address
+void Debugger::set_watchpoint(std::uintptr_t addr, std::size_t len, HardwareBreakpoints::Type type) {
+    try {
+        auto slot = _hw_breakpoints.set(addr + _abs_load_addr, type, len);
+        std::cout << "Set " << to_string(type) << " watchpoint " << slot << " on " << std::dec << len
+                  << " bytes at address "; Utils::print_hex(addr);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+// Removes a hardware breakpoint or watchpoint by slot
+void Debugger::remove_hw_breakpoint(int slot) {
+    try {
+        _hw_breakpoints.remove(slot);
+        std::cout << "Removed hardware breakpoint " << slot << '\n';
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+// Map the area of the tracepoints into the process, within reach of a jmp from near. The process creates the memfd
+// (so that we can open it through its /proc/<pid>/fd, being its tracer), maps it and closes it again
+void Debugger::map_tracepoint_area(uint64_t near) {
+    constexpr uint64_t STEP = 64 << 20;
+    static const char name[] = "tracepoints";
+    auto size = Tracepoints::get_area_size();
+
+    // The name goes past the red zone below the stack pointer, where the thread is not using the stack
+    auto name_addr = (_thread->regs.get(Reg::rsp) - 128 - sizeof(name)) & ~static_cast<uint64_t>(15);
+    _memory.write(name_addr, name, sizeof(name));
+    auto fd = inject_syscall(*_thread, SYS_memfd_create, {name_addr, MFD_CLOEXEC});
+    if (fd < 0) {
+        throw std::invalid_argument{std::string{"memfd_create failed in the process: "} + strerror(static_cast<int>(-fd))};
+    }
+    uint64_t remote = 0;
+    if (inject_syscall(*_thread, SYS_ftruncate, {static_cast<uint64_t>(fd), size}) == 0) {
+        // Below the code first (above it is the heap), then above the heap's likely reach
+        std::vector<uint64_t> hints;
+        auto base = near & ~static_cast<uint64_t>(0xfff);
+        for (uint64_t i = 1; i <= 16; i++) {
+            if (base > i * STEP + size + (1 << 20)) {
+                hints.push_back(base - i * STEP - size);
+            }
+        }
+        for (uint64_t i = 0; i < 8; i++) {
+            hints.push_back(base + (1ULL << 30) + i * STEP);
+        }
+        for (auto hint : hints) {
+            auto addr = static_cast<uint64_t>(inject_syscall(*_thread, SYS_mmap, {
+                hint, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED | MAP_FIXED_NOREPLACE,
+                static_cast<uint64_t>(fd), 0}));
+            if (addr == hint) {
+                remote = addr;
+                break;
+            }
+            if (addr < static_cast<uint64_t>(-4095)) {
+                inject_syscall(*_thread, SYS_munmap, {addr, size});     // The kernel ignored the flag
+            }
+        }
+    }
+
+    auto path = "/proc/" + std::to_string(_pid) + "/fd/" + std::to_string(fd);
+    auto local_fd = remote != 0 ? open(path.c_str(), O_RDWR) : -1;
+    inject_syscall(*_thread, SYS_close, {static_cast<uint64_t>(fd)});
+    if (local_fd == -1) {
+        if (remote != 0) {
+            inject_syscall(*_thread, SYS_munmap, {remote, size});
+        }
+        throw std::invalid_argument{"Cannot map the tracepoint area into the process"};
+    }
+    try {
+        _tracepoints.map(local_fd, remote);
+    } catch (const std::invalid_argument&) {
+        close(local_fd);
+        throw;
+    }
+    close(local_fd);
+}
+
+// COMMAND: Set a fast tracepoint. The first one maps the area of trampolines and records into the process
+void Debugger::set_tracepoint(std::uintptr_t addr) {
+    if (_coverage.is_running()) {
+        throw std::invalid_argument{"Cannot set a tracepoint while measuring coverage"};
+    }
+    auto abs_addr = addr + _abs_load_addr;
+    if (!_tracepoints.is_mapped()) {
+        map_tracepoint_area(abs_addr);
+    }
+    auto check = [&](uint64_t start, std::size_t len) {
+        for (auto& [rel_addr, bp] : _breakpoints) {
+            if (bp.is_enabled() && bp.get_address() >= start && bp.get_address() < start + len) {
+                throw std::invalid_argument{"A breakpoint is in the way"};
+            }
+        }
+        // A thread stopped in the middle would resume in the jmp
+        for (auto& [tid, thread] : _threads) {
+            auto pc = thread.regs.get(Reg::rip);
+            if (pc > start && pc < start + len) {
+                throw std::invalid_argument{"Thread " + std::to_string(tid) + " is stopped in the way"};
+            }
+        }
+        try {
+            auto& function = _dwarf_ctx.get_function_range_from_pc(addr);
+            if (addr + len > function.high) {
+                throw std::invalid_argument{"Too close to the end of the function to patch a jump"};
+            }
+        } catch (const std::out_of_range&) {}   // Not in the program (or without debug information)
+        // Branch targets (e.g. the top of a loop) usually start a line, so none may start in the middle
+        auto lines = _dwarf_ctx.get_lines_in(addr + 1, addr + len);
+        if (lines.first != lines.second) {
+            throw std::invalid_argument{"A line starts within the instructions to be replaced (code may jump to it)"};
+        }
+    };
+    auto id = _tracepoints.add(abs_addr, _memory, check);
+    std::cout << "Tracepoint " << std::dec << id << " at 0x" << std::hex << addr << '\n';
+}
+
+// COMMAND: Measure line coverage: plant a one-shot int3 at every statement of the program and continue. The
+// report is written when the process exits (or stops being measured)
+void Debugger::start_coverage(const std::string& path) {
+    if (_coverage.is_running()) {
+        throw std::invalid_argument{"Coverage is already being measured"};
+    }
+    if (!_tracepoints.empty()) {
+        throw std::invalid_argument{"Delete the tracepoints first: the instructions they replaced cannot be measured"};
+    }
+    auto start = std::chrono::steady_clock::now();
+    _coverage.start(path, _dwarf_ctx, _abs_load_addr, _memory,
+                    [&](uint64_t addr) { return _breakpoints.count(addr - _abs_load_addr) != 0; });
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Planted " << std::dec << _coverage.get_planted() << " one-shot breakpoints in " << ms.count()
+              << " ms, writing coverage to " << path << " when the process exits\n";
+    continue_execution();
+}
+
+// COMMAND: Stop measuring coverage: remove the int3s not hit yet and write the report
+void Debugger::stop_coverage() {
+    if (!_coverage.is_running()) {
+        throw std::invalid_argument{"Coverage is not being measured"};
+    }
+    _coverage.stop(_memory);
+    write_coverage();
+}
+
+// COMMAND: Write the coverage measured so far as an lcov tracefile
+void Debugger::write_coverage() {
+    if (_coverage.get_path().empty()) {
+        throw std::invalid_argument{"No coverage has been measured"};
+    }
+    std::ofstream lcov {_coverage.get_path()};
+    if (!lcov) {
+        throw std::invalid_argument{"Cannot write " + _coverage.get_path()};
+    }
+    _coverage.report(_dwarf_ctx, lcov, std::cout);
+    std::cout << "Wrote " << _coverage.get_path() << '\n';
+}
+
 // Set breakpoint on a function by name
 void Debugger::set_breakpoint_at_function(const std::string& name) {
     set_breakpoint(_dwarf_ctx.get_function_by_name(name));
@@ -216,40 +1785,99 @@ void Debugger::set_breakpoint_at_source_line(const std::string& filename, uint l
 }
 
 // COMMAND: Memory read
-uint64_t Debugger::read_memory(uint64_t addr) const {
-    return ptrace(PTRACE_PEEKDATA, _pid, addr + _abs_load_addr, nullptr);
+uint64_t Debugger::read_memory(uint64_t addr) {
+    return _memory.read_word(addr + _abs_load_addr);
 }
 
 // COMMAND: Memory write
-uint64_t Debugger::write_memory(uint64_t addr, uint8_t val) const {
-    return ptrace(PTRACE_POKEDATA, _pid, addr + _abs_load_addr, val);
+void Debugger::write_memory(uint64_t addr, uint64_t val) {
+    _memory.write_word(addr + _abs_load_addr, val);
+}
+
+// COMMAND: Memory dump (hex and ASCII), read in one bulk transfer
+void Debugger::dump_memory(uint64_t addr, std::size_t len) {
+    std::vector<uint8_t> buf(len);
+    auto n = _memory.read(addr + _abs_load_addr, buf.data(), len);
+    Utils::print_hexdump(addr, buf.data(), n);
+    if (n < len) {
+        std::cerr << "Could only read " << std::dec << n << " of " << len << " bytes\n";
+    }
 }
 
 // Print the values of the registers
-void Debugger::print_registers() const {
+void Debugger::print_registers() {
     for (int i = 0; i < NUM_REGS; i++) {
         Reg r = static_cast<Reg>(i);
         std::cout << get_reg_name(r) << " ";
-        Utils::print_hex(get_reg_value(_pid, r), true);
+        Utils::print_hex(_thread->regs.get(r), true);
+    }
+}
+
+// Print the call stack of the current thread
+void Debugger::print_backtrace() {
+    Unwinder::Frame frames[MAX_BACKTRACE];
+    auto n = unwind(*_thread, frames, MAX_BACKTRACE, STACK_SNAPSHOT_SIZE);
+    for (std::size_t i = 0; i < n; i++) {
+        // Return addresses point after the call, so look up the call itself
+        auto pc = i == 0 ? frames[i].pc : frames[i].pc - 1;
+        // Addresses in the program are shown relative to it, those in shared libraries as they are
+        auto module = _modules.find(pc);
+        std::cout << '#' << std::dec << i << " 0x" << std::hex
+                  << (module != nullptr ? frames[i].pc : frames[i].pc - _abs_load_addr) << " in " << get_frame_name(pc);
+        uint64_t load_addr;
+        auto ctx = get_context(pc, load_addr);
+        try {
+            if (ctx != nullptr) {
+                auto& line_entry = ctx->get_line_from_pc(pc - load_addr);
+                std::cout << " at " << ctx->get_file_name(line_entry) << ':' << std::dec << line_entry.line;
+            }
+        } catch (const std::out_of_range& oor) {}
+        if (module != nullptr) {
+            std::cout << " from " << module->path;
+        }
+        std::cout << '\n';
+    }
+}
+
+// COMMAND: Print a variable (or part of one) in scope at the PC of the current thread
+void Debugger::print_variable(const std::string& expression) {
+    auto pc = get_pc();
+    uint64_t load_addr;
+    auto ctx = get_context(pc, load_addr);
+    if (ctx == nullptr) {
+        throw std::out_of_range{"No debugging information at the current PC"};
+    }
+    ValuePrinter::Frame frame {_thread->regs.get_all(), pc - load_addr, load_addr, [this] {
+        // Without CFI for the function, assume it set up a frame pointer
+        Unwinder::Frame frames[1];
+        if (unwind(*_thread, frames, 1, STACK_SNAPSHOT_SIZE) > 0 && frames[0].cfa != 0) {
+            return frames[0].cfa;
+        }
+        return _thread->regs.get(Reg::rbp) + 2 * sizeof(uint64_t);
+    }};
+    try {
+        ValuePrinter{*ctx, _memory, std::move(frame)}.print(expression, std::cout);
+    } catch (const std::runtime_error& e) {     // Malformed DWARF
+        std::cerr << e.what() << '\n';
     }
 }
 
 // Print the source line(s), given the relative address
 void Debugger::print_source_lines(uint64_t addr, uint line_win_size) {
     try {
-        auto line_entry = _dwarf_ctx.get_line_from_pc(addr);   // DWARF stores relative addresses
-        _dwarf_ctx.print_source(line_entry->file->path, line_entry->line, line_win_size);
+        auto& line_entry = _dwarf_ctx.get_line_from_pc(addr);   // DWARF stores relative addresses
+        _dwarf_ctx.print_source(_dwarf_ctx.get_file_name(line_entry), line_entry.line, line_win_size);
     } catch (const std::out_of_range& oor) {}
 }
 
 // Get the program counter (rip)
-uint64_t Debugger::get_pc() const {
-    return get_reg_value(_pid, Reg::rip);
+uint64_t Debugger::get_pc() {
+    return _thread->regs.get(Reg::rip);
 }
 
 // Set the program counter (rip)
-void Debugger::set_pc(uint64_t pc) const {
-    set_reg_value(_pid, Reg::rip, pc);
+void Debugger::set_pc(uint64_t pc) {
+    _thread->regs.set(Reg::rip, pc);
 }
 
 // Helper function to get the PC relative to the load address
@@ -257,9 +1885,70 @@ inline uint64_t Debugger::get_offset_pc() {
     return get_pc() - _abs_load_addr;
 }
 
+// Resume the current thread alone (continue or single step)
+long Debugger::resume(__ptrace_request request) {
+    return resume_thread(*_thread, request);
+}
+
+// Resume a thread, writing back any register changes first and delivering the signal it stopped with
+long Debugger::resume_thread(Thread& thread, __ptrace_request request) {
+    thread.regs.flush();
+    thread.regs.invalidate();
+    // A thread in a traced system call is continued so that it stops again when the call returns
+    auto actual = request == PTRACE_CONT && !thread.syscall.empty() ? PTRACE_SYSCALL : request;
+    auto res = Stats::ptrace(actual, thread.tid, nullptr, static_cast<long>(thread.pending_signal));
+    thread.pending_signal = 0;
+    thread.running = res != -1;
+    thread.at_breakpoint = false;
+    thread.last_request = request;
+    return res;
+}
+
+// Resume every stopped thread without a pending event (all-stop mode: threads run and stop together)
+void Debugger::resume_all() {
+    for (auto& [tid, thread] : _threads) {
+        if (!thread.running && thread.pending_status == -1 && (thread.at_breakpoint || &thread == _thread)) {
+            step_over_breakpoint(thread);
+        }
+    }
+    _resumed_all = true;
+    for (auto& [tid, thread] : _threads) {
+        if (!thread.running && thread.pending_status == -1 && thread.started) {
+            resume_thread(thread, PTRACE_CONT);
+        }
+    }
+}
+
+// Single step one stopped thread over the breakpoint at its pc (if any) while all other threads are stopped
+void Debugger::step_over_breakpoint(Thread& thread) {
+    auto iter = _breakpoints.find(thread.regs.get(Reg::rip) - _abs_load_addr);
+    if (iter == _breakpoints.end() || !iter->second.is_enabled()) {
+        return;
+    }
+
+    auto& bp = iter->second;
+    bp.disable(_memory);
+    resume_thread(thread, PTRACE_SINGLESTEP);
+    int wait_status = 0;
+    while (Stats::waitpid(thread.tid, &wait_status, __WALL) != -1) {
+        thread.running = false;
+        if (!swallow_stop(thread, wait_status)) {
+            break;
+        }
+        resume_thread(thread, PTRACE_SINGLESTEP);
+    }
+    bp.enable(_memory);
+
+    // Anything but the end of the step (a signal, a clone, an exit) is kept for the next wait
+    if (!WIFSTOPPED(wait_status) || wait_status >> 8 != SIGTRAP) {
+        thread.pending_status = wait_status;
+        _pending.push_back(thread.tid);
+    }
+}
+
 // Perform a single step over an instruction via ptrace
 void Debugger::single_step() {
-    ptrace(PTRACE_SINGLESTEP, _pid, nullptr, nullptr);
+    resume(PTRACE_SINGLESTEP);
     wait_for_signal();
 }
 
@@ -271,10 +1960,10 @@ void Debugger::single_step_instruction() {
         auto& bp = _breakpoints[rel_addr];
         if (bp.is_enabled()) {
             // Restore original instruction at breakpoint address
-            bp.disable();
+            bp.disable(_memory);
             // Single step over the breakpoint and re-enable it
             single_step();
-            bp.enable();
+            bp.enable(_memory);
         }
     } else {
         single_step();  // No breakpoint, just single step as usual
@@ -283,84 +1972,241 @@ void Debugger::single_step_instruction() {
 
 // Step out of a function
 void Debugger::step_out() {
-    // Get the return address of the function, which is at 8 bytes from the frame pointer
-    auto fp = get_reg_value(_pid, Reg::rbp);
-    auto ret_addr = read_memory(fp + RET_ADDR_FRAME_OFFSET);
+    // Get the return address of the function by unwinding its frame (frame pointers may be omitted)
+    Unwinder::Frame frames[2];
+    if (unwind(*_thread, frames, 2, STACK_SNAPSHOT_SIZE) < 2) {
+        std::cerr << "Cannot find the caller of this function\n";
+        return;
+    }
 
     // Set a temporary breakpoint at the return address of a function if it does not already exist
+    auto rel_ret_addr = frames[1].pc - _abs_load_addr;
     bool remove_tmp_bp = false;
-    if (_breakpoints.count(ret_addr - _abs_load_addr) == 0) {
-        set_breakpoint(ret_addr, false);
+    if (_breakpoints.count(rel_ret_addr) == 0) {
+        set_breakpoint(rel_ret_addr, false);
         remove_tmp_bp = true;
     }
 
-    // Continue execution until end of function
-    continue_execution();
+    // Continue execution until end of function. After it returns, rsp is back at its CFA, so a hit with a lower
+    // rsp comes from a deeper (recursive) call returning
+    auto tid = _thread->tid;
+    do {
+        continue_execution();
+    } while (_thread->tid == tid && get_offset_pc() == rel_ret_addr && _thread->regs.get(Reg::rsp) < frames[0].cfa);
     if (remove_tmp_bp) {
-        remove_breakpoint(ret_addr, false);
+        remove_breakpoint(rel_ret_addr, false);
     }
 };
 
-// Step until we reach the next line of source code
-void Debugger::step_in() {
-    // Step through assembly representing the current line of source code
-    auto line = _dwarf_ctx.get_line_from_pc(get_offset_pc())->line;
-    while (_dwarf_ctx.get_line_from_pc(get_offset_pc())->line == line) {
-        single_step_instruction();
+// Run until the next taken branch (or just the next instruction if block is false or block stepping is unavailable)
+void Debugger::step_block(bool block) {
+    auto rel_addr = get_offset_pc();
+    if (_breakpoints.count(rel_addr) != 0 && _breakpoints[rel_addr].is_enabled()) {
+        single_step_instruction();  // Step over the breakpoint first
+        return;
+    }
+
+    if (block && _block_step && resume(PTRACE_SINGLEBLOCK) == -1) {
+        _block_step = false;
+    }
+    if (!block || !_block_step) {
+        resume(PTRACE_SINGLESTEP);
+    }
+    wait_for_signal();
+}
+
+// Run at full speed until the given (relative) address is reached
+void Debugger::run_to(std::uintptr_t addr) {
+    bool remove_tmp_bp = false;
+    if (_breakpoints.count(addr) == 0) {
+        set_breakpoint(addr, false);
+        remove_tmp_bp = true;
+    }
+    continue_execution();
+    if (remove_tmp_bp) {
+        remove_breakpoint(addr, false);
+    }
+}
+
+// Step until we reach the next line of source code, a basic block at a time (count_instructions reads a perf counter)
+void Debugger::step_in(bool count_instructions) {
+    auto start_pc = get_offset_pc();
+    auto line = _dwarf_ctx.get_line_from_pc(start_pc).line;
+
+    std::vector<std::uintptr_t> tmp_bps{};
+    bool known_function = true;
+    bool local_line = false;    // The line makes no call and no jump out of the function
+    uint64_t ret_addr = UINTPTR_MAX;
+    uint64_t cfa = 0;
+    try {
+        auto& func = _dwarf_ctx.get_function_range_from_pc(start_pc);
+        auto lines = _dwarf_ctx.get_lines_in(func.low, func.high);
+        for (auto entry = lines.first; entry != lines.second; ++entry) {
+            if (entry->line != line && _breakpoints.count(entry->low) == 0) {
+                tmp_bps.push_back(entry->low);
+            }
+        }
+        local_line = is_local_line(func, lines, line);
+        Unwinder::Frame frames[2];
+        if (unwind(*_thread, frames, 2, STACK_SNAPSHOT_SIZE) == 2) {
+            ret_addr = frames[1].pc - _abs_load_addr;
+            cfa = frames[0].cfa;
+            if (_breakpoints.count(ret_addr) == 0 && std::find(tmp_bps.begin(), tmp_bps.end(), ret_addr) == tmp_bps.end()) {
+                tmp_bps.push_back(ret_addr);
+            }
+        }
+    } catch (const std::out_of_range& oor) {
+        known_function = false;
+    }
+
+    std::unique_ptr<InstructionCounter> counter;
+    if (count_instructions) {
+        counter = std::make_unique<InstructionCounter>(_thread->tid);
+    }
+    auto calls = Stats::total_calls();
+    uint64_t stops = 0;
+    bool ran_loop = false;
+    std::vector<std::uintptr_t> blocks {start_pc};  // Where each stop in the line so far left off
+
+    _stepping = true;
+    set_breakpoints(tmp_bps);
+    while (true) {
+        step_block(known_function);
+        stops++;
+
+        try {
+            if (_dwarf_ctx.get_line_from_pc(get_offset_pc()).line != line) {
+                break;
+            }
+        } catch (const std::out_of_range& oor) {
+            // We just branched into code without line information; its return address is on top of the stack
+            run_to(_memory.read_word(_thread->regs.get(Reg::rsp)) - _abs_load_addr);
+            stops++;
+        }
+
+        auto pc = get_offset_pc();
+        if (local_line && std::find(blocks.begin(), blocks.end(), pc) != blocks.end()) {
+            // A loop within the line whose blocks have all been seen: run it at full speed to an exit
+            // A hit of the return address with a lower rsp comes from a deeper (recursive) call returning
+            auto tid = _thread->tid;
+            do {
+                continue_execution();
+                stops++;
+            } while (!_exited && _thread->tid == tid && get_offset_pc() == ret_addr && _thread->regs.get(Reg::rsp) < cfa);
+            ran_loop = true;
+            break;
+        }
+        blocks.push_back(pc);
+    }
+    remove_breakpoints(tmp_bps);
+    _stepping = false;
+
+    std::cout << "Range step: " << std::dec << stops << " stops";
+    auto syscalls = Stats::total_calls() - calls;
+    if (Stats::enabled()) {
+        std::cout << ", " << syscalls << " system calls";
+    }
+    if (ran_loop) {
+        std::cout << ", loop run at full speed";
+    }
+    if (counter != nullptr && counter->is_available()) {
+        auto instructions = counter->read_count();
+        auto saved = instructions > stops ? instructions - stops : 0;
+        std::cout << " for " << instructions << " instructions (" << saved << " stops saved";
+        if (Stats::enabled()) {
+            // Single stepping would have paid for each of those stops what the stops of this step cost
+            std::cout << ", about " << saved * syscalls / stops << " system calls";
+        }
+        std::cout << ')';
+    }
+    std::cout << '\n';
+    if (_exited) {
+        return;
     }
 
     // Print the next line
-    auto line_entry = _dwarf_ctx.get_line_from_pc(get_offset_pc());
-    _dwarf_ctx.print_source(line_entry->file->path, line_entry->line);
+    auto& line_entry = _dwarf_ctx.get_line_from_pc(get_offset_pc());
+    _dwarf_ctx.print_source(_dwarf_ctx.get_file_name(line_entry), line_entry.line);
 }
 
 
-void Debugger::step_over() {
-    auto func = _dwarf_ctx.get_function_from_pc(get_offset_pc());
-    auto func_entry = _dwarf_ctx.get_func_entry(func);
-    auto func_end = _dwarf_ctx.get_func_end(func);
+// Whether the code of a line within a function makes no call and no jump out of it, so that running the line at
+// full speed cannot miss a function the step should stop in (the original bytes are read under breakpoints)
+bool Debugger::is_local_line(const DwarfContext::FunctionEntry& func,
+                             std::pair<const DwarfContext::LineEntry*, const DwarfContext::LineEntry*> lines,
+                             uint32_t line) {
+    std::vector<uint8_t> code;
+    for (auto entry = lines.first; entry != lines.second; ++entry) {
+        if (entry->line != line || entry->low >= entry->high) {
+            continue;
+        }
+        auto low = entry->low + _abs_load_addr;
+        auto high = entry->high + _abs_load_addr;
+        code.resize(high - low);
+        if (_memory.read(low, code.data(), code.size()) != code.size()) {
+            return false;
+        }
+        for (auto& [addr, bp] : _breakpoints) {
+            if (bp.is_enabled() && bp.get_address() >= low && bp.get_address() < high) {
+                code[bp.get_address() - low] = bp.get_saved_byte();
+            }
+        }
+        if (!is_local_code(code.data(), code.size(), low, func.low + _abs_load_addr, func.high + _abs_load_addr)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    auto line = _dwarf_ctx.get_line_from_pc(func_entry);    // addr of func entry line
-    auto curr_line = _dwarf_ctx.get_line_from_pc(get_offset_pc());  // addr of current line
+void Debugger::step_over() {
+    auto& func = _dwarf_ctx.get_function_range_from_pc(get_offset_pc());
+    auto& curr_line = _dwarf_ctx.get_line_from_pc(get_offset_pc());  // addr of current line
 
     std::vector<std::uintptr_t> tmp_bps{};  // temporary list of breakpoints to be removed later
 
-    // Loop through line table entries, checking that it's not the current line
-    while (line->address < func_end) {
-        auto abs_addr = line->address + _abs_load_addr;
-        if (line->address != curr_line->address && _breakpoints.count(abs_addr) == 0) {
-            set_breakpoint(abs_addr, false);
-            tmp_bps.push_back(abs_addr);
+    // Loop through line table entries of the function, checking that it's not the current line
+    auto lines = _dwarf_ctx.get_lines_in(func.low, func.high);
+    for (auto line = lines.first; line != lines.second; ++line) {
+        if (line->low != curr_line.low && _breakpoints.count(line->low) == 0) {
+            tmp_bps.push_back(line->low);
         }
-        ++line;
     }
 
     // Set breakpoint at the return address, similar to the step_out() method
-    auto fp = get_reg_value(_pid, Reg::rbp);
-    auto ret_addr = read_memory(fp + RET_ADDR_FRAME_OFFSET);
-    if (_breakpoints.count(ret_addr) == 0) {
-        set_breakpoint(ret_addr);
-        tmp_bps.push_back(ret_addr);
+    Unwinder::Frame frames[2];
+    if (unwind(*_thread, frames, 2, STACK_SNAPSHOT_SIZE) == 2) {
+        auto ret_addr = frames[1].pc - _abs_load_addr;
+        if (_breakpoints.count(ret_addr) == 0) {
+            tmp_bps.push_back(ret_addr);
+        }
     }
 
+    // Plant (and later lift) all temporary breakpoints together, so the cost is per page rather than per line
+    set_breakpoints(tmp_bps);
     continue_execution();
-    for (auto& addr : tmp_bps) {
-        remove_breakpoint(addr, false);
-    }
+    remove_breakpoints(tmp_bps);
 }
 
-// Get the absolute load address of the child process from /proc/<pid>/maps
+// Get the absolute load address of the program from /proc/<pid>/maps: the start of its mapping at file offset 0.
+// The executable is not necessarily the first mapping (e.g. when attaching to a process that was not launched by us)
 uintptr_t Debugger::read_abs_load_addr(pid_t pid) {
-    std::string path = "/proc/" + std::to_string(pid) + "/maps";
-
-    std::ifstream ifs {path};
-    std::string addr_str;
-    std::getline(ifs, addr_str, '-');   // Read first address in file (number before the first dash)
-
-    std::stringstream ss;
-    uintptr_t addr;
-    ss << std::hex << addr_str;
-    ss >> addr;
+    auto exe = read_exe_path(pid);
+    auto maps = Utils::read_maps(pid);
+    for (auto& map : maps) {
+        if (map.path == exe && map.offset == 0) {
+            return map.start;
+        }
+    }
+    return maps.empty() ? 0 : maps.front().start;
+}
 
-    return addr;
+// Get the path of the executable of a process
+std::string Debugger::read_exe_path(pid_t pid) {
+    char buf[PATH_MAX];
+    auto path = "/proc/" + std::to_string(pid) + "/exe";
+    auto len = readlink(path.c_str(), buf, sizeof(buf) - 1);
+    if (len == -1) {
+        return path;
+    }
+    return std::string(buf, len);
 }
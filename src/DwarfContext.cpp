@@ -2,7 +2,7 @@
 // Created by alexcons on 25/05/2021.
 //
 #include "DwarfContext.h"
-#include <fstream>
+#include <cstring>
 #include <iostream>
 #include "Utils.h"
 
@@ -10,18 +10,16 @@
 // Gets the DIE of the enclosing function from the current PC
 // TODO extension: member functions and inlining (tut5)
 dwarf::die DwarfContext::get_function_from_pc(uint64_t pc) const {
-    for (auto& cu : _dwarf.compilation_units()) {
-        if (die_pc_range(cu.root()).contains(pc)) {
-            for (const auto& die : cu.root()) {
-                if (die.tag == dwarf::DW_TAG::subprogram) {
-                    if (die_pc_range(die).contains(pc)) {
-                        return die;
-                    }
-                }
-            }
-        }
+    return _addr_index.function_die(get_function_range_from_pc(pc));
+}
+
+// Gets the address range of the enclosing function from the current PC
+const DwarfContext::FunctionEntry& DwarfContext::get_function_range_from_pc(uint64_t pc) const {
+    auto entry = _addr_index.find_function(pc);
+    if (entry == nullptr) {
+        throw std::out_of_range{"Cannot find enclosing function"};
     }
-    throw std::out_of_range{"Cannot find enclosing function"};
+    return *entry;
 }
 
 // Get function entry address
@@ -35,110 +33,265 @@ uint64_t DwarfContext::get_func_end(const dwarf::die& d) {
 }
 
 // Get function from its name
- uint64_t DwarfContext::get_function_by_name(const std::string& name) const {
-    for (const auto& cu : _dwarf.compilation_units()) {
-        for (const auto& die : cu.root()) {
-            if (die.has(dwarf::DW_AT::name) && dwarf::at_name(die) == name) {
-                auto entry = get_line_from_pc(dwarf::at_low_pc(die));
-                ++entry;    // skip prologue instructions (setting up call stack)
-                return entry->address;
-            }
-        }
+uint64_t DwarfContext::get_function_by_name(const std::string& name) const {
+    uint64_t addr;
+    if (!_addr_index.find_function_by_name(name, addr)) {
+        throw std::out_of_range{"Cannot find function " + name};
     }
+    auto entry = _addr_index.find_line(addr);
+    if (entry == nullptr) {
+        return addr;
+    }
+    auto next = _addr_index.next_line(entry);  // skip prologue instructions (setting up call stack)
+    return next != nullptr ? next->low : entry->low;
 }
 
 
 // Gets the line corresponding to the current PC (which is a relative address)
-dwarf::line_table::iterator DwarfContext::get_line_from_pc(uint64_t pc) const {
-    for (auto& cu : _dwarf.compilation_units()) {
-        if (die_pc_range(cu.root()).contains(pc)) {
-            auto& line_table = cu.get_line_table();
-            auto iter = line_table.find_address(pc);
-
-            if (iter == line_table.end()) {
-                throw std::out_of_range{"Cannot find line entry"};
-            }
-            return iter;
-        }
+const DwarfContext::LineEntry& DwarfContext::get_line_from_pc(uint64_t pc) const {
+    auto entry = _addr_index.find_line(pc);
+    if (entry == nullptr) {
+        throw std::out_of_range{"Cannot find line entry"};
     }
-    throw std::out_of_range{"Cannot find line entry"};
+    return *entry;
+}
+
+// Gets the line entries that start within [low, high) in address order
+std::pair<const DwarfContext::LineEntry*, const DwarfContext::LineEntry*>
+DwarfContext::get_lines_in(uint64_t low, uint64_t high) const {
+    return _addr_index.lines_in(low, high);
 }
 
 // Gets address for a particular line of a source file
 uint64_t DwarfContext::get_source_line(const std::string& filename, uint line) {
-    for (const auto& cu : _dwarf.compilation_units()) {
-        if (Utils::is_suffixed_by(filename, dwarf::at_name(cu.root()))) {
-            for (const auto& entry : cu.get_line_table()) {
-                // Check that entry is the start of a statement
-                if (entry.is_stmt && entry.line == line) {
-                    return entry.address;
-                }
-            }
-        }
+    uint64_t addr;
+    if (!_addr_index.find_source_line(filename, line, addr)) {
+        throw std::invalid_argument{"Cannot find line in source file"};
     }
-    throw std::invalid_argument{"Cannot find line in source file"};
+    return addr;
 }
 
-// Prints the source lines
-// TODO: move file ifstream init to constructor?
+// Prints the source lines around a line (the file is mapped and indexed once, on first use)
 void DwarfContext::print_source(const std::string &file_name, uint line, uint num_lines) const {
-    std::ifstream file {file_name};
+    auto file = _source_cache.get(file_name);
+    if (file == nullptr) {
+        return;
+    }
 
     auto start_line = line <= num_lines ? 1 : line - num_lines;
     auto end_line = line + num_lines + (line < num_lines ? num_lines - line : 0) + 1;
+    end_line = std::min<std::size_t>(end_line, file->num_lines());
 
-    char c;
-    uint curr_line = 1;
-    while (curr_line != start_line && file.get(c)) {
-        if (c == '\n') {
-            curr_line++;
-        }
-    }
-
-    // Display the cursor if we're at the line
-    std::cout << (curr_line == line ? "> " : " ");
-
-    // Write lines from start to end
-    while (curr_line <= end_line && file.get(c)) {
-        std::cout << c;
-        if (c == '\n') {
-            curr_line++;
-            std::cout << (curr_line == line ? "> " : " ");
-        }
+    // Write lines from start to end, displaying the cursor at the line
+    for (auto curr_line = start_line; curr_line <= end_line; curr_line++) {
+        std::cout << (curr_line == line ? "> " : " ") << file->get_line(curr_line) << '\n';
     }
     std::cout << std::endl; // Flush the stream
 }
 
 // Map ELF enum types to our enum (to avoid dependency issues)
 DwarfContext::SymbolType DwarfContext::get_symbol_type(elf::stt symbol) {
-    switch (symbol) {
-        case elf::stt::notype: return SymbolType::NoType;
-        case elf::stt::object: return SymbolType::Object;
-        case elf::stt::func: return SymbolType::Function;
-        case elf::stt::section: return SymbolType::Section;
-        case elf::stt::file: return SymbolType::File;
-        default: throw std::invalid_argument{"Not supported"};
+    return SymbolIndex::get_symbol_type(symbol);
+}
+
+// Get the symbol index, building it on first use
+const SymbolIndex& DwarfContext::symbols() {
+    if (!_symbol_index.is_built()) {
+        _symbol_index.build(_elf);
     }
+    return _symbol_index;
+}
+
+const Unwinder& DwarfContext::get_unwinder() {
+    if (!_unwinder_built) {
+        _unwinder.build(_elf);
+        _unwinder_built = true;
+    }
+    return _unwinder;
 }
 
 // Lookup a symbol in the ELF information
-// TODO build up map of name -> symbol to avoid repeated lookups
-std::vector<DwarfContext::Symbol> DwarfContext::lookup_symbol(const std::string &name) {
-    std::vector<Symbol> symbols{};
+DwarfContext::SymbolRange DwarfContext::lookup_symbol(std::string_view name) {
+    return symbols().find(name);
+}
 
-    for (const auto& section : _elf.sections()) {
-        if (section.get_hdr().type != elf::sht::symtab && section.get_hdr().type != elf::sht::dynsym) {
-            continue;
-        }
+// Lookup all symbols matching a glob pattern
+void DwarfContext::lookup_symbol_glob(const std::string& pattern, std::vector<const Symbol*>& out) {
+    symbols().find_glob(pattern, out);
+}
+
+// Lookup the symbol containing an address
+const DwarfContext::Symbol* DwarfContext::lookup_symbol_by_address(uint64_t addr) {
+    return symbols().find_by_address(addr);
+}
+
+static uint64_t read_uleb(const uint8_t *&p) {
+    uint64_t result = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = *p++;
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return result;
+}
+
+// Name of a variable DIE, which the definition of a declared variable only has through DW_AT_specification
+static std::string variable_name(const dwarf::die& d) {
+    if (d.has(dwarf::DW_AT::name)) {
+        return dwarf::at_name(d);
+    }
+    if (d.has(dwarf::DW_AT::specification)) {
+        return variable_name(d[dwarf::DW_AT::specification].as_reference());
+    }
+    return {};
+}
 
-        for (auto sym : section.as_symtab()) {
-            if (sym.get_name() == name) {
-                auto& data = sym.get_data();
-                symbols.push_back(Symbol{get_symbol_type(data.type()), sym.get_name(), data.value});
+static bool is_variable(const dwarf::die& d, const std::string& name) {
+    return (d.tag == dwarf::DW_TAG::variable || d.tag == dwarf::DW_TAG::formal_parameter) &&
+           (d.has(dwarf::DW_AT::location) || d.has(dwarf::DW_AT::const_value)) && variable_name(d) == name;
+}
+
+// Search a function or block for a variable, looking in the innermost block around the PC first (it shadows the rest)
+static bool find_in_scope(const dwarf::die& scope, uint64_t pc, const std::string& name, dwarf::die& out) {
+    dwarf::die found;
+    for (auto& child : scope) {
+        if (child.tag == dwarf::DW_TAG::lexical_block && dwarf::die_pc_range(child).contains(pc)) {
+            if (find_in_scope(child, pc, name, out)) {
+                return true;
             }
+        } else if (!found.valid() && is_variable(child, name)) {
+            found = child;
+        }
+    }
+    if (found.valid()) {
+        out = found;
+    }
+    return found.valid();
+}
+
+static bool find_global(const dwarf::die& root, const std::string& name, dwarf::die& out) {
+    for (auto& child : root) {
+        if (child.tag == dwarf::DW_TAG::variable && is_variable(child, name)) {
+            out = child;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Find a variable visible at a PC: a local or parameter of the enclosing function, else a global
+// (of the same compilation unit first, as a static one there hides those of other units)
+dwarf::die DwarfContext::find_variable(uint64_t pc, const std::string& name) const {
+    if (!has_dwarf()) {
+        throw std::out_of_range{"No debugging information"};
+    }
+    dwarf::die found;
+    const dwarf::unit *unit = nullptr;
+    try {
+        auto function = get_function_from_pc(pc);
+        if (find_in_scope(function, pc, name, found)) {
+            return found;
+        }
+        unit = &function.get_unit();
+        if (find_global(unit->root(), name, found)) {
+            return found;
+        }
+    } catch (const std::out_of_range&) {}
+    // The indexing threads may be reading the other units, and libelfin loads a unit's DIEs without a lock
+    _addr_index.wait();
+    for (auto& cu : _dwarf.compilation_units()) {
+        if (static_cast<const dwarf::unit*>(&cu) != unit && find_global(cu.root(), name, found)) {
+            return found;
         }
     }
+    throw std::out_of_range{"No symbol \"" + name + "\" in current context"};
+}
 
-    return symbols;
+// Get the location expression in an attribute of a DIE (e.g. DW_AT_location or DW_AT_frame_base) that applies at a PC.
+// The expression is left in .debug_info or .debug_loc; false if the DIE has none at this PC (e.g. optimised out)
+bool DwarfContext::get_location(const dwarf::die& d, dwarf::DW_AT attr, uint64_t pc,
+                                const uint8_t *&expr, std::size_t& len) const {
+    if (!d.has(attr)) {
+        return false;
+    }
+    // libelfin evaluates expressions itself but does not expose their bytes, so they are read from the section
+    auto val = d[attr];
+    auto p = static_cast<const uint8_t *>(_elf.get_section(".debug_info").data()) + val.get_section_offset();
+    switch (val.get_form()) {
+        case dwarf::DW_FORM::exprloc:
+        case dwarf::DW_FORM::block:
+            len = read_uleb(p);
+            break;
+        case dwarf::DW_FORM::block1:
+            len = *p++;
+            break;
+        case dwarf::DW_FORM::block2:
+        {
+            uint16_t n;
+            std::memcpy(&n, p, sizeof(n));
+            p += sizeof(n);
+            len = n;
+            break;
+        }
+        case dwarf::DW_FORM::block4:
+        {
+            uint32_t n;
+            std::memcpy(&n, p, sizeof(n));
+            p += sizeof(n);
+            len = n;
+            break;
+        }
+        case dwarf::DW_FORM::sec_offset:
+        case dwarf::DW_FORM::data4:
+        case dwarf::DW_FORM::data8:
+            return find_in_location_list(d, val.as_sec_offset(), pc, expr, len);
+        default:
+            return false;
+    }
+    expr = p;
+    return true;
 }
 
+// Find the entry of a location list (in .debug_loc) covering a PC
+bool DwarfContext::find_in_location_list(const dwarf::die& d, uint64_t offset, uint64_t pc,
+                                         const uint8_t *&expr, std::size_t& len) const {
+    auto& loc = _elf.get_section(".debug_loc");
+    if (!loc.valid() || offset >= loc.size()) {
+        return false;
+    }
+    // Entries are relative to the base address of the unit, unless a base address selection entry changes it
+    auto& root = d.get_unit().root();
+    uint64_t base = root.has(dwarf::DW_AT::low_pc) ? dwarf::at_low_pc(root) : 0;
+    auto p = static_cast<const uint8_t *>(loc.data()) + offset;
+    auto end = static_cast<const uint8_t *>(loc.data()) + loc.size();
+    while (p + 2 * sizeof(uint64_t) <= end) {
+        uint64_t begin, finish;
+        std::memcpy(&begin, p, sizeof(begin));
+        std::memcpy(&finish, p + sizeof(begin), sizeof(finish));
+        p += 2 * sizeof(uint64_t);
+        if (begin == 0 && finish == 0) {
+            break;
+        }
+        if (begin == UINT64_MAX) {
+            base = finish;
+            continue;
+        }
+        uint16_t n;
+        std::memcpy(&n, p, sizeof(n));
+        p += sizeof(n);
+        if (pc >= base + begin && pc < base + finish) {
+            expr = p;
+            len = n;
+            return true;
+        }
+        p += n;
+    }
+    return false;
+}
+
+// Layout of the type of a variable, decoded on first use
+const TypeLayout& DwarfContext::get_type_layout(const dwarf::die& variable) const {
+    return variable.has(dwarf::DW_AT::type) ? _types.get(dwarf::at_type(variable)) : _types.get_void();
+}
@@ -0,0 +1,787 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ptrace.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/user.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+#include "GdbServer.h"
+#include "Stats.h"
+
+// Largest packet we accept, advertised in qSupported. Memory replies take two bytes per byte read at most
+constexpr std::size_t PACKET_SIZE = 0x20000;
+
+// A register as the client sees it, and where it lives in user_regs_struct or user_fpregs_struct
+struct RegisterInfo {
+    const char *name;
+    uint16_t bits;
+    const char *type;
+    bool fp;            // In user_fpregs_struct (otherwise user_regs_struct)
+    uint16_t offset;    // Byte offset in the struct
+    uint16_t size;      // Bytes in the struct (zero extended or truncated to bits / 8 on the wire)
+    Reg reg;            // For user_regs_struct registers
+};
+
+// GDB's amd64 numbering: general purpose, x87 and SSE registers, then orig_rax for syscall restarts
+static const std::vector<RegisterInfo> registers = [] {
+    std::vector<RegisterInfo> regs;
+    auto gp = [&](const char *name, uint16_t bits, const char *type, Reg r) {
+        regs.push_back(RegisterInfo{name, bits, type, false,
+                                    static_cast<uint16_t>(reg_indices[static_cast<std::size_t>(r)] * 8), 8, r});
+    };
+    auto fp = [&](const char *name, uint16_t bits, const char *type, std::size_t offset, uint16_t size) {
+        regs.push_back(RegisterInfo{name, bits, type, true, static_cast<uint16_t>(offset), size, Reg::rax});
+    };
+
+    const std::pair<const char *, Reg> gp64[] = {
+        {"rax", Reg::rax}, {"rbx", Reg::rbx}, {"rcx", Reg::rcx}, {"rdx", Reg::rdx}, {"rsi", Reg::rsi},
+        {"rdi", Reg::rdi}, {"rbp", Reg::rbp}, {"rsp", Reg::rsp}, {"r8", Reg::r8}, {"r9", Reg::r9},
+        {"r10", Reg::r10}, {"r11", Reg::r11}, {"r12", Reg::r12}, {"r13", Reg::r13}, {"r14", Reg::r14},
+        {"r15", Reg::r15},
+    };
+    for (auto& [name, r] : gp64) {
+        gp(name, 64, r == Reg::rbp || r == Reg::rsp ? "data_ptr" : "int64", r);
+    }
+    gp("rip", 64, "code_ptr", Reg::rip);
+    gp("eflags", 32, "int32", Reg::rflags);
+    const std::pair<const char *, Reg> segments[] = {
+        {"cs", Reg::cs}, {"ss", Reg::ss}, {"ds", Reg::ds}, {"es", Reg::es}, {"fs", Reg::fs}, {"gs", Reg::gs},
+    };
+    for (auto& [name, r] : segments) {
+        gp(name, 32, "int32", r);
+    }
+
+    static const char *st_names[] = {"st0", "st1", "st2", "st3", "st4", "st5", "st6", "st7"};
+    for (std::size_t i = 0; i < 8; i++) {
+        fp(st_names[i], 80, "i387_ext", offsetof(user_fpregs_struct, st_space) + i * 16, 10);
+    }
+    fp("fctrl", 32, "int", offsetof(user_fpregs_struct, cwd), 2);
+    fp("fstat", 32, "int", offsetof(user_fpregs_struct, swd), 2);
+    fp("ftag", 32, "int", offsetof(user_fpregs_struct, ftw), 2);
+    fp("fiseg", 32, "int", offsetof(user_fpregs_struct, rip) + 4, 4);
+    fp("fioff", 32, "int", offsetof(user_fpregs_struct, rip), 4);
+    fp("foseg", 32, "int", offsetof(user_fpregs_struct, rdp) + 4, 4);
+    fp("fooff", 32, "int", offsetof(user_fpregs_struct, rdp), 4);
+    fp("fop", 32, "int", offsetof(user_fpregs_struct, fop), 2);
+
+    static const char *xmm_names[] = {"xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+                                      "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15"};
+    for (std::size_t i = 0; i < 16; i++) {
+        fp(xmm_names[i], 128, "uint128", offsetof(user_fpregs_struct, xmm_space) + i * 16, 16);
+    }
+    fp("mxcsr", 32, "int", offsetof(user_fpregs_struct, mxcsr), 4);
+    gp("orig_rax", 64, "int", Reg::orig_rax);
+    return regs;
+}();
+
+constexpr std::size_t FIRST_SSE_REG = 40;
+constexpr std::size_t ORIG_RAX_REG = 57;
+
+static const std::string& target_xml() {
+    static const std::string xml = [] {
+        std::ostringstream ss;
+        ss << "<?xml version=\"1.0\"?><!DOCTYPE target SYSTEM \"gdb-target.dtd\"><target version=\"1.0\">"
+           << "<architecture>i386:x86-64</architecture><osabi>GNU/Linux</osabi>";
+        for (std::size_t i = 0; i < registers.size(); i++) {
+            if (i == 0) ss << "<feature name=\"org.gnu.gdb.i386.core\">";
+            if (i == FIRST_SSE_REG) ss << "</feature><feature name=\"org.gnu.gdb.i386.sse\">";
+            if (i == ORIG_RAX_REG) ss << "</feature><feature name=\"org.gnu.gdb.i386.linux\">";
+            ss << "<reg name=\"" << registers[i].name << "\" bitsize=\"" << registers[i].bits << "\" type=\""
+               << registers[i].type << "\" regnum=\"" << i << "\"/>";
+        }
+        ss << "</feature></target>";
+        return ss.str();
+    }();
+    return xml;
+}
+
+static const char HEX[] = "0123456789abcdef";
+
+static void append_hex(std::string& out, const void *data, std::size_t len) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (std::size_t i = 0; i < len; i++) {
+        out += HEX[bytes[i] >> 4];
+        out += HEX[bytes[i] & 0xf];
+    }
+}
+
+static std::string to_hex(uint64_t value) {
+    std::ostringstream ss;
+    ss << std::hex << value;
+    return ss.str();
+}
+
+static bool decode_hex(const std::string& hex, std::string& out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    out.clear();
+    for (std::size_t i = 0; i < hex.size(); i += 2) {
+        auto hi = std::strchr(HEX, std::tolower(hex[i]));
+        auto lo = std::strchr(HEX, std::tolower(hex[i + 1]));
+        if (hi == nullptr || lo == nullptr || *hi == '\0' || *lo == '\0') {
+            return false;
+        }
+        out += static_cast<char>((hi - HEX) << 4 | (lo - HEX));
+    }
+    return true;
+}
+
+// Escape binary data for a reply ('#', '$', '}' and '*' become '}' followed by the byte xor 0x20)
+static std::string escape_binary(const char *data, std::size_t len) {
+    std::string out;
+    out.reserve(len);
+    for (std::size_t i = 0; i < len; i++) {
+        auto c = data[i];
+        if (c == '#' || c == '$' || c == '}' || c == '*') {
+            out += '}';
+            c ^= 0x20;
+        }
+        out += c;
+    }
+    return out;
+}
+
+// Parse "addr,len" (hex) at the start of a packet body
+static bool parse_addr_len(const std::string& body, uint64_t& addr, std::size_t& len) {
+    char *end;
+    addr = std::strtoull(body.c_str(), &end, 16);
+    if (*end != ',') {
+        return false;
+    }
+    len = std::strtoull(end + 1, &end, 16);
+    return true;
+}
+
+GdbServer::~GdbServer() {
+    for (auto fd : {_fd, _listen_fd, _signal_fd}) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+    if (!_unix_path.empty()) {
+        unlink(_unix_path.c_str());
+    }
+}
+
+// Listen on a TCP port on localhost if the address is a number, or on a unix socket at that path otherwise
+void GdbServer::listen_on(const std::string& address) {
+    bool tcp = !address.empty() && std::all_of(address.begin(), address.end(), ::isdigit);
+    _listen_fd = socket(tcp ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    int res;
+    if (tcp) {
+        int one = 1;
+        setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(std::stoi(address));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        res = bind(_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    } else {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(address.c_str());
+        res = bind(_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        _unix_path = address;
+    }
+    if (res == -1 || listen(_listen_fd, 1) == -1) {
+        std::cerr << "Could not listen on " << address << ": " << std::strerror(errno) << '\n';
+        exit(EXIT_FAILURE);
+    }
+}
+
+void GdbServer::serve(const std::string& address) {
+    _debugger.start();
+    _debugger._exit_on_finish = false;
+
+    // Stops are noticed through a signalfd for SIGCHLD, so waiting can poll the client for interrupts too
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    _signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    listen_on(address);
+    std::cout << "Listening on " << address << '\n';
+    _fd = accept4(_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (_fd == -1) {
+        std::cerr << "Could not accept a connection: " << std::strerror(errno) << '\n';
+        return;
+    }
+    int one = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // Fails harmlessly on unix sockets
+    std::cout << "Client connected\n";
+
+    // Answer every complete packet that came in together, then send all the replies at once
+    std::string packet;
+    while (!_done && receive()) {
+        while (!_done && next_packet(packet)) {
+            // A malformed packet (e.g. a number that does not parse) gets an error reply, not the end of the session
+            try {
+                handle_packet(packet);
+            } catch (const std::exception&) {
+                send_packet("E01");
+            }
+        }
+        flush();
+    }
+
+    // A client that goes away leaves an attached process running, and a launched one is killed when we exit
+    if (!_done && _debugger._seized) {
+        _debugger.detach();
+    }
+}
+
+// Read whatever the client sent, returning false once it disconnected
+bool GdbServer::receive() {
+    char buf[65536];
+    while (true) {
+        auto n = recv(_fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            _in.append(buf, n);
+            return true;
+        }
+        if (n == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+// Take the next complete packet out of the input, acking it unless in no-ack mode
+bool GdbServer::next_packet(std::string& packet) {
+    while (!_in.empty()) {
+        if (_in[0] != '$') {
+            _in.erase(0, 1);    // Acks, and interrupts while the process is stopped anyway
+            continue;
+        }
+        auto hash = _in.find('#');
+        if (hash == std::string::npos || hash + 2 >= _in.size()) {
+            return false;       // Incomplete
+        }
+
+        uint8_t sum = 0;
+        for (std::size_t i = 1; i < hash; i++) {
+            sum += static_cast<uint8_t>(_in[i]);
+        }
+        auto checksum = std::strtoul(_in.substr(hash + 1, 2).c_str(), nullptr, 16);
+        if (_ack) {
+            _out += sum == checksum ? '+' : '-';
+        }
+        if (sum != checksum) {
+            _in.erase(0, hash + 3);
+            continue;
+        }
+
+        packet.clear();
+        for (std::size_t i = 1; i < hash; i++) {
+            if (_in[i] == '}' && i + 1 < hash) {
+                packet += static_cast<char>(_in[++i] ^ 0x20);
+            } else {
+                packet += _in[i];
+            }
+        }
+        _in.erase(0, hash + 3);
+        return true;
+    }
+    return false;
+}
+
+void GdbServer::send_packet(const std::string& payload) {
+    uint8_t sum = 0;
+    for (auto c : payload) {
+        sum += static_cast<uint8_t>(c);
+    }
+    _out += '$';
+    _out += payload;
+    _out += '#';
+    append_hex(_out, &sum, 1);
+}
+
+void GdbServer::flush() {
+    std::size_t sent = 0;
+    while (sent < _out.size()) {
+        auto n = send(_fd, _out.data() + sent, _out.size() - sent, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        sent += n;
+    }
+    _out.clear();
+}
+
+void GdbServer::handle_packet(const std::string& packet) {
+    auto& d = _debugger;
+    uint64_t addr;
+    std::size_t len;
+    std::string data;
+
+    // Packets are counted by their name: the first letter, or the word of a query or 'v' packet. Views, so that
+    // nothing is built when stats are compiled out
+    auto is_named = packet[0] == 'q' || packet[0] == 'Q' || packet[0] == 'v';
+    auto name = std::string_view{packet}.substr(0, is_named ? packet.find_first_of(":;,?") : 1);
+    Stats::CommandScope stats_scope {"gdb ", name};
+
+    switch (packet[0]) {
+        case '?':
+            send_packet(stop_reply());
+            break;
+        case 'q':
+        case 'Q':
+            handle_query(packet);
+            break;
+        case 'H':
+        {
+            // Hg selects the thread for register and memory access; Hc is superseded by vCont
+            auto tid = std::strtol(packet.c_str() + 2, nullptr, 16);
+            if (packet[1] == 'g' && tid > 0) {
+                auto iter = d._threads.find(tid);
+                if (iter == d._threads.end()) {
+                    send_packet("E01");
+                    break;
+                }
+                d._thread = &iter->second;
+            }
+            send_packet("OK");
+            break;
+        }
+        case 'T':
+            send_packet(d._threads.count(std::strtol(packet.c_str() + 1, nullptr, 16)) != 0 ? "OK" : "E01");
+            break;
+        case 'g':
+            send_packet(read_registers());
+            break;
+        case 'G':
+            write_registers(packet.substr(1));
+            send_packet("OK");
+            break;
+        case 'p':
+        {
+            std::string out;
+            send_packet(read_register(std::strtoul(packet.c_str() + 1, nullptr, 16), out) ? out : "E01");
+            break;
+        }
+        case 'P':
+        {
+            auto eq = packet.find('=');
+            bool ok = eq != std::string::npos &&
+                      write_register(std::strtoul(packet.c_str() + 1, nullptr, 16), packet.substr(eq + 1));
+            send_packet(ok ? "OK" : "E01");
+            break;
+        }
+        case 'm':
+        case 'x':
+            if (!parse_addr_len(packet.substr(1), addr, len)) {
+                send_packet("E01");
+                break;
+            }
+            data = read_memory(addr, len, packet[0] == 'x');
+            send_packet(data.empty() && len != 0 ? "E01" : data);
+            break;
+        case 'M':
+        case 'X':
+        {
+            auto colon = packet.find(':');
+            if (!parse_addr_len(packet.substr(1), addr, len) || colon == std::string::npos) {
+                send_packet("E01");
+                break;
+            }
+            if (packet[0] == 'X') {
+                data = packet.substr(colon + 1);
+            } else if (!decode_hex(packet.substr(colon + 1), data)) {
+                send_packet("E01");
+                break;
+            }
+            send_packet(data.size() == len && write_memory(addr, data) ? "OK" : "E01");
+            break;
+        }
+        case 'Z':
+        case 'z':
+            handle_breakpoint(packet);
+            break;
+        case 'v':
+            if (packet == "vCont?") {
+                send_packet("vCont;c;C;s;S");
+            } else if (packet.compare(0, 6, "vCont;") == 0) {
+                handle_vcont(packet);
+            } else {
+                send_packet("");
+            }
+            break;
+        case 'c':
+            resume(0);
+            break;
+        case 'C':
+            d._thread->pending_signal = std::stoi(packet.substr(1, 2), nullptr, 16);
+            resume(0);
+            break;
+        case 's':
+            resume(d._thread->tid);
+            break;
+        case 'S':
+            d._thread->pending_signal = std::stoi(packet.substr(1, 2), nullptr, 16);
+            resume(d._thread->tid);
+            break;
+        case 'D':
+            if (!d._syscalls.empty()) {
+                send_packet("E01");     // Refused by detach(): the filtered system calls would fail
+                break;
+            }
+            send_packet("OK");
+            flush();
+            d.detach();
+            break;
+        case 'k':
+            kill(d._pid, SIGKILL);
+            _done = true;
+            break;
+        default:
+            send_packet("");    // Not supported
+    }
+}
+
+void GdbServer::handle_query(const std::string& packet) {
+    auto& d = _debugger;
+    auto starts_with = [&](const char *prefix) { return packet.compare(0, std::strlen(prefix), prefix) == 0; };
+
+    if (starts_with("qSupported")) {
+        std::ostringstream features;
+        features << "PacketSize=" << std::hex << PACKET_SIZE << ";QStartNoAckMode+;qXfer:features:read+;"
+                 << "qXfer:auxv:read+;qXfer:exec-file:read+;swbreak+;hwbreak+;vContSupported+";
+        send_packet(features.str());
+    } else if (packet == "QStartNoAckMode") {
+        send_packet("OK");
+        _ack = false;
+    } else if (starts_with("qXfer:features:read:target.xml:")) {
+        xfer(target_xml(), packet.substr(std::strlen("qXfer:features:read:target.xml:")));
+    } else if (starts_with("qXfer:auxv:read::")) {
+        auto auxv = Stats::timed(Stats::Call::FileRead, [&] {
+            std::ifstream ifs{"/proc/" + std::to_string(d._pid) + "/auxv", std::ios::binary};
+            return std::string{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+        });
+        xfer(auxv, packet.substr(std::strlen("qXfer:auxv:read::")));
+    } else if (starts_with("qXfer:exec-file:read:")) {
+        auto colon = packet.find(':', std::strlen("qXfer:exec-file:read:"));
+        xfer(d._prog_name, colon == std::string::npos ? "" : packet.substr(colon + 1));
+    } else if (packet == "qC") {
+        send_packet("QC" + to_hex(d._thread->tid));
+    } else if (packet == "qfThreadInfo") {
+        std::string reply = "m";
+        for (auto& [tid, thread] : d._threads) {
+            if (thread.started) {
+                reply += to_hex(tid) + ',';
+            }
+        }
+        reply.pop_back();
+        send_packet(reply);
+    } else if (packet == "qsThreadInfo") {
+        send_packet("l");
+    } else if (packet == "qAttached") {
+        send_packet(d._seized ? "1" : "0");
+    } else if (starts_with("qSymbol")) {
+        send_packet("OK");
+    } else {
+        send_packet("");
+    }
+}
+
+// Reply with the part of an object given by "offset,length" ('l' marks the last part)
+void GdbServer::xfer(const std::string& data, const std::string& offset_length) {
+    uint64_t offset;
+    std::size_t len;
+    if (!parse_addr_len(offset_length, offset, len)) {
+        send_packet("E00");
+        return;
+    }
+    if (offset >= data.size()) {
+        send_packet("l");
+        return;
+    }
+    len = std::min(len, data.size() - offset);
+    send_packet((offset + len == data.size() ? "l" : "m") + escape_binary(data.data() + offset, len));
+}
+
+// vCont;action[:tid]...: continue all threads, or single step one while the others stay stopped
+void GdbServer::handle_vcont(const std::string& packet) {
+    auto& d = _debugger;
+    pid_t step_tid = 0;
+    std::size_t pos = 5;
+    while (pos < packet.size() && packet[pos] == ';') {
+        auto end = packet.find(';', pos + 1);
+        auto action = packet.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+        pos = end == std::string::npos ? packet.size() : end;
+
+        auto colon = action.find(':');
+        auto tid = colon == std::string::npos ? -1 : std::strtol(action.c_str() + colon + 1, nullptr, 16);
+        auto iter = d._threads.find(tid);
+        auto thread = iter != d._threads.end() ? &iter->second : (tid == -1 ? d._thread : nullptr);
+        if (thread == nullptr) {
+            continue;
+        }
+
+        auto kind = action[0];
+        if ((kind == 'C' || kind == 'S') && thread->pending_signal == 0) {
+            thread->pending_signal = std::stoi(action.substr(1, 2), nullptr, 16);
+        }
+        if ((kind == 's' || kind == 'S') && step_tid == 0) {
+            step_tid = thread->tid;
+        }
+    }
+    resume(step_tid);
+}
+
+// Continue all threads (step_tid 0) or single step one, then reply with the next stop
+void GdbServer::resume(pid_t step_tid) {
+    auto& d = _debugger;
+    flush();    // The ack must not wait for the process to stop
+    _interrupted = false;
+
+    if (step_tid != 0) {
+        auto iter = d._threads.find(step_tid);
+        if (iter == d._threads.end()) {
+            send_packet("E01");
+            return;
+        }
+        d._thread = &iter->second;
+        d.single_step_instruction();
+    } else {
+        d.resume_all();
+        wait_for_stop();
+    }
+    if (!_done) {
+        send_packet(stop_reply());
+    }
+}
+
+// Wait until a stop should be reported, or the client interrupts (a 0x03 byte) or goes away
+void GdbServer::wait_for_stop() {
+    auto& d = _debugger;
+    while (true) {
+        bool reported = false;
+        while (d.handle_next_event(false, reported) && !reported) {}
+        if (reported) {
+            d.stop_all_threads();
+            return;
+        }
+
+        pollfd fds[2] = {{_signal_fd, POLLIN, 0}, {_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1) {
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            signalfd_siginfo info;
+            while (read(_signal_fd, &info, sizeof(info)) > 0) {}
+        }
+        if (fds[1].revents & (POLLIN | POLLHUP)) {
+            if (!receive()) {
+                _done = true;
+                d.stop_all_threads();
+                return;
+            }
+            auto interrupt = _in.find('\x03');
+            if (interrupt != std::string::npos) {
+                _in.erase(interrupt, 1);
+                d.stop_all_threads();
+                _interrupted = true;
+                return;
+            }
+        }
+    }
+}
+
+// T packet for the current stop: signal, thread, why it stopped and the registers needed to show frame 0
+std::string GdbServer::stop_reply() {
+    auto& d = _debugger;
+    std::string reply;
+    if (d._exited) {
+        _done = true;
+        uint8_t code = WIFEXITED(d._exit_status) ? WEXITSTATUS(d._exit_status) : WTERMSIG(d._exit_status);
+        reply = WIFEXITED(d._exit_status) ? "W" : "X";
+        append_hex(reply, &code, 1);
+        return reply;
+    }
+
+    uint8_t sig = _interrupted ? SIGINT : d._stop_signal;
+    reply = "T";
+    append_hex(reply, &sig, 1);
+    reply += "thread:" + to_hex(d._thread->tid) + ';';
+    if (!_interrupted && sig == SIGTRAP) {
+        if (d._thread->at_breakpoint) {
+            reply += "swbreak:;";
+        } else if (d._stop_hw_slot != -1) {
+            auto& hw = d._hw_breakpoints.get_slot(d._stop_hw_slot);
+            switch (hw.type) {
+                case HardwareBreakpoints::Type::Execute: reply += "hwbreak:;"; break;
+                case HardwareBreakpoints::Type::Write: reply += "watch:" + to_hex(hw.addr) + ';'; break;
+                case HardwareBreakpoints::Type::ReadWrite: reply += "awatch:" + to_hex(hw.addr) + ';'; break;
+            }
+        }
+    }
+
+    // Expedite rbp, rsp and rip so the client needs no register round trip to show where we are
+    for (std::size_t regnum : {6, 7, 16}) {
+        uint8_t num = regnum;
+        append_hex(reply, &num, 1);
+        reply += ':';
+        read_register(regnum, reply);
+        reply += ';';
+    }
+    return reply;
+}
+
+// Append the value of a register, in target byte order, as hex
+bool GdbServer::read_register(std::size_t regnum, std::string& out) {
+    if (regnum >= registers.size()) {
+        return false;
+    }
+    auto& info = registers[regnum];
+    uint8_t value[16] = {};
+    if (info.fp) {
+        user_fpregs_struct fp{};
+        Stats::ptrace(PTRACE_GETFPREGS, _debugger._thread->tid, nullptr, &fp);
+        std::memcpy(value, reinterpret_cast<const uint8_t *>(&fp) + info.offset, info.size);
+    } else {
+        auto& regs = _debugger._thread->regs.get_all();
+        std::memcpy(value, reinterpret_cast<const uint8_t *>(&regs) + info.offset, info.size);
+    }
+    append_hex(out, value, info.bits / 8);
+    return true;
+}
+
+bool GdbServer::write_register(std::size_t regnum, const std::string& hex) {
+    std::string bytes;
+    if (regnum >= registers.size() || !decode_hex(hex, bytes) || bytes.size() != registers[regnum].bits / 8u) {
+        return false;
+    }
+    auto& info = registers[regnum];
+    auto tid = _debugger._thread->tid;
+    if (info.fp) {
+        user_fpregs_struct fp{};
+        Stats::ptrace(PTRACE_GETFPREGS, tid, nullptr, &fp);
+        std::memcpy(reinterpret_cast<uint8_t *>(&fp) + info.offset, bytes.data(), std::min<std::size_t>(info.size, bytes.size()));
+        return Stats::ptrace(PTRACE_SETFPREGS, tid, nullptr, &fp) != -1;
+    }
+    uint64_t value = 0;
+    std::memcpy(&value, bytes.data(), std::min(sizeof(value), bytes.size()));
+    _debugger._thread->regs.set(info.reg, value);   // Written back when the thread resumes
+    return true;
+}
+
+// All registers in one reply (the x87/SSE state is fetched once)
+std::string GdbServer::read_registers() {
+    user_fpregs_struct fp{};
+    Stats::ptrace(PTRACE_GETFPREGS, _debugger._thread->tid, nullptr, &fp);
+    auto& regs = _debugger._thread->regs.get_all();
+
+    std::string out;
+    for (auto& info : registers) {
+        uint8_t value[16] = {};
+        auto src = info.fp ? reinterpret_cast<const uint8_t *>(&fp) : reinterpret_cast<const uint8_t *>(&regs);
+        std::memcpy(value, src + info.offset, info.size);
+        append_hex(out, value, info.bits / 8);
+    }
+    return out;
+}
+
+void GdbServer::write_registers(const std::string& hex) {
+    std::size_t pos = 0;
+    for (std::size_t regnum = 0; regnum < registers.size(); regnum++) {
+        auto len = registers[regnum].bits / 4;
+        if (pos + len > hex.size()) {
+            break;
+        }
+        write_register(regnum, hex.substr(pos, len));
+        pos += len;
+    }
+}
+
+// Read memory in one transfer (at most what a reply can hold), showing the original bytes under our breakpoints
+std::string GdbServer::read_memory(uint64_t addr, std::size_t len, bool binary) {
+    len = std::min(len, PACKET_SIZE / 2);   // The client asks again for the rest of a short read
+    std::string buf(len, '\0');
+    len = _debugger._memory.read(addr, buf.data(), len);
+    buf.resize(len);
+    for (auto& [rel_addr, bp] : _debugger._breakpoints) {
+        auto bp_addr = bp.get_address();
+        if (bp.is_enabled() && bp_addr >= addr && bp_addr < addr + len) {
+            buf[bp_addr - addr] = static_cast<char>(bp.get_saved_byte());
+        }
+    }
+
+    if (binary) {
+        return len == 0 ? "" : "b" + escape_binary(buf.data(), len);
+    }
+    std::string out;
+    append_hex(out, buf.data(), len);
+    return out;
+}
+
+bool GdbServer::write_memory(uint64_t addr, const std::string& data) {
+    return data.empty() || _debugger._memory.write(addr, data.data(), data.size()) == data.size();
+}
+
+// Z/z type,addr,kind: 0 software breakpoint, 1 hardware breakpoint, 2 write and 4 access watchpoint
+void GdbServer::handle_breakpoint(const std::string& packet) {
+    auto& d = _debugger;
+    bool insert = packet[0] == 'Z';
+    uint64_t addr;
+    std::size_t kind;
+    if (packet.size() < 3 || !parse_addr_len(packet.substr(3), addr, kind)) {
+        send_packet("E01");
+        return;
+    }
+
+    if (packet[1] == '0') {
+        auto rel_addr = addr - d._abs_load_addr;
+        if (rel_addr == d._debug_state_bp) {
+            d._report_debug_state = insert;     // The client tracks shared libraries too; we keep our breakpoint
+            send_packet("OK");
+            return;
+        }
+        if (insert && d._breakpoints.count(rel_addr) == 0) {
+            d.set_breakpoint(rel_addr, false);
+        } else if (!insert) {
+            d.remove_breakpoint(rel_addr, false);
+        }
+        send_packet("OK");
+        return;
+    }
+
+    HardwareBreakpoints::Type type;
+    switch (packet[1]) {
+        case '1': type = HardwareBreakpoints::Type::Execute; break;
+        case '2': type = HardwareBreakpoints::Type::Write; break;
+        case '4': type = HardwareBreakpoints::Type::ReadWrite; break;
+        default:
+            send_packet("");    // x86 cannot trap on reads alone
+            return;
+    }
+    try {
+        if (insert) {
+            d._hw_breakpoints.set(addr, type, kind);
+        } else {
+            d._hw_breakpoints.remove(d._hw_breakpoints.find(addr, type));
+        }
+        send_packet("OK");
+    } catch (const std::exception&) {
+        send_packet("E01");
+    }
+}
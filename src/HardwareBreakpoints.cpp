@@ -0,0 +1,148 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include "HardwareBreakpoints.h"
+#include "Stats.h"
+
+constexpr int DR_STATUS = 6;
+constexpr int DR_CONTROL = 7;
+
+// Point the debug registers at another process (its registers start out clear)
+void HardwareBreakpoints::reset(pid_t pid) {
+    _tids = {pid};
+    _slots = {};
+}
+
+// Keep the slots but move them to another (stopped) process, e.g. a restarted checkpoint
+void HardwareBreakpoints::retarget(pid_t pid) {
+    _tids.clear();
+    add_thread(pid);
+}
+
+// Program the used slots into a new (stopped) thread
+void HardwareBreakpoints::add_thread(pid_t tid) {
+    _tids.push_back(tid);
+    try {
+        for (std::size_t i = 0; i < NUM_HW_SLOTS; i++) {
+            if (_slots[i].used) {
+                write_dr(tid, static_cast<int>(i), _slots[i].addr);
+            }
+        }
+        write_dr(tid, DR_CONTROL, get_dr7());
+    } catch (const std::invalid_argument&) {}
+}
+
+// Forget a thread that exited
+void HardwareBreakpoints::remove_thread(pid_t tid) {
+    _tids.erase(std::remove(_tids.begin(), _tids.end(), tid), _tids.end());
+}
+
+// Read a debug register of a thread
+uint64_t HardwareBreakpoints::read_dr(pid_t tid, int idx) {
+    return Stats::ptrace(PTRACE_PEEKUSER, tid, offsetof(struct user, u_debugreg) + idx * sizeof(uint64_t), nullptr);
+}
+
+// Write a debug register of a thread
+void HardwareBreakpoints::write_dr(pid_t tid, int idx, uint64_t val) {
+    if (Stats::ptrace(PTRACE_POKEUSER, tid, offsetof(struct user, u_debugreg) + idx * sizeof(uint64_t), val) == -1) {
+        throw std::invalid_argument{"Could not write debug register"};
+    }
+}
+
+// Write a debug register of every thread
+void HardwareBreakpoints::write_dr_all(int idx, uint64_t val) const {
+    for (auto tid : _tids) {
+        write_dr(tid, idx, val);
+    }
+}
+
+// Build DR7 from the used slots: local enable bit, then R/W and LEN fields for each slot
+uint64_t HardwareBreakpoints::get_dr7() const {
+    uint64_t dr7 = 0;
+    for (std::size_t i = 0; i < NUM_HW_SLOTS; i++) {
+        if (!_slots[i].used) {
+            continue;
+        }
+
+        uint64_t len_bits;
+        switch (_slots[i].len) {
+            case 1: len_bits = 0b00; break;
+            case 2: len_bits = 0b01; break;
+            case 8: len_bits = 0b10; break;
+            default: len_bits = 0b11; break;  // 4 bytes
+        }
+        dr7 |= 1ul << (i * 2);
+        dr7 |= static_cast<uint64_t>(_slots[i].type) << (16 + i * 4);
+        dr7 |= len_bits << (18 + i * 4);
+    }
+    return dr7;
+}
+
+// Program a free slot, returning its index
+int HardwareBreakpoints::set(std::uintptr_t addr, Type type, std::size_t len) {
+    if (type == Type::Execute) {
+        len = 1;    // Instruction breakpoints must use LEN = 0
+    } else if ((len != 1 && len != 2 && len != 4 && len != 8) || addr % len != 0) {
+        throw std::invalid_argument{"Watchpoint length must be 1, 2, 4 or 8 and the address aligned to it"};
+    }
+
+    for (std::size_t i = 0; i < NUM_HW_SLOTS; i++) {
+        if (!_slots[i].used) {
+            _slots[i] = Slot{true, addr, type, len};
+            try {
+                write_dr_all(static_cast<int>(i), addr);
+                write_dr_all(DR_CONTROL, get_dr7());
+            } catch (const std::invalid_argument&) {
+                _slots[i] = Slot{};
+                throw;
+            }
+            return static_cast<int>(i);
+        }
+    }
+    throw std::out_of_range{"All hardware debug registers are in use"};
+}
+
+// Free a slot
+void HardwareBreakpoints::remove(int slot) {
+    if (slot < 0 || slot >= static_cast<int>(NUM_HW_SLOTS) || !_slots[slot].used) {
+        throw std::out_of_range{"No such hardware breakpoint"};
+    }
+    _slots[slot] = Slot{};
+    write_dr_all(DR_CONTROL, get_dr7());
+}
+
+// Free all slots
+void HardwareBreakpoints::clear() {
+    _slots = {};
+    write_dr_all(DR_CONTROL, get_dr7());
+}
+
+// Find the slot programmed for an address
+int HardwareBreakpoints::find(std::uintptr_t addr, Type type) const {
+    for (std::size_t i = 0; i < NUM_HW_SLOTS; i++) {
+        if (_slots[i].used && _slots[i].addr == addr && _slots[i].type == type) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// DR6 has one status bit (B0-B3) per slot; the CPU never clears it, so we do
+int HardwareBreakpoints::get_triggered(pid_t tid) {
+    auto dr6 = read_dr(tid, DR_STATUS);
+    int slot = -1;
+    for (std::size_t i = 0; i < NUM_HW_SLOTS; i++) {
+        if ((dr6 & (1ul << i)) && _slots[i].used) {
+            slot = static_cast<int>(i);
+            break;
+        }
+    }
+    write_dr(tid, DR_STATUS, 0);
+    return slot;
+}
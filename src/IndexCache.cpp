@@ -0,0 +1,280 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "IndexCache.h"
+#include "Stats.h"
+
+constexpr char CACHE_MAGIC[8] = {'L', 'D', 'B', 'G', 'I', 'D', 'X', '\0'};
+constexpr uint32_t CACHE_FORMAT_VERSION = 1;
+constexpr std::size_t MAX_BUILD_ID = 64;
+constexpr std::size_t CACHE_ALIGN = 8;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t index_version;
+    uint64_t file_size;
+    uint64_t checksum;          // Of everything after the header
+    uint32_t num_sections;
+    uint32_t build_id_size;
+    uint8_t build_id[MAX_BUILD_ID];
+};
+
+struct SectionEntry {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;            // From the start of the file
+    uint64_t size;
+};
+
+// FNV-1a over 8 byte words (with a fold, so high bits reach the low ones), then the tail bytes
+static uint64_t checksum(const uint8_t *data, std::size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// The NT_GNU_BUILD_ID note that linkers add (--build-id, on by default on most distributions)
+static std::vector<uint8_t> read_build_id(const elf::elf& elf) {
+    for (const auto& section : elf.sections()) {
+        if (section.get_hdr().type != elf::sht::note) {
+            continue;
+        }
+        auto p = static_cast<const uint8_t *>(section.data());
+        auto end = p + section.size();
+        while (p + sizeof(Elf64_Nhdr) <= end) {
+            Elf64_Nhdr nhdr;
+            std::memcpy(&nhdr, p, sizeof(nhdr));
+            auto name = p + sizeof(nhdr);
+            auto desc = name + ((nhdr.n_namesz + 3) & ~3u);
+            if (desc + nhdr.n_descsz > end) {
+                break;
+            }
+            if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == 4 && std::memcmp(name, "GNU", 4) == 0) {
+                return {desc, desc + nhdr.n_descsz};
+            }
+            p = desc + ((nhdr.n_descsz + 3) & ~3u);
+        }
+    }
+    return {};
+}
+
+// $XDG_CACHE_HOME/linux-debugger, or ~/.cache/linux-debugger ("" if neither is set)
+static std::string cache_dir() {
+    auto xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg != nullptr && xdg[0] == '/') {
+        return std::string{xdg} + "/linux-debugger";
+    }
+    auto home = std::getenv("HOME");
+    if (home != nullptr && home[0] == '/') {
+        return std::string{home} + "/.cache/linux-debugger";
+    }
+    return "";
+}
+
+IndexCache::IndexCache(const elf::elf& elf, const std::string& kind, uint32_t version) : _version(version) {
+    _build_id = read_build_id(elf);
+    auto dir = cache_dir();
+    if (_build_id.empty() || _build_id.size() > MAX_BUILD_ID) {
+        _status = Status::NoBuildId;
+        return;
+    }
+    if (dir.empty()) {
+        _status = Status::NoCacheDir;
+        return;
+    }
+
+    static const char digits[] = "0123456789abcdef";
+    std::string name;
+    for (auto byte : _build_id) {
+        name += digits[byte >> 4];
+        name += digits[byte & 0xf];
+    }
+    _path = dir + "/" + name + "." + kind;
+    _status = Status::Miss;
+}
+
+IndexCache::~IndexCache() {
+    unmap();
+}
+
+IndexCache::IndexCache(IndexCache&& other) noexcept {
+    *this = std::move(other);
+}
+
+IndexCache& IndexCache::operator=(IndexCache&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        _status = other._status;
+        _path = std::move(other._path);
+        _build_id = std::move(other._build_id);
+        _version = other._version;
+        _data = other._data;
+        _size = other._size;
+        other._data = nullptr;
+        other._size = 0;
+    }
+    return *this;
+}
+
+void IndexCache::unmap() {
+    if (_data != nullptr) {
+        munmap(const_cast<uint8_t *>(_data), _size);
+        _data = nullptr;
+        _size = 0;
+    }
+}
+
+// Map the cached file and check that it is complete and built from this binary by this version
+bool IndexCache::load() {
+    if (_path.empty()) {
+        return false;
+    }
+    unmap();
+    _status = Status::Miss;
+
+    int fd = Stats::timed(Stats::Call::FileRead, [&] { return open(_path.c_str(), O_RDONLY | O_CLOEXEC); });
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st{};
+    auto map = Stats::timed(Stats::Call::FileRead, [&] {
+        auto map = fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(FileHeader))
+                   ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        return map;
+    });
+    _status = Status::Stale;
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    _data = static_cast<const uint8_t *>(map);
+    _size = st.st_size;
+
+    auto& header = *reinterpret_cast<const FileHeader *>(_data);
+    auto valid = std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+                 header.format_version == CACHE_FORMAT_VERSION && header.index_version == _version &&
+                 header.file_size == _size && header.build_id_size == _build_id.size() &&
+                 std::memcmp(header.build_id, _build_id.data(), _build_id.size()) == 0 &&
+                 header.num_sections <= (_size - sizeof(FileHeader)) / sizeof(SectionEntry);
+
+    auto entries = reinterpret_cast<const SectionEntry *>(_data + sizeof(FileHeader));
+    for (uint32_t i = 0; valid && i < header.num_sections; i++) {
+        auto& entry = entries[i];
+        valid = entry.offset % CACHE_ALIGN == 0 && entry.offset <= _size && entry.size <= _size - entry.offset;
+    }
+    if (!valid || (std::getenv("LINUX_DEBUGGER_VERIFY_CACHE") != nullptr && !verify())) {
+        unmap();
+        return false;
+    }
+    _status = Status::Hit;
+    return true;
+}
+
+bool IndexCache::verify() const {
+    if (_data == nullptr) {
+        return false;
+    }
+    auto& header = *reinterpret_cast<const FileHeader *>(_data);
+    return header.checksum == checksum(_data + sizeof(FileHeader), _size - sizeof(FileHeader));
+}
+
+bool IndexCache::get_raw(uint32_t id, const void *&data, std::size_t& size) const {
+    if (_data == nullptr) {
+        return false;
+    }
+    auto& header = *reinterpret_cast<const FileHeader *>(_data);
+    auto entries = reinterpret_cast<const SectionEntry *>(_data + sizeof(FileHeader));
+    for (uint32_t i = 0; i < header.num_sections; i++) {
+        if (entries[i].id == id) {
+            data = _data + entries[i].offset;
+            size = entries[i].size;
+            return true;
+        }
+    }
+    return false;
+}
+
+void IndexCache::invalidate() {
+    unmap();
+    _status = Status::Stale;
+}
+
+// Lay the file out in memory, then write it under a temporary name and rename it over the old one
+bool IndexCache::save(const std::vector<Section>& sections) const {
+    if (_path.empty()) {
+        return false;
+    }
+    auto dir = _path.substr(0, _path.rfind('/'));
+    mkdir(dir.substr(0, dir.rfind('/')).c_str(), 0700);    // ~/.cache itself may not exist yet
+    mkdir(dir.c_str(), 0700);
+
+    auto align = [](std::size_t offset) { return (offset + CACHE_ALIGN - 1) & ~(CACHE_ALIGN - 1); };
+    auto offset = sizeof(FileHeader) + sections.size() * sizeof(SectionEntry);
+    std::vector<SectionEntry> entries;
+    for (auto& section : sections) {
+        offset = align(offset);
+        entries.push_back(SectionEntry{section.id, 0, offset, section.size});
+        offset += section.size;
+    }
+
+    std::vector<uint8_t> file(offset);
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        if (sections[i].size != 0) {
+            std::memcpy(file.data() + entries[i].offset, sections[i].data, sections[i].size);
+        }
+    }
+    if (!entries.empty()) {
+        std::memcpy(file.data() + sizeof(FileHeader), entries.data(), entries.size() * sizeof(SectionEntry));
+    }
+    FileHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.format_version = CACHE_FORMAT_VERSION;
+    header.index_version = _version;
+    header.file_size = file.size();
+    header.checksum = checksum(file.data() + sizeof(FileHeader), file.size() - sizeof(FileHeader));
+    header.num_sections = static_cast<uint32_t>(sections.size());
+    header.build_id_size = static_cast<uint32_t>(_build_id.size());
+    std::memcpy(header.build_id, _build_id.data(), _build_id.size());
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    auto tmp_path = _path + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    auto p = file.data();
+    auto remaining = file.size();
+    while (remaining > 0) {
+        auto n = write(fd, p, remaining);
+        if (n <= 0) {
+            break;
+        }
+        p += n;
+        remaining -= n;
+    }
+    close(fd);
+    if (remaining != 0 || rename(tmp_path.c_str(), _path.c_str()) == -1) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,161 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include "ModuleMap.h"
+#include "Stats.h"
+#include "Utils.h"
+
+constexpr std::size_t MAX_MODULES = 65536;  // Guards against a corrupt (cyclic) link_map list
+
+// Locate r_debug and _dl_debug_state in the dynamic linker, which the kernel mapped at AT_BASE
+uint64_t ModuleMap::init(pid_t pid) {
+    _modules.clear();
+    _r_debug = 0;
+
+    auto base = Stats::timed(Stats::Call::FileRead, [&] {
+        uint64_t base = 0;
+        std::ifstream auxv {"/proc/" + std::to_string(pid) + "/auxv", std::ios::binary};
+        Elf64_auxv_t entry;
+        while (auxv.read(reinterpret_cast<char *>(&entry), sizeof(entry)) && entry.a_type != AT_NULL) {
+            if (entry.a_type == AT_BASE) {
+                base = entry.a_un.a_val;
+            }
+        }
+        return base;
+    });
+    if (base == 0) {
+        return 0;
+    }
+
+    auto maps = Utils::read_maps(pid);
+    auto interp = std::find_if(maps.begin(), maps.end(), [&](auto& m) { return m.start == base && m.offset == 0; });
+    if (interp == maps.end()) {
+        return 0;
+    }
+    auto symbols = get_symbols(interp->path);
+    if (symbols == nullptr) {
+        return 0;
+    }
+
+    uint64_t debug_state = 0;
+    for (auto& symbol : symbols->find("_dl_debug_state")) {
+        debug_state = symbol.addr;
+    }
+    for (auto& symbol : symbols->find("_r_debug")) {
+        _r_debug = base + symbol.addr;
+    }
+    if (debug_state == 0 || _r_debug == 0) {
+        _r_debug = 0;
+        return 0;
+    }
+    return base + debug_state;
+}
+
+// Walk the link_map list in the debuggee. The address ranges come from /proc/<pid>/maps: a module spans the
+// mappings of the file that holds its dynamic section (l_ld)
+bool ModuleMap::update(pid_t pid, ProcessMemory& memory) {
+    r_debug debug{};
+    if (_r_debug == 0 || memory.read(_r_debug, &debug, sizeof(debug)) != sizeof(debug)) {
+        return true;
+    }
+    if (debug.r_state != r_debug::RT_CONSISTENT) {
+        return false;
+    }
+
+    auto maps = Utils::read_maps(pid);
+    std::vector<Module> modules;
+    auto addr = reinterpret_cast<uint64_t>(debug.r_map);
+    for (std::size_t count = 0; addr != 0 && count < MAX_MODULES; count++) {
+        link_map entry{};
+        if (memory.read(addr, &entry, sizeof(entry)) != sizeof(entry)) {
+            break;
+        }
+        addr = reinterpret_cast<uint64_t>(entry.l_next);
+
+        // The main executable has an empty name
+        char name[PATH_MAX];
+        auto len = memory.read(reinterpret_cast<uint64_t>(entry.l_name), name, sizeof(name));
+        if (entry.l_name == nullptr || strnlen(name, len) == 0) {
+            continue;
+        }
+
+        // Maps name the file as the kernel opened it (with symlinks resolved), unlike l_name
+        auto dynamic = reinterpret_cast<uint64_t>(entry.l_ld);
+        auto mapping = std::find_if(maps.begin(), maps.end(),
+                                    [&](auto& m) { return dynamic >= m.start && dynamic < m.end; });
+        if (mapping == maps.end()) {
+            continue;
+        }
+        Module module{mapping->path, UINT64_MAX, 0, entry.l_addr};
+        for (auto& m : maps) {
+            if (m.path == module.path) {
+                module.low = std::min(module.low, m.start);
+                module.high = std::max(module.high, m.end);
+            }
+        }
+        modules.push_back(module);
+    }
+
+    std::sort(modules.begin(), modules.end(), [](auto& a, auto& b) { return a.low < b.low; });
+    _modules = std::move(modules);
+    return true;
+}
+
+// Find the module containing an address (binary search over the sorted ranges)
+const ModuleMap::Module* ModuleMap::find(uint64_t addr) const {
+    auto iter = std::upper_bound(_modules.begin(), _modules.end(), addr,
+                                 [](uint64_t a, const Module& m) { return a < m.low; });
+    if (iter == _modules.begin() || addr >= (--iter)->high) {
+        return nullptr;
+    }
+    return &*iter;
+}
+
+// Load a module's DWARF, symbols and CFI on first use (a failure is remembered too)
+DwarfContext* ModuleMap::get_context(const Module& module) {
+    auto iter = _contexts.find(module.path);
+    if (iter == _contexts.end()) {
+        std::unique_ptr<DwarfContext> ctx;
+        if (!module.path.empty() && module.path[0] == '/') {   // Not [vdso] and the like
+            try {
+                ctx = std::make_unique<DwarfContext>(module.path);
+            } catch (const std::exception&) {}
+        }
+        iter = _contexts.emplace(module.path, std::move(ctx)).first;
+    }
+    return iter->second.get();
+}
+
+bool ModuleMap::is_loaded(const Module& module) const {
+    auto iter = _contexts.find(module.path);
+    return iter != _contexts.end() && iter->second != nullptr;
+}
+
+// Map a file and index its symbol tables only, without its DWARF and CFI (a failure is remembered too)
+const SymbolIndex* ModuleMap::get_symbols(const std::string& path) {
+    auto iter = _symbols.find(path);
+    if (iter == _symbols.end()) {
+        std::unique_ptr<SymbolFile> file;
+        int fd = !path.empty() && path[0] == '/'
+                 ? Stats::timed(Stats::Call::FileRead, [&] { return open(path.c_str(), O_RDONLY); }) : -1;
+        if (fd != -1) {
+            try {
+                file = std::make_unique<SymbolFile>();
+                file->elf = elf::elf{elf::create_mmap_loader(fd)};
+                file->index.build(file->elf);
+            } catch (const std::exception&) {
+                file.reset();
+            }
+        }
+        iter = _symbols.emplace(path, std::move(file)).first;
+    }
+    return iter->second ? &iter->second->index : nullptr;
+}
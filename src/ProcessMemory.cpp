@@ -0,0 +1,114 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <string>
+#include "CoreFile.h"
+#include "ProcessMemory.h"
+#include "Stats.h"
+
+ProcessMemory::~ProcessMemory() {
+    if (_mem_fd != -1) {
+        close(_mem_fd);
+    }
+}
+
+// Point the accessor at another process
+void ProcessMemory::reset(pid_t pid) {
+    if (_mem_fd != -1) {
+        close(_mem_fd);
+        _mem_fd = -1;
+    }
+    _pid = pid;
+    _core = nullptr;
+}
+
+// Serve reads from a core file (post-mortem debugging)
+void ProcessMemory::reset(const CoreFile *core) {
+    reset(core->get_pid());
+    _core = core;
+}
+
+// Get (and lazily open) the /proc/<pid>/mem file
+int ProcessMemory::mem_fd() {
+    if (_mem_fd == -1) {
+        std::string path = "/proc/" + std::to_string(_pid) + "/mem";
+        _mem_fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    }
+    return _mem_fd;
+}
+
+// Read len bytes at addr into buf
+std::size_t ProcessMemory::read(uint64_t addr, void *buf, std::size_t len) {
+    if (_core != nullptr) {
+        return _core->read(addr, buf, len);
+    }
+    std::size_t done = 0;
+    auto out = static_cast<char *>(buf);
+
+    while (done < len) {
+        iovec local {out + done, len - done};
+        iovec remote {reinterpret_cast<void *>(addr + done), len - done};
+        auto n = Stats::timed(Stats::Call::MemoryRead, [&] { return process_vm_readv(_pid, &local, 1, &remote, 1, 0); });
+        if (n <= 0) {
+            // Fall back to /proc/<pid>/mem for the rest (e.g. pages without read permission)
+            n = Stats::timed(Stats::Call::MemoryRead,
+                             [&] { return pread(mem_fd(), out + done, len - done, static_cast<off_t>(addr + done)); });
+            if (n <= 0) {
+                break;
+            }
+        }
+        done += n;  // Partial transfers stop at the first unreadable page, so retry from there
+    }
+    return done;
+}
+
+// Write len bytes from buf to addr
+std::size_t ProcessMemory::write(uint64_t addr, const void *buf, std::size_t len) {
+    if (_core != nullptr) {
+        return 0;
+    }
+    std::size_t done = 0;
+    auto in = static_cast<const char *>(buf);
+
+    while (done < len) {
+        iovec local {const_cast<char *>(in + done), len - done};
+        iovec remote {reinterpret_cast<void *>(addr + done), len - done};
+        auto n = Stats::timed(Stats::Call::MemoryWrite, [&] { return process_vm_writev(_pid, &local, 1, &remote, 1, 0); });
+        if (n <= 0) {
+            // Read-only mappings (text pages) can only be written through /proc/<pid>/mem
+            n = Stats::timed(Stats::Call::MemoryWrite,
+                             [&] { return pwrite(mem_fd(), in + done, len - done, static_cast<off_t>(addr + done)); });
+            if (n <= 0) {
+                break;
+            }
+        }
+        done += n;
+    }
+    return done;
+}
+
+// Write len bytes from buf to addr, ignoring page protections.
+// Used for text pages, where trying process_vm_writev first would only waste a syscall.
+std::size_t ProcessMemory::write_forced(uint64_t addr, const void *buf, std::size_t len) {
+    if (_core != nullptr) {
+        return 0;
+    }
+    auto n = Stats::timed(Stats::Call::MemoryWrite, [&] { return pwrite(mem_fd(), buf, len, static_cast<off_t>(addr)); });
+    return n < 0 ? 0 : static_cast<std::size_t>(n);
+}
+
+// Read a single 64 bit word
+uint64_t ProcessMemory::read_word(uint64_t addr) {
+    uint64_t val = 0;
+    read(addr, &val, sizeof(val));
+    return val;
+}
+
+// Write a single 64 bit word
+void ProcessMemory::write_word(uint64_t addr, uint64_t val) {
+    write(addr, &val, sizeof(val));
+}
@@ -0,0 +1,54 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include "Profiler.h"
+
+Profiler::Profiler(std::size_t max_stacks) : _max_stacks{max_stacks} {
+    std::size_t capacity = 16;
+    while (capacity < max_stacks * 2) {
+        capacity <<= 1;
+    }
+    _stacks.assign(capacity, Stack{0, 0, 0, 0});
+    _pcs.resize(max_stacks * MAX_DEPTH);
+}
+
+// FNV-1a hash over the PC sequence, a word at a time
+std::uint64_t Profiler::hash(const std::uint64_t *pcs, std::size_t depth) {
+    std::uint64_t h = 14695981039346656037ull;
+    for (std::size_t i = 0; i < depth; i++) {
+        h ^= pcs[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool Profiler::add(const std::uint64_t *pcs, std::size_t depth) {
+    depth = std::min(depth, MAX_DEPTH);
+    if (depth == 0) {
+        return false;
+    }
+    _samples++;
+
+    auto h = hash(pcs, depth);
+    auto mask = _stacks.size() - 1;
+    for (auto pos = h & mask;; pos = (pos + 1) & mask) {
+        auto& stack = _stacks[pos];
+        if (stack.depth == 0) {
+            if (_size == _max_stacks || _pcs_used + depth > _pcs.size()) {
+                _dropped++;
+                return false;
+            }
+            std::copy(pcs, pcs + depth, &_pcs[_pcs_used]);
+            stack = Stack{h, static_cast<std::uint32_t>(_pcs_used), static_cast<std::uint32_t>(depth), 1};
+            _pcs_used += depth;
+            _size++;
+            return true;
+        }
+        if (stack.hash == h && stack.depth == depth && std::equal(pcs, pcs + depth, &_pcs[stack.offset])) {
+            stack.count++;
+            return true;
+        }
+    }
+}
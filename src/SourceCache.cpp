@@ -0,0 +1,85 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "SourceCache.h"
+#include "Stats.h"
+
+// Number of lines in the file (a trailing newline does not start a new line)
+std::size_t SourceCache::File::num_lines() const {
+    auto n = line_starts.size();
+    return (n > 0 && line_starts.back() == size) ? n - 1 : n;
+}
+
+// Get the text of a line
+std::string_view SourceCache::File::get_line(std::size_t line) const {
+    if (line == 0 || line > num_lines()) {
+        return {};
+    }
+    auto start = line_starts[line - 1];
+    auto end = line < line_starts.size() ? line_starts[line] - 1 : size;
+    return {data.get() + start, end - start};
+}
+
+// Record the offset of the start of every line, scanning 16 bytes at a time for newlines
+void SourceCache::index_lines(const char *data, std::size_t size, std::vector<std::size_t>& line_starts) {
+    line_starts.push_back(0);
+    std::size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        while (mask != 0) {
+            line_starts.push_back(i + __builtin_ctz(mask) + 1);
+            mask &= mask - 1;   // Clear the lowest set bit
+        }
+    }
+#endif
+
+    for (; i < size; i++) {
+        if (data[i] == '\n') {
+            line_starts.push_back(i + 1);
+        }
+    }
+}
+
+// Get a file, mapping and indexing it on first use
+const SourceCache::File* SourceCache::get(const std::string& path) {
+    auto iter = _files.find(path);
+    if (iter != _files.end()) {
+        return &iter->second;
+    }
+
+    auto fd = Stats::timed(Stats::Call::FileRead, [&] { return open(path.c_str(), O_RDONLY | O_CLOEXEC); });
+    if (fd == -1) {
+        return nullptr;
+    }
+
+    // Indexing the lines is what reads the file in
+    File file;
+    Stats::timed(Stats::Call::FileRead, [&] {
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            auto size = static_cast<std::size_t>(st.st_size);
+            auto addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                file.data = std::shared_ptr<const char>(static_cast<const char *>(addr),
+                                                        [size](const char *p) { munmap(const_cast<char *>(p), size); });
+                file.size = size;
+                index_lines(file.data.get(), size, file.line_starts);
+            }
+        }
+        return close(fd);
+    });
+
+    return &_files.emplace(path, std::move(file)).first->second;
+}
@@ -0,0 +1,202 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "Stats.h"
+
+#ifdef DEBUGGER_STATS
+
+constexpr std::size_t NUM_CALLS = static_cast<std::size_t>(Stats::Call::Count);
+constexpr std::size_t NUM_BUCKETS = 40;     // Bucket i counts calls taking [2^i, 2^(i+1)) ns
+
+static const char *call_names[NUM_CALLS] = {
+        "ptrace-resume", "ptrace-regs", "ptrace-user", "ptrace-other", "waitpid", "memory-read", "memory-write",
+        "file-read",
+};
+
+struct Histogram {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t buckets[NUM_BUCKETS] = {};
+
+    void add(uint64_t ns) {
+        count++;
+        total_ns += ns;
+        max_ns = std::max(max_ns, ns);
+        buckets[std::min<std::size_t>(63 - __builtin_clzll(ns | 1), NUM_BUCKETS - 1)]++;
+    }
+
+    // Upper bound of the bucket holding the p-th percentile (capped by the slowest call)
+    uint64_t percentile(double p) const {
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < NUM_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen > 0 && seen >= p * count) {
+                return std::min(max_ns, (uint64_t{2} << i) - 1);
+            }
+        }
+        return max_ns;
+    }
+};
+
+struct CommandStats {
+    std::string name;
+    uint64_t runs = 0;
+    uint64_t total_ns = 0;
+    Histogram calls[NUM_CALLS];
+};
+
+// Calls outside any command (launching or attaching) go to the first entry
+static std::vector<CommandStats> commands {CommandStats{"(startup)"}};
+static std::size_t current = 0;
+
+void Stats::record(Call call, uint64_t ns) {
+    commands[current].calls[static_cast<std::size_t>(call)].add(ns);
+}
+
+Stats::CommandScope::CommandScope(std::string_view prefix, std::string_view name) : _previous(current) {
+    auto iter = std::find_if(commands.begin(), commands.end(), [&](auto& c) {
+        return c.name.size() == prefix.size() + name.size() && c.name.compare(0, prefix.size(), prefix) == 0 &&
+               c.name.compare(prefix.size(), name.size(), name) == 0;
+    });
+    if (iter == commands.end()) {
+        iter = commands.insert(commands.end(), CommandStats{std::string{prefix}.append(name)});
+    }
+    current = iter - commands.begin();
+    _start = std::chrono::steady_clock::now();
+}
+
+Stats::CommandScope::~CommandScope() {
+    auto& command = commands[current];
+    command.runs++;
+    command.total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - _start).count();
+    current = _previous;
+}
+
+bool Stats::enabled() {
+    return true;
+}
+
+uint64_t Stats::total_calls() {
+    uint64_t total = 0;
+    for (auto& command : commands) {
+        for (auto& h : command.calls) {
+            total += h.count;
+        }
+    }
+    return total;
+}
+
+// Print a table per command: how often it ran, then the calls it made and their latencies
+void Stats::print() {
+    auto us = [](uint64_t ns) { return ns / 1000.0; };
+    std::cout << std::fixed << std::setprecision(1);
+    for (auto& command : commands) {
+        uint64_t num_calls = 0;
+        for (auto& h : command.calls) {
+            num_calls += h.count;
+        }
+        if (command.runs == 0 && num_calls == 0) {
+            continue;
+        }
+        std::cout << command.name;
+        if (command.runs > 0) {
+            std::cout << ": " << command.runs << " runs, " << us(command.total_ns / command.runs) << " us each";
+        }
+        std::cout << '\n';
+        for (std::size_t i = 0; i < NUM_CALLS; i++) {
+            auto& h = command.calls[i];
+            if (h.count == 0) {
+                continue;
+            }
+            std::cout << "    " << std::left << std::setw(14) << call_names[i] << std::right << std::setw(10) << h.count
+                      << " calls  avg " << std::setw(8) << us(h.total_ns / h.count) << " us  p50 " << std::setw(8)
+                      << us(h.percentile(0.5)) << " us  p99 " << std::setw(8) << us(h.percentile(0.99))
+                      << " us  max " << std::setw(8) << us(h.max_ns) << " us\n";
+        }
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+static void write_json_string(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// The same data as JSON, including the histogram buckets (trailing empty ones left out)
+void Stats::dump_json(std::ostream& out) {
+    out << "{\"enabled\": true, \"bucket_bounds\": \"bucket i counts calls of [2^i, 2^(i+1)) ns\", \"commands\": [";
+    for (std::size_t c = 0; c < commands.size(); c++) {
+        auto& command = commands[c];
+        out << (c > 0 ? ", " : "") << "{\"name\": ";
+        write_json_string(out, command.name);
+        out << ", \"runs\": " << command.runs << ", \"total_ns\": " << command.total_ns << ", \"calls\": {";
+        bool first = true;
+        for (std::size_t i = 0; i < NUM_CALLS; i++) {
+            auto& h = command.calls[i];
+            if (h.count == 0) {
+                continue;
+            }
+            out << (first ? "" : ", ") << '"' << call_names[i] << "\": {\"count\": " << h.count << ", \"total_ns\": "
+                << h.total_ns << ", \"max_ns\": " << h.max_ns << ", \"p50_ns\": " << h.percentile(0.5)
+                << ", \"p99_ns\": " << h.percentile(0.99) << ", \"buckets\": [";
+            auto last = NUM_BUCKETS;
+            while (last > 0 && h.buckets[last - 1] == 0) {
+                last--;
+            }
+            for (std::size_t b = 0; b < last; b++) {
+                out << (b > 0 ? ", " : "") << h.buckets[b];
+            }
+            out << "]}";
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "]}\n";
+}
+
+// Zero all counters (commands keep their place, as one may be running)
+void Stats::reset() {
+    for (auto& command : commands) {
+        command.runs = 0;
+        command.total_ns = 0;
+        std::fill(std::begin(command.calls), std::end(command.calls), Histogram{});
+    }
+}
+
+#else
+
+bool Stats::enabled() {
+    return false;
+}
+
+uint64_t Stats::total_calls() {
+    return 0;
+}
+
+void Stats::print() {
+    std::cout << "Statistics were compiled out (configure with -DENABLE_STATS=ON)\n";
+}
+
+void Stats::dump_json(std::ostream& out) {
+    out << "{\"enabled\": false}\n";
+}
+
+void Stats::reset() {}
+
+#endif
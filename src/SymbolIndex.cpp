@@ -0,0 +1,162 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include <fnmatch.h>
+#include <stdexcept>
+#include "SymbolIndex.h"
+
+// Map ELF enum types to our enum (to avoid dependency issues)
+SymbolIndex::SymbolType SymbolIndex::get_symbol_type(elf::stt symbol) {
+    switch (symbol) {
+        case elf::stt::notype: return SymbolType::NoType;
+        case elf::stt::object: return SymbolType::Object;
+        case elf::stt::func: return SymbolType::Function;
+        case elf::stt::section: return SymbolType::Section;
+        case elf::stt::file: return SymbolType::File;
+        default: throw std::invalid_argument{"Not supported"};
+    }
+}
+
+// FNV-1a hash of a symbol name
+std::uint32_t SymbolIndex::hash(std::string_view name) {
+    std::uint32_t h = 2166136261u;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Collect the symbols of all symbol tables, then build the hash table and address order over them
+void SymbolIndex::build(const elf::elf& elf) {
+    _symbols.clear();
+    _by_addr.clear();
+    _slots.clear();
+
+    for (const auto& section : elf.sections()) {
+        if (section.get_hdr().type != elf::sht::symtab && section.get_hdr().type != elf::sht::dynsym) {
+            continue;
+        }
+
+        for (auto sym : section.as_symtab()) {
+            auto& data = sym.get_data();
+            std::size_t len;
+            const char* name = sym.get_name(&len);
+            if (len == 0) {
+                continue;   // Null and unnamed section symbols
+            }
+
+            SymbolType type;
+            try {
+                type = get_symbol_type(data.type());
+            } catch (const std::invalid_argument&) {
+                continue;   // TLS, common, IFUNC, ...
+            }
+            _symbols.push_back(Symbol{type, std::string_view{name, len}, data.value, data.size});
+        }
+    }
+
+    std::sort(_symbols.begin(), _symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.name < b.name || (a.name == b.name && a.addr < b.addr);
+    });
+
+    // Hash table with one slot per distinct name, kept at most half full
+    std::size_t capacity = 16;
+    while (capacity < _symbols.size() * 2) {
+        capacity <<= 1;
+    }
+    _slots.assign(capacity, Slot{0, 0, 0});
+    auto mask = capacity - 1;
+
+    for (std::size_t i = 0; i < _symbols.size();) {
+        auto j = i + 1;
+        while (j < _symbols.size() && _symbols[j].name == _symbols[i].name) {
+            j++;
+        }
+
+        auto h = hash(_symbols[i].name);
+        auto pos = h & mask;
+        while (_slots[pos].first != 0) {
+            pos = (pos + 1) & mask;
+        }
+        _slots[pos] = Slot{h, static_cast<std::uint32_t>(i + 1), static_cast<std::uint32_t>(j - i)};
+        i = j;
+    }
+
+    // Only symbols that name code or data take part in reverse lookups
+    for (std::size_t i = 0; i < _symbols.size(); i++) {
+        auto& s = _symbols[i];
+        if (s.addr != 0 && (s.type == SymbolType::Function || s.type == SymbolType::Object ||
+                            s.type == SymbolType::NoType)) {
+            _by_addr.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    std::sort(_by_addr.begin(), _by_addr.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return _symbols[a].addr < _symbols[b].addr;
+    });
+
+    _built = true;
+}
+
+// Get all symbols with exactly the given name
+SymbolIndex::SymbolRange SymbolIndex::find(std::string_view name) const {
+    if (_slots.empty()) {
+        return {};
+    }
+
+    auto h = hash(name);
+    auto mask = _slots.size() - 1;
+    for (auto pos = h & mask; _slots[pos].first != 0; pos = (pos + 1) & mask) {
+        auto& slot = _slots[pos];
+        if (slot.hash == h && _symbols[slot.first - 1].name == name) {
+            auto first = _symbols.data() + slot.first - 1;
+            return {first, first + slot.count};
+        }
+    }
+    return {};
+}
+
+// Get all symbols whose name starts with the given prefix
+SymbolIndex::SymbolRange SymbolIndex::find_prefix(std::string_view prefix) const {
+    auto first = std::lower_bound(_symbols.begin(), _symbols.end(), prefix,
+                                  [](const Symbol& s, std::string_view p) { return s.name < p; });
+    auto last = first;
+    while (last != _symbols.end() && last->name.substr(0, prefix.size()) == prefix) {
+        ++last;
+    }
+    return {_symbols.data() + (first - _symbols.begin()), _symbols.data() + (last - _symbols.begin())};
+}
+
+// Get all symbols matching a shell-style glob pattern (e.g. "foo*")
+void SymbolIndex::find_glob(const std::string& pattern, std::vector<const Symbol*>& out) const {
+    // Only the literal part before the first wildcard can be used to narrow the search
+    auto literal = pattern.substr(0, pattern.find_first_of("*?[\\"));
+    for (auto& s : find_prefix(literal)) {
+        // Names point into ELF string tables, so they are NUL-terminated
+        if (fnmatch(pattern.c_str(), s.name.data(), 0) == 0) {
+            out.push_back(&s);
+        }
+    }
+}
+
+// Get the symbol containing the given address (nullptr if none)
+const SymbolIndex::Symbol* SymbolIndex::find_by_address(std::uint64_t addr) const {
+    auto iter = std::upper_bound(_by_addr.begin(), _by_addr.end(), addr,
+                                 [this](std::uint64_t a, std::uint32_t idx) { return a < _symbols[idx].addr; });
+
+    // Several symbols (aliases) may start at the same address; take the first one that covers addr
+    auto start = iter == _by_addr.begin() ? 0 : _symbols[*(iter - 1)].addr;
+    while (iter != _by_addr.begin()) {
+        --iter;
+        auto& s = _symbols[*iter];
+        if (s.addr != start) {
+            break;
+        }
+        if (addr < s.addr + s.size || (s.size == 0 && addr == s.addr)) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
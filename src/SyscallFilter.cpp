@@ -0,0 +1,619 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <fcntl.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "SyscallFilter.h"
+#include "Utils.h"
+
+constexpr std::size_t MAX_STRING = 256;     // Read for a path or other string argument
+constexpr std::size_t MAX_BUFFER = 32;      // Printed of a buffer argument (e.g. the data given to write)
+
+struct Syscall {
+    long nr;
+    const char *name;
+    // The kind of the result, then of each argument: d int, l long, u unsigned, x hex, o octal, s string,
+    // b buffer (its length is the next argument), f directory fd (or AT_FDCWD), - no result (never returns).
+    // Unknown for system calls that are rarely traced, which are printed with six hex arguments
+    const char *kinds;
+};
+
+// From asm/unistd_64.h, sorted by number
+static const Syscall SYSCALLS[] = {
+    {0, "read", "ldxu"},
+    {1, "write", "ldbu"},
+    {2, "open", "dsxo"},
+    {3, "close", "dd"},
+    {4, "stat", "dsx"},
+    {5, "fstat", "ddx"},
+    {6, "lstat", "dsx"},
+    {7, "poll", "dxud"},
+    {8, "lseek", "ldld"},
+    {9, "mmap", "xxuxxdx"},
+    {10, "mprotect", "dxux"},
+    {11, "munmap", "dxu"},
+    {12, "brk", "xx"},
+    {13, "rt_sigaction", "ddxxu"},
+    {14, "rt_sigprocmask", "ddxxu"},
+    {15, "rt_sigreturn", "d"},
+    {16, "ioctl", "ddxx"},
+    {17, "pread64", "ldxul"},
+    {18, "pwrite64", "ldbul"},
+    {19, "readv", "ldxd"},
+    {20, "writev", "ldxd"},
+    {21, "access", "dsd"},
+    {22, "pipe", "dx"},
+    {23, "select", "ddxxxx"},
+    {24, "sched_yield", "d"},
+    {25, "mremap", "xxuuxx"},
+    {26, "msync", "dxux"},
+    {27, "mincore", nullptr},
+    {28, "madvise", "dxud"},
+    {29, "shmget", nullptr},
+    {30, "shmat", nullptr},
+    {31, "shmctl", nullptr},
+    {32, "dup", "dd"},
+    {33, "dup2", "ddd"},
+    {34, "pause", "d"},
+    {35, "nanosleep", "dxx"},
+    {36, "getitimer", nullptr},
+    {37, "alarm", nullptr},
+    {38, "setitimer", nullptr},
+    {39, "getpid", "d"},
+    {40, "sendfile", "lddxu"},
+    {41, "socket", "dddd"},
+    {42, "connect", "ddxu"},
+    {43, "accept", "ddxx"},
+    {44, "sendto", "ldbuxxu"},
+    {45, "recvfrom", "ldxuxxx"},
+    {46, "sendmsg", "ldxx"},
+    {47, "recvmsg", "ldxx"},
+    {48, "shutdown", "ddd"},
+    {49, "bind", "ddxu"},
+    {50, "listen", "ddd"},
+    {51, "getsockname", "ddxx"},
+    {52, "getpeername", "ddxx"},
+    {53, "socketpair", "ddddx"},
+    {54, "setsockopt", "ddddxu"},
+    {55, "getsockopt", "ddddxx"},
+    {56, "clone", "dxxxxx"},
+    {57, "fork", "d"},
+    {58, "vfork", "d"},
+    {59, "execve", "dsxx"},
+    {60, "exit", "-d"},
+    {61, "wait4", "ddxxx"},
+    {62, "kill", "ddd"},
+    {63, "uname", "dx"},
+    {64, "semget", nullptr},
+    {65, "semop", nullptr},
+    {66, "semctl", nullptr},
+    {67, "shmdt", nullptr},
+    {68, "msgget", nullptr},
+    {69, "msgsnd", nullptr},
+    {70, "msgrcv", nullptr},
+    {71, "msgctl", nullptr},
+    {72, "fcntl", "dddx"},
+    {73, "flock", "ddd"},
+    {74, "fsync", "dd"},
+    {75, "fdatasync", "dd"},
+    {76, "truncate", "dsl"},
+    {77, "ftruncate", "ddl"},
+    {78, "getdents", "ddxu"},
+    {79, "getcwd", "xxu"},
+    {80, "chdir", "ds"},
+    {81, "fchdir", "dd"},
+    {82, "rename", "dss"},
+    {83, "mkdir", "dso"},
+    {84, "rmdir", "ds"},
+    {85, "creat", "dso"},
+    {86, "link", "dss"},
+    {87, "unlink", "ds"},
+    {88, "symlink", "dss"},
+    {89, "readlink", "lsxu"},
+    {90, "chmod", "dso"},
+    {91, "fchmod", "ddo"},
+    {92, "chown", "dsdd"},
+    {93, "fchown", nullptr},
+    {94, "lchown", nullptr},
+    {95, "umask", "oo"},
+    {96, "gettimeofday", "dxx"},
+    {97, "getrlimit", "ddx"},
+    {98, "getrusage", "ddx"},
+    {99, "sysinfo", "dx"},
+    {100, "times", nullptr},
+    {101, "ptrace", nullptr},
+    {102, "getuid", "d"},
+    {103, "syslog", nullptr},
+    {104, "getgid", "d"},
+    {105, "setuid", "dd"},
+    {106, "setgid", "dd"},
+    {107, "geteuid", "d"},
+    {108, "getegid", "d"},
+    {109, "setpgid", nullptr},
+    {110, "getppid", "d"},
+    {111, "getpgrp", nullptr},
+    {112, "setsid", "d"},
+    {113, "setreuid", nullptr},
+    {114, "setregid", nullptr},
+    {115, "getgroups", nullptr},
+    {116, "setgroups", nullptr},
+    {117, "setresuid", nullptr},
+    {118, "getresuid", nullptr},
+    {119, "setresgid", nullptr},
+    {120, "getresgid", nullptr},
+    {121, "getpgid", nullptr},
+    {122, "setfsuid", nullptr},
+    {123, "setfsgid", nullptr},
+    {124, "getsid", nullptr},
+    {125, "capget", nullptr},
+    {126, "capset", nullptr},
+    {127, "rt_sigpending", nullptr},
+    {128, "rt_sigtimedwait", nullptr},
+    {129, "rt_sigqueueinfo", nullptr},
+    {130, "rt_sigsuspend", nullptr},
+    {131, "sigaltstack", nullptr},
+    {132, "utime", nullptr},
+    {133, "mknod", nullptr},
+    {134, "uselib", nullptr},
+    {135, "personality", nullptr},
+    {136, "ustat", nullptr},
+    {137, "statfs", nullptr},
+    {138, "fstatfs", nullptr},
+    {139, "sysfs", nullptr},
+    {140, "getpriority", nullptr},
+    {141, "setpriority", nullptr},
+    {142, "sched_setparam", nullptr},
+    {143, "sched_getparam", nullptr},
+    {144, "sched_setscheduler", nullptr},
+    {145, "sched_getscheduler", nullptr},
+    {146, "sched_get_priority_max", nullptr},
+    {147, "sched_get_priority_min", nullptr},
+    {148, "sched_rr_get_interval", nullptr},
+    {149, "mlock", nullptr},
+    {150, "munlock", nullptr},
+    {151, "mlockall", nullptr},
+    {152, "munlockall", nullptr},
+    {153, "vhangup", nullptr},
+    {154, "modify_ldt", nullptr},
+    {155, "pivot_root", nullptr},
+    {156, "_sysctl", nullptr},
+    {157, "prctl", "ddxxxx"},
+    {158, "arch_prctl", "dxx"},
+    {159, "adjtimex", nullptr},
+    {160, "setrlimit", nullptr},
+    {161, "chroot", nullptr},
+    {162, "sync", nullptr},
+    {163, "acct", nullptr},
+    {164, "settimeofday", nullptr},
+    {165, "mount", nullptr},
+    {166, "umount2", nullptr},
+    {167, "swapon", nullptr},
+    {168, "swapoff", nullptr},
+    {169, "reboot", nullptr},
+    {170, "sethostname", nullptr},
+    {171, "setdomainname", nullptr},
+    {172, "iopl", nullptr},
+    {173, "ioperm", nullptr},
+    {174, "create_module", nullptr},
+    {175, "init_module", nullptr},
+    {176, "delete_module", nullptr},
+    {177, "get_kernel_syms", nullptr},
+    {178, "query_module", nullptr},
+    {179, "quotactl", nullptr},
+    {180, "nfsservctl", nullptr},
+    {181, "getpmsg", nullptr},
+    {182, "putpmsg", nullptr},
+    {183, "afs_syscall", nullptr},
+    {184, "tuxcall", nullptr},
+    {185, "security", nullptr},
+    {186, "gettid", "d"},
+    {187, "readahead", nullptr},
+    {188, "setxattr", nullptr},
+    {189, "lsetxattr", nullptr},
+    {190, "fsetxattr", nullptr},
+    {191, "getxattr", nullptr},
+    {192, "lgetxattr", nullptr},
+    {193, "fgetxattr", nullptr},
+    {194, "listxattr", nullptr},
+    {195, "llistxattr", nullptr},
+    {196, "flistxattr", nullptr},
+    {197, "removexattr", nullptr},
+    {198, "lremovexattr", nullptr},
+    {199, "fremovexattr", nullptr},
+    {200, "tkill", nullptr},
+    {201, "time", nullptr},
+    {202, "futex", "dxdxxxx"},
+    {203, "sched_setaffinity", "ddux"},
+    {204, "sched_getaffinity", "ddux"},
+    {205, "set_thread_area", nullptr},
+    {206, "io_setup", nullptr},
+    {207, "io_destroy", nullptr},
+    {208, "io_getevents", nullptr},
+    {209, "io_submit", nullptr},
+    {210, "io_cancel", nullptr},
+    {211, "get_thread_area", nullptr},
+    {212, "lookup_dcookie", nullptr},
+    {213, "epoll_create", nullptr},
+    {214, "epoll_ctl_old", nullptr},
+    {215, "epoll_wait_old", nullptr},
+    {216, "remap_file_pages", nullptr},
+    {217, "getdents64", "ddxu"},
+    {218, "set_tid_address", "dx"},
+    {219, "restart_syscall", nullptr},
+    {220, "semtimedop", nullptr},
+    {221, "fadvise64", nullptr},
+    {222, "timer_create", nullptr},
+    {223, "timer_settime", nullptr},
+    {224, "timer_gettime", nullptr},
+    {225, "timer_getoverrun", nullptr},
+    {226, "timer_delete", nullptr},
+    {227, "clock_settime", nullptr},
+    {228, "clock_gettime", "ddx"},
+    {229, "clock_getres", nullptr},
+    {230, "clock_nanosleep", "ddxxx"},
+    {231, "exit_group", "-d"},
+    {232, "epoll_wait", "ddxdd"},
+    {233, "epoll_ctl", "ddddx"},
+    {234, "tgkill", "dddd"},
+    {235, "utimes", nullptr},
+    {236, "vserver", nullptr},
+    {237, "mbind", nullptr},
+    {238, "set_mempolicy", nullptr},
+    {239, "get_mempolicy", nullptr},
+    {240, "mq_open", nullptr},
+    {241, "mq_unlink", nullptr},
+    {242, "mq_timedsend", nullptr},
+    {243, "mq_timedreceive", nullptr},
+    {244, "mq_notify", nullptr},
+    {245, "mq_getsetattr", nullptr},
+    {246, "kexec_load", nullptr},
+    {247, "waitid", nullptr},
+    {248, "add_key", nullptr},
+    {249, "request_key", nullptr},
+    {250, "keyctl", nullptr},
+    {251, "ioprio_set", nullptr},
+    {252, "ioprio_get", nullptr},
+    {253, "inotify_init", nullptr},
+    {254, "inotify_add_watch", nullptr},
+    {255, "inotify_rm_watch", nullptr},
+    {256, "migrate_pages", nullptr},
+    {257, "openat", "dfsxo"},
+    {258, "mkdirat", "dfso"},
+    {259, "mknodat", nullptr},
+    {260, "fchownat", nullptr},
+    {261, "futimesat", nullptr},
+    {262, "newfstatat", "dfsxx"},
+    {263, "unlinkat", "dfsx"},
+    {264, "renameat", "dfsfs"},
+    {265, "linkat", nullptr},
+    {266, "symlinkat", nullptr},
+    {267, "readlinkat", "lfsxu"},
+    {268, "fchmodat", nullptr},
+    {269, "faccessat", "dfsd"},
+    {270, "pselect6", "ddxxxxx"},
+    {271, "ppoll", "dxuxxu"},
+    {272, "unshare", nullptr},
+    {273, "set_robust_list", "dxu"},
+    {274, "get_robust_list", nullptr},
+    {275, "splice", nullptr},
+    {276, "tee", nullptr},
+    {277, "sync_file_range", nullptr},
+    {278, "vmsplice", nullptr},
+    {279, "move_pages", nullptr},
+    {280, "utimensat", nullptr},
+    {281, "epoll_pwait", "ddxddxu"},
+    {282, "signalfd", nullptr},
+    {283, "timerfd_create", "ddx"},
+    {284, "eventfd", nullptr},
+    {285, "fallocate", nullptr},
+    {286, "timerfd_settime", nullptr},
+    {287, "timerfd_gettime", nullptr},
+    {288, "accept4", "ddxxx"},
+    {289, "signalfd4", "ddxux"},
+    {290, "eventfd2", "dux"},
+    {291, "epoll_create1", "dx"},
+    {292, "dup3", "dddx"},
+    {293, "pipe2", "dxx"},
+    {294, "inotify_init1", "dx"},
+    {295, "preadv", nullptr},
+    {296, "pwritev", nullptr},
+    {297, "rt_tgsigqueueinfo", nullptr},
+    {298, "perf_event_open", nullptr},
+    {299, "recvmmsg", nullptr},
+    {300, "fanotify_init", nullptr},
+    {301, "fanotify_mark", nullptr},
+    {302, "prlimit64", "dddxx"},
+    {303, "name_to_handle_at", nullptr},
+    {304, "open_by_handle_at", nullptr},
+    {305, "clock_adjtime", nullptr},
+    {306, "syncfs", nullptr},
+    {307, "sendmmsg", nullptr},
+    {308, "setns", nullptr},
+    {309, "getcpu", nullptr},
+    {310, "process_vm_readv", nullptr},
+    {311, "process_vm_writev", nullptr},
+    {312, "kcmp", nullptr},
+    {313, "finit_module", nullptr},
+    {314, "sched_setattr", nullptr},
+    {315, "sched_getattr", nullptr},
+    {316, "renameat2", nullptr},
+    {317, "seccomp", nullptr},
+    {318, "getrandom", "lxux"},
+    {319, "memfd_create", "dsx"},
+    {320, "kexec_file_load", nullptr},
+    {321, "bpf", nullptr},
+    {322, "execveat", "dfsxxx"},
+    {323, "userfaultfd", nullptr},
+    {324, "membarrier", nullptr},
+    {325, "mlock2", nullptr},
+    {326, "copy_file_range", nullptr},
+    {327, "preadv2", nullptr},
+    {328, "pwritev2", nullptr},
+    {329, "pkey_mprotect", nullptr},
+    {330, "pkey_alloc", nullptr},
+    {331, "pkey_free", nullptr},
+    {332, "statx", "dfsxxx"},
+    {333, "io_pgetevents", nullptr},
+    {334, "rseq", "dxuxx"},
+    {424, "pidfd_send_signal", nullptr},
+    {425, "io_uring_setup", nullptr},
+    {426, "io_uring_enter", nullptr},
+    {427, "io_uring_register", nullptr},
+    {428, "open_tree", nullptr},
+    {429, "move_mount", nullptr},
+    {430, "fsopen", nullptr},
+    {431, "fsconfig", nullptr},
+    {432, "fsmount", nullptr},
+    {433, "fspick", nullptr},
+    {434, "pidfd_open", nullptr},
+    {435, "clone3", "dxu"},
+    {436, "close_range", "duux"},
+    {437, "openat2", "dfsxu"},
+    {438, "pidfd_getfd", nullptr},
+    {439, "faccessat2", "dfsdx"},
+    {440, "process_madvise", nullptr},
+    {441, "epoll_pwait2", nullptr},
+    {442, "mount_setattr", nullptr},
+    {443, "quotactl_fd", nullptr},
+    {444, "landlock_create_ruleset", nullptr},
+    {445, "landlock_add_rule", nullptr},
+    {446, "landlock_restrict_self", nullptr},
+    {447, "memfd_secret", nullptr},
+    {448, "process_mrelease", nullptr},
+    {449, "futex_waitv", nullptr},
+    {450, "set_mempolicy_home_node", nullptr},
+};
+
+static const Syscall* find(long nr) {
+    auto iter = std::lower_bound(std::begin(SYSCALLS), std::end(SYSCALLS), nr,
+                                 [](const Syscall& s, long n) { return s.nr < n; });
+    return iter != std::end(SYSCALLS) && iter->nr == nr ? iter : nullptr;
+}
+
+std::vector<long> SyscallFilter::parse(const std::string& names) {
+    std::set<long> nrs;
+    for (auto& name : Utils::split_by(names, ',')) {
+        if (name.empty()) {
+            continue;
+        }
+        if (std::all_of(name.begin(), name.end(), ::isdigit)) {
+            if (name.size() > 9) {  // Would not fit in a system call number (nor, past 18 digits, in std::stol)
+                throw std::invalid_argument{"Unknown system call " + name};
+            }
+            nrs.insert(std::stol(name));
+            continue;
+        }
+        auto iter = std::find_if(std::begin(SYSCALLS), std::end(SYSCALLS),
+                                 [&](const Syscall& s) { return name == s.name; });
+        if (iter == std::end(SYSCALLS)) {
+            throw std::invalid_argument{"Unknown system call " + name};
+        }
+        nrs.insert(iter->nr);
+    }
+    return {nrs.begin(), nrs.end()};
+}
+
+std::string SyscallFilter::get_name(long nr) {
+    auto syscall = find(nr);
+    return syscall != nullptr ? syscall->name : "syscall_" + std::to_string(nr);
+}
+
+// Load a filter that makes the given system calls stop the (traced) process. No new privileges are needed to
+// install it, which also means a setuid program loses its privileges. The process must be traced with
+// PTRACE_O_TRACESECCOMP, or the system calls fail with ENOSYS
+void SyscallFilter::install(const std::vector<long>& nrs) {
+    std::vector<sock_filter> code {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, arch)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),   // 32-bit system calls are not traced
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, nr)),
+    };
+    for (auto nr : nrs) {
+        code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(nr), 0, 1));
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(SECCOMP_RET_TRACE | (nr & SECCOMP_RET_DATA))));
+    }
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+
+    sock_fprog prog {static_cast<unsigned short>(code.size()), code.data()};
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0 || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) != 0) {
+        perror("Cannot install the system call filter");
+    }
+}
+
+void SyscallFilter::reset(const std::vector<long>& nrs) {
+    _flags.clear();
+    for (auto nr : nrs) {
+        _flags.emplace(nr, Flags{});
+    }
+}
+
+bool SyscallFilter::is_traced(long nr) const {
+    auto iter = _flags.find(nr);
+    return iter != _flags.end() && iter->second.traced;
+}
+
+bool SyscallFilter::is_caught(long nr) const {
+    auto iter = _flags.find(nr);
+    return iter != _flags.end() && iter->second.caught;
+}
+
+void SyscallFilter::set_traced(const std::string& names) {
+    set(names, &Flags::traced);
+}
+
+void SyscallFilter::set_caught(const std::string& names) {
+    set(names, &Flags::caught);
+}
+
+// Set a flag for some system calls of the filter ('all' of them), or clear it for all ('none')
+void SyscallFilter::set(const std::string& names, bool Flags::*flag) {
+    if (names == "all" || names == "none") {
+        for (auto& [nr, flags] : _flags) {
+            flags.*flag = names == "all";
+        }
+        return;
+    }
+    auto nrs = parse(names);
+    for (auto nr : nrs) {
+        if (_flags.count(nr) == 0) {
+            throw std::invalid_argument{get_name(nr) + " is not in the filter installed at launch (start the "
+                                                       "debugger with 'syscalls <names> <program>')"};
+        }
+    }
+    for (auto nr : nrs) {
+        _flags[nr].*flag = true;
+    }
+}
+
+void SyscallFilter::print(std::ostream& out) const {
+    for (auto& [nr, flags] : _flags) {
+        out << std::left << std::setw(24) << get_name(nr) << std::right << (flags.traced ? " traced" : "")
+            << (flags.caught ? " caught" : "") << '\n';
+    }
+}
+
+// Quote a string, escaping what is not printable
+static void print_quoted(const char *data, std::size_t len, std::ostream& out) {
+    out << '"';
+    for (std::size_t i = 0; i < len; i++) {
+        auto c = static_cast<unsigned char>(data[i]);
+        switch (c) {
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            default:
+                if (c >= 0x20 && c < 0x7f) {
+                    out << data[i];
+                } else {
+                    out << "\\x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned>(c)
+                        << std::setfill(' ');
+                }
+        }
+    }
+    out << '"';
+}
+
+// Print an argument. Strings and buffers are read with a single transfer each
+static void print_arg(char kind, uint64_t value, uint64_t next, ProcessMemory& memory, std::ostream& out) {
+    switch (kind) {
+        case 'd':
+            out << std::dec << static_cast<int>(value);
+            return;
+        case 'f':
+            if (static_cast<int>(value) == AT_FDCWD) {
+                out << "AT_FDCWD";
+            } else {
+                out << std::dec << static_cast<int>(value);
+            }
+            return;
+        case 'l':
+            out << std::dec << static_cast<int64_t>(value);
+            return;
+        case 'u':
+            out << std::dec << value;
+            return;
+        case 'o':
+            out << (value != 0 ? "0" : "") << std::oct << value;
+            return;
+        case 's':
+        case 'b':
+        {
+            if (value == 0) {
+                out << "NULL";
+                return;
+            }
+            char buf[MAX_STRING];
+            auto len = memory.read(value, buf, kind == 's' ? sizeof(buf) : std::min(next, MAX_BUFFER));
+            if (len == 0) {
+                out << "0x" << std::hex << value;   // Not mapped
+                return;
+            }
+            auto end = kind == 's' ? static_cast<const char*>(memchr(buf, 0, len)) : nullptr;
+            print_quoted(buf, end != nullptr ? end - buf : len, out);
+            if (kind == 's' ? end == nullptr : next > len) {
+                out << "...";
+            }
+            return;
+        }
+        default:
+            out << "0x" << std::hex << value;
+    }
+}
+
+std::string SyscallFilter::format_call(const user_regs_struct& regs, ProcessMemory& memory) {
+    const uint64_t args[] = {regs.rdi, regs.rsi, regs.rdx, regs.r10, regs.r8, regs.r9, 0};
+    auto nr = static_cast<long>(regs.orig_rax);
+    auto syscall = find(nr);
+    auto kinds = syscall != nullptr && syscall->kinds != nullptr ? syscall->kinds + 1 : "xxxxxx";
+
+    std::ostringstream out;
+    out << get_name(nr) << '(';
+    for (std::size_t i = 0; kinds[i] != '\0'; i++) {
+        if (i > 0) {
+            out << ", ";
+        }
+        print_arg(kinds[i], args[i], args[i + 1], memory, out);
+    }
+    out << ')';
+    return out.str();
+}
+
+std::string SyscallFilter::format_result(long nr, uint64_t result) {
+    auto syscall = find(nr);
+    auto kind = syscall != nullptr && syscall->kinds != nullptr ? syscall->kinds[0] : 'l';
+    auto value = static_cast<int64_t>(result);
+    std::ostringstream out;
+    if (kind == '-') {
+        out << '?';
+    } else if (value <= -512 && value >= -516) {
+        out << "? (interrupted by a signal, restarted after it)";    // ERESTARTSYS and similar, never seen by the program
+    } else if (value < 0 && value >= -4095) {
+        out << "-1 (" << strerror(static_cast<int>(-value)) << ')';  // The error that errno is set to
+    } else if (kind == 'x') {
+        out << "0x" << std::hex << result;
+    } else if (kind == 'o') {
+        out << (result != 0 ? "0" : "") << std::oct << result;
+    } else {
+        out << value;
+    }
+    return out.str();
+}
+
+bool SyscallFilter::returns(long nr) {
+    auto syscall = find(nr);
+    return syscall == nullptr || syscall->kinds == nullptr || syscall->kinds[0] != '-';
+}
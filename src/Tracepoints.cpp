@@ -0,0 +1,684 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include "Tracepoints.h"
+
+constexpr std::size_t JMP_SIZE = 5;         // jmp rel32
+constexpr std::size_t MAX_INSN_SIZE = 15;
+constexpr std::size_t MAX_TRAMPOLINE = 128; // Fixed part (23 bytes) and up to JMP_SIZE relocated instructions
+
+// An instruction, as far as moving it elsewhere is concerned
+struct Insn {
+    enum class Kind : uint8_t {
+        Other,
+        Jump,           // jmp rel8/rel32
+        Call,           // call rel32
+        CondJump,       // jcc rel8/rel32
+        Unsupported,    // loop/jrcxz (rel8 only) and indirect calls (the return address would be in the trampoline)
+    };
+
+    std::size_t length = 0;
+    Kind kind = Kind::Other;
+    std::size_t disp = 0;       // Offset of a RIP-relative displacement (0 if none)
+    std::size_t rel = 0;        // Offset of the target of a relative branch
+    std::size_t rel_size = 0;
+    uint8_t cond = 0;           // Of a jcc
+    bool ends = false;          // Does not fall through to the next instruction (ret, jmp, ud2)
+    bool indirect = false;      // Indirect call or jmp
+};
+
+// Two byte opcodes (0f xx) without a ModRM byte
+static bool no_modrm_0f(uint8_t op) {
+    return op == 0x05 || op == 0x06 || op == 0x07 || op == 0x08 || op == 0x09 || op == 0x0b || op == 0x0e ||
+           (op >= 0x30 && op <= 0x37) || op == 0x77 || op == 0xa0 || op == 0xa1 || op == 0xa2 || op == 0xa8 ||
+           op == 0xa9 || op == 0xaa || (op >= 0xc8 && op <= 0xcf);
+}
+
+// Two byte opcodes (0f xx) with an 8-bit immediate
+static bool imm8_0f(uint8_t op) {
+    return (op >= 0x70 && op <= 0x73) || op == 0xa4 || op == 0xac || op == 0xba || op == 0xc2 ||
+           (op >= 0xc4 && op <= 0xc6);
+}
+
+// Decode the length of an x86-64 instruction, and what in it refers to its address. Returns false for what is
+// not understood (e.g. AVX-512), which is then not patched
+static bool decode(const uint8_t *p, std::size_t avail, Insn& insn) {
+    avail = std::min(avail, MAX_INSN_SIZE);
+    std::size_t i = 0;
+    bool opsize = false, addrsize = false, rex_w = false;
+    while (i < avail && (p[i] == 0xf0 || p[i] == 0xf2 || p[i] == 0xf3 || p[i] == 0x2e || p[i] == 0x36 ||
+                         p[i] == 0x3e || p[i] == 0x26 || p[i] == 0x64 || p[i] == 0x65 || p[i] == 0x66 || p[i] == 0x67)) {
+        opsize |= p[i] == 0x66;
+        addrsize |= p[i] == 0x67;
+        i++;
+    }
+    if (i < avail && (p[i] & 0xf0) == 0x40) {
+        rex_w = (p[i] & 0x08) != 0;
+        i++;
+    }
+    if (i >= avail) {
+        return false;
+    }
+
+    auto op = p[i++];
+    std::size_t imm_z = opsize ? 2 : 4;     // Immediates of the operand size (16 or 32 bits)
+    std::size_t imm = 0;
+    bool modrm = false;
+    auto relative = [&](Insn::Kind kind, std::size_t size) {
+        insn.kind = kind;
+        insn.rel = i;
+        insn.rel_size = size;
+        i += size;
+    };
+
+    if (op == 0x0f) {
+        if (i >= avail) {
+            return false;
+        }
+        auto op2 = p[i++];
+        if (op2 == 0x38) {
+            i++;
+            modrm = true;
+        } else if (op2 == 0x3a) {
+            i++;
+            modrm = true;
+            imm = 1;
+        } else if (op2 >= 0x80 && op2 <= 0x8f) {
+            insn.cond = op2 & 0x0f;
+            relative(Insn::Kind::CondJump, 4);
+        } else if (op2 == 0x0f) {
+            return false;   // 3DNow!
+        } else if (!no_modrm_0f(op2)) {
+            modrm = true;
+            imm = imm8_0f(op2) ? 1 : 0;
+        }
+        insn.ends = op2 == 0x0b;    // ud2
+    } else if (op == 0xc4 || op == 0xc5) {
+        // VEX (there is no LES/LDS in 64-bit mode)
+        unsigned map = 1;
+        if (op == 0xc4) {
+            if (i + 2 > avail) {
+                return false;
+            }
+            map = p[i] & 0x1f;
+            i += 2;
+        } else {
+            i += 1;
+        }
+        if (i >= avail) {
+            return false;
+        }
+        auto vop = p[i++];
+        modrm = !(map == 1 && vop == 0x77);     // vzeroupper/vzeroall
+        imm = map == 3 || (map == 1 && imm8_0f(vop)) ? 1 : 0;
+    } else if (op < 0x40) {
+        // The ALU operations (add, or, adc, sbb, and, sub, xor, cmp) in six forms each
+        switch (op & 7) {
+            case 4: imm = 1; break;
+            case 5: imm = imm_z; break;
+            case 6: case 7: return false;   // Invalid in 64-bit mode (or a prefix, seen above)
+            default: modrm = true;
+        }
+    } else if ((op >= 0x50 && op <= 0x5f) || (op >= 0x90 && op <= 0x99) || (op >= 0x9b && op <= 0x9f)) {
+        // push, pop, xchg, cwd and the like
+    } else if (op >= 0x70 && op <= 0x7f) {
+        insn.cond = op & 0x0f;
+        relative(Insn::Kind::CondJump, 1);
+    } else if (op >= 0x84 && op <= 0x8f) {
+        modrm = true;
+    } else if (op >= 0xb0 && op <= 0xb7) {
+        imm = 1;
+    } else if (op >= 0xb8 && op <= 0xbf) {
+        imm = rex_w ? 8 : imm_z;
+    } else if ((op >= 0xd0 && op <= 0xd3) || (op >= 0xd8 && op <= 0xdf)) {
+        modrm = true;   // Shifts by 1 or cl, and x87
+    } else if (op >= 0xe0 && op <= 0xe3) {
+        relative(Insn::Kind::Unsupported, 1);
+    } else {
+        switch (op) {
+            case 0x63: case 0xfe: case 0xff:
+                modrm = true;
+                break;
+            case 0x69: case 0x81: case 0xc7:
+                modrm = true;
+                imm = imm_z;
+                break;
+            case 0x6b: case 0x80: case 0x83: case 0xc0: case 0xc1: case 0xc6:
+                modrm = true;
+                imm = 1;
+                break;
+            case 0xf6: case 0xf7:
+                modrm = true;   // test has an immediate, the rest (not, neg, mul, div...) do not
+                break;
+            case 0x68: case 0xa9:
+                imm = imm_z;
+                break;
+            case 0x6a: case 0xa8: case 0xcd: case 0xe4: case 0xe5: case 0xe6: case 0xe7:
+                imm = 1;
+                break;
+            case 0xa0: case 0xa1: case 0xa2: case 0xa3:
+                imm = addrsize ? 4 : 8;     // moffs
+                break;
+            case 0xc8:
+                imm = 3;
+                break;
+            case 0xc2: case 0xca:
+                imm = 2;
+                insn.ends = true;
+                break;
+            case 0xc3: case 0xcb: case 0xcc: case 0xcf:
+                insn.ends = true;
+                break;
+            case 0xe8:
+                relative(Insn::Kind::Call, 4);
+                break;
+            case 0xe9:
+                relative(Insn::Kind::Jump, 4);
+                insn.ends = true;
+                break;
+            case 0xeb:
+                relative(Insn::Kind::Jump, 1);
+                insn.ends = true;
+                break;
+            case 0x6c: case 0x6d: case 0x6e: case 0x6f:
+            case 0xa4: case 0xa5: case 0xa6: case 0xa7: case 0xaa: case 0xab: case 0xac: case 0xad: case 0xae: case 0xaf:
+            case 0xc9: case 0xd7: case 0xec: case 0xed: case 0xee: case 0xef:
+            case 0xf1: case 0xf4: case 0xf5: case 0xf8: case 0xf9: case 0xfa: case 0xfb: case 0xfc: case 0xfd:
+                break;
+            default:
+                return false;   // Invalid in 64-bit mode, or EVEX/XOP
+        }
+    }
+
+    if (modrm) {
+        if (i >= avail) {
+            return false;
+        }
+        auto m = p[i++];
+        auto mod = m >> 6, reg = (m >> 3) & 7, rm = m & 7;
+        if (mod != 3) {
+            if (rm == 4) {
+                if (i >= avail) {
+                    return false;
+                }
+                auto base = p[i++] & 7;    // SIB
+                if (mod == 0 && base == 5) {
+                    i += 4;
+                }
+            } else if (mod == 0 && rm == 5) {
+                insn.disp = i;  // [rip + disp32]
+                i += 4;
+            }
+            i += mod == 1 ? 1 : mod == 2 ? 4 : 0;
+        }
+        if ((op == 0xf6 || op == 0xf7) && reg < 2) {
+            imm = op == 0xf6 ? 1 : imm_z;
+        }
+        if (op == 0xff && (reg == 2 || reg == 3)) {
+            insn.kind = Insn::Kind::Unsupported;
+        }
+        insn.indirect = op == 0xff && reg >= 2 && reg <= 5;
+        insn.ends |= op == 0xff && (reg == 4 || reg == 5);  // Indirect jmp
+    }
+    i += imm;
+    insn.length = i;
+    return i <= avail;
+}
+
+// Walk the instructions, following no branch: a call, an indirect branch or a branch out of [low, high) fails
+bool is_local_code(const uint8_t *code, std::size_t len, uint64_t addr, uint64_t low, uint64_t high) {
+    for (std::size_t i = 0; i < len;) {
+        Insn insn;
+        // An int3 hides the instruction it was planted on
+        if (code[i] == 0xcc || !decode(code + i, len - i, insn) || insn.kind == Insn::Kind::Call || insn.indirect) {
+            return false;
+        }
+        if (insn.rel_size != 0) {
+            int64_t rel = insn.rel_size == 1 ? static_cast<int8_t>(code[i + insn.rel]) : 0;
+            if (insn.rel_size == 4) {
+                int32_t rel32;
+                memcpy(&rel32, code + i + insn.rel, sizeof(rel32));
+                rel = rel32;
+            }
+            auto target = addr + i + insn.length + rel;
+            if (target < low || target >= high) {
+                return false;
+            }
+        }
+        i += insn.length;
+    }
+    return true;
+}
+
+static std::string to_hex(uint64_t value) {
+    std::ostringstream out;
+    out << "0x" << std::hex << value;
+    return out.str();
+}
+
+static bool fits_rel32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+static void emit32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// jmp rel32 from the end of out (at address at) to target
+static void emit_jmp(std::vector<uint8_t>& out, uint64_t at, uint64_t target) {
+    out.push_back(0xe9);
+    emit32(out, static_cast<uint32_t>(target - (at + out.size() + 4)));
+}
+
+// Append an instruction, moved from address from to the end of out (at address at, the start of out), with
+// what is relative to its address fixed. Returns false if it cannot be moved
+static bool relocate(const uint8_t *p, const Insn& insn, uint64_t from, uint64_t at, std::vector<uint8_t>& out) {
+    auto to = at + out.size();
+    if (insn.kind == Insn::Kind::Unsupported) {
+        return false;
+    }
+    if (insn.kind == Insn::Kind::Other) {
+        auto start = out.size();
+        out.insert(out.end(), p, p + insn.length);
+        if (insn.disp != 0) {
+            int32_t disp;
+            memcpy(&disp, p + insn.disp, sizeof(disp));
+            auto moved = static_cast<int64_t>(disp) + static_cast<int64_t>(from - to);
+            if (!fits_rel32(moved)) {
+                return false;
+            }
+            auto moved32 = static_cast<int32_t>(moved);
+            memcpy(out.data() + start + insn.disp, &moved32, sizeof(moved32));
+        }
+        return true;
+    }
+
+    // Branches are re-encoded with a rel32 to the same target
+    int64_t rel = insn.rel_size == 1 ? static_cast<int8_t>(p[insn.rel]) : 0;
+    if (insn.rel_size == 4) {
+        int32_t rel32;
+        memcpy(&rel32, p + insn.rel, sizeof(rel32));
+        rel = rel32;
+    }
+    auto target = from + insn.length + rel;
+    switch (insn.kind) {
+        case Insn::Kind::CondJump:
+            out.push_back(0x0f);
+            out.push_back(0x80 | insn.cond);
+            emit32(out, static_cast<uint32_t>(target - (at + out.size() + 4)));
+            break;
+        case Insn::Kind::Call:
+        {
+            // Push the original return address and jump, so the callee returns to the original code
+            auto ret = from + insn.length;
+            const uint8_t push[] = {0x48, 0x8d, 0x64, 0x24, 0xf8,   // lea rsp, [rsp-8] (leaves the flags alone)
+                                    0xc7, 0x04, 0x24};              // mov dword [rsp], imm32
+            out.insert(out.end(), std::begin(push), std::end(push));
+            emit32(out, static_cast<uint32_t>(ret));
+            const uint8_t high[] = {0xc7, 0x44, 0x24, 0x04};        // mov dword [rsp+4], imm32
+            out.insert(out.end(), std::begin(high), std::end(high));
+            emit32(out, static_cast<uint32_t>(ret >> 32));
+            emit_jmp(out, at, target);
+            break;
+        }
+        default:
+            emit_jmp(out, at, target);
+    }
+    return fits_rel32(static_cast<int64_t>(target - (at + out.size())));
+}
+
+std::size_t Tracepoints::get_area_size() {
+    return RING_OFFSET + RING_SIZE * sizeof(Record);
+}
+
+Tracepoints::~Tracepoints() {
+    unmap();
+}
+
+// Start using the area the process mapped: write the common code of the trampolines and start draining
+void Tracepoints::map(int fd, uint64_t remote) {
+    auto area = mmap(nullptr, get_area_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (area == MAP_FAILED) {
+        throw std::invalid_argument{std::string{"Cannot map the tracepoint area: "} + strerror(errno)};
+    }
+    _area = static_cast<uint8_t*>(area);
+    _remote = remote;
+    _code_used = 0;
+    _tail = 0;
+    _dropped = 0;
+    emit_record_fn();
+
+    _stop = false;
+    _drainer = std::thread{[this]() {
+        while (!_stop) {
+            if (drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }};
+}
+
+void Tracepoints::unmap() {
+    if (_area == nullptr) {
+        return;
+    }
+    _stop = true;
+    _drainer.join();
+    munmap(_area, get_area_size());
+    _area = nullptr;
+    _tracepoints.clear();
+    _log.close();
+}
+
+// Whether a jmp can reach the whole area from addr, and back
+bool Tracepoints::in_reach(uint64_t addr) const {
+    return fits_rel32(static_cast<int64_t>(_remote - addr)) &&
+           fits_rel32(static_cast<int64_t>(_remote + get_area_size() - addr));
+}
+
+// Write the routine that every trampoline calls, with the id of its tracepoint pushed, to record the registers
+// into the next slot of the ring. The stack then holds (from rsp up) r15...r8, rbp, rdi, rsi, rdx, rcx, rbx, rax,
+// rflags, the return address, the id, and the red zone the trampoline skipped
+void Tracepoints::emit_record_fn() {
+    std::vector<uint8_t> code;
+    auto at = _remote + CODE_OFFSET;
+    auto emit = [&](std::initializer_list<uint8_t> bytes) { code.insert(code.end(), bytes); };
+    auto rip_rel = [&](uint64_t target) {    // disp32 ending the instruction
+        emit32(code, static_cast<uint32_t>(target - (at + code.size() + 4)));
+    };
+
+    emit({0x9c});                                                   // pushfq
+    emit({0x50, 0x53, 0x51, 0x52, 0x56, 0x57, 0x55});               // push rax, rbx, rcx, rdx, rsi, rdi, rbp
+    emit({0x41, 0x50, 0x41, 0x51, 0x41, 0x52, 0x41, 0x53,           // push r8...r15
+          0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});
+
+    // Reserve a slot: rcx = index, rsi = record
+    emit({0xb8, 0x01, 0x00, 0x00, 0x00});                           // mov eax, 1
+    emit({0xf0, 0x48, 0x0f, 0xc1, 0x05});                           // lock xadd [rip + head], rax
+    rip_rel(_remote);
+    emit({0x48, 0x89, 0xc1});                                       // mov rcx, rax
+    emit({0x48, 0x25});                                             // and rax, RING_SIZE - 1
+    emit32(code, RING_SIZE - 1);
+    emit({0x48, 0x69, 0xc0});                                       // imul rax, rax, sizeof(Record)
+    emit32(code, sizeof(Record));
+    emit({0x48, 0x8d, 0x35});                                       // lea rsi, [rip + ring]
+    rip_rel(_remote + RING_OFFSET);
+    emit({0x48, 0x01, 0xc6});                                       // add rsi, rax
+    emit({0x48, 0xc7, 0x06, 0x00, 0x00, 0x00, 0x00});               // mov qword [rsi], 0 (being written)
+
+    emit({0x0f, 0x31});                                             // rdtsc
+    emit({0x48, 0xc1, 0xe2, 0x20});                                 // shl rdx, 32
+    emit({0x48, 0x09, 0xd0});                                       // or rax, rdx
+    emit({0x48, 0x89, 0x46, offsetof(Record, tsc)});                // mov [rsi + tsc], rax
+
+    // Copy from the stack: mov rax, [rsp + from]; mov [rsi + to], rax
+    auto copy = [&](uint32_t from, uint32_t to) {
+        if (from < 0x80) {
+            emit({0x48, 0x8b, 0x44, 0x24, static_cast<uint8_t>(from)});
+        } else {
+            emit({0x48, 0x8b, 0x84, 0x24});
+            emit32(code, from);
+        }
+        if (to < 0x80) {
+            emit({0x48, 0x89, 0x46, static_cast<uint8_t>(to)});
+        } else {
+            emit({0x48, 0x89, 0x86});
+            emit32(code, to);
+        }
+    };
+    const uint32_t saved[] = {offsetof(Record, r15), offsetof(Record, r14), offsetof(Record, r13),
+                              offsetof(Record, r12), offsetof(Record, r11), offsetof(Record, r10),
+                              offsetof(Record, r9), offsetof(Record, r8), offsetof(Record, rbp),
+                              offsetof(Record, rdi), offsetof(Record, rsi), offsetof(Record, rdx),
+                              offsetof(Record, rcx), offsetof(Record, rbx), offsetof(Record, rax),
+                              offsetof(Record, rflags)};
+    for (uint32_t i = 0; i < std::size(saved); i++) {
+        copy(i * 8, saved[i]);
+    }
+    copy(std::size(saved) * 8 + 8, offsetof(Record, id));
+    constexpr uint32_t entry_rsp = (std::size(saved) + 2) * 8 + 128;   // Before the trampoline moved it
+    emit({0x48, 0x8d, 0x84, 0x24});                                 // lea rax, [rsp + entry_rsp]
+    emit32(code, entry_rsp);
+    emit({0x48, 0x89, 0x46, offsetof(Record, rsp)});                // mov [rsi + rsp], rax
+
+    emit({0x48, 0xff, 0xc1});                                       // inc rcx
+    emit({0x48, 0x89, 0x0e});                                       // mov [rsi], rcx (complete)
+
+    emit({0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c,           // pop r15...r8
+          0x41, 0x5b, 0x41, 0x5a, 0x41, 0x59, 0x41, 0x58});
+    emit({0x5d, 0x5f, 0x5e, 0x5a, 0x59, 0x5b, 0x58});               // pop rbp, rdi, rsi, rdx, rcx, rbx, rax
+    emit({0x9d});                                                   // popfq
+    emit({0xc3});                                                   // ret
+
+    memcpy(_area + CODE_OFFSET, code.data(), code.size());
+    _record_fn = at;
+    _code_used = (code.size() + 15) & ~static_cast<std::size_t>(15);
+}
+
+// COMMAND: Replace the instructions at addr with a jmp to a new trampoline:
+//   lea rsp, [rsp-128]; push id; call record; lea rsp, [rsp+136]; <the instructions>; jmp addr+len
+// Enough whole instructions are replaced to make room for the jmp, and the bytes left over are filled with int3.
+// Code that jumps into the middle of them (rather than to addr) would break, which the caller cannot always rule out
+unsigned Tracepoints::add(uint64_t addr, ProcessMemory& memory, const std::function<void(uint64_t, std::size_t)>& check) {
+    if (!in_reach(addr)) {
+        throw std::out_of_range{"The tracepoint area is out of reach of a jump from there"};
+    }
+    uint8_t code[JMP_SIZE + MAX_INSN_SIZE];
+    auto avail = memory.read(addr, code, sizeof(code));
+
+    // Whole instructions, until there is room for the jmp
+    std::vector<Insn> insns;
+    std::size_t len = 0;
+    while (len < JMP_SIZE) {
+        Insn insn;
+        if (!decode(code + len, avail - len, insn)) {
+            throw std::invalid_argument{"Cannot decode the instruction at " + to_hex(addr + len)};
+        }
+        if ((insn.ends || insn.kind == Insn::Kind::Call) && len + insn.length < JMP_SIZE) {
+            // Nothing is known to follow a jmp or ret, and a call would return into the middle of the patch
+            throw std::invalid_argument{"Too short a block to patch a jump over (it calls or branches away first)"};
+        }
+        insns.push_back(insn);
+        len += insn.length;
+    }
+    check(addr, len);
+    std::lock_guard<std::mutex> guard {_lock};
+    for (auto& [id, tp] : _tracepoints) {
+        if (addr < tp.addr + tp.saved.size() && tp.addr < addr + len) {
+            throw std::invalid_argument{"Overlaps tracepoint " + std::to_string(id)};
+        }
+    }
+    if (_code_used + MAX_TRAMPOLINE > CODE_SIZE) {
+        throw std::out_of_range{"No room left for another tracepoint"};
+    }
+
+    auto id = _next_id;
+    auto at = _remote + CODE_OFFSET + _code_used;
+    std::vector<uint8_t> trampoline {0x48, 0x8d, 0x64, 0x24, 0x80,  // lea rsp, [rsp-128] (skip the red zone)
+                                     0x68};                         // push id
+    emit32(trampoline, id);
+    trampoline.push_back(0xe8);                                     // call record
+    emit32(trampoline, static_cast<uint32_t>(_record_fn - (at + trampoline.size() + 4)));
+    const uint8_t restore[] = {0x48, 0x8d, 0xa4, 0x24, 0x88, 0x00, 0x00, 0x00};    // lea rsp, [rsp+136]
+    trampoline.insert(trampoline.end(), std::begin(restore), std::end(restore));
+    std::size_t offset = 0;
+    for (auto& insn : insns) {
+        auto target = insn.rel_size != 0 ? addr + offset + insn.length : 0;
+        if (!relocate(code + offset, insn, addr + offset, at, trampoline)) {
+            throw std::invalid_argument{"Cannot move the instruction at " + to_hex(addr + offset)};
+        }
+        // A branch back into the replaced instructions would land in the middle of the jmp
+        if (insn.rel_size != 0) {
+            int64_t rel = insn.rel_size == 1 ? static_cast<int8_t>(code[offset + insn.rel]) : 0;
+            if (insn.rel_size == 4) {
+                int32_t rel32;
+                memcpy(&rel32, code + offset + insn.rel, sizeof(rel32));
+                rel = rel32;
+            }
+            if (target + rel > addr && target + rel < addr + len) {
+                throw std::invalid_argument{"A branch at " + to_hex(addr + offset) + " jumps into the patch"};
+            }
+        }
+        offset += insn.length;
+    }
+    if (!insns.back().ends) {
+        emit_jmp(trampoline, at, addr + len);
+    }
+    memcpy(_area + CODE_OFFSET + _code_used, trampoline.data(), trampoline.size());
+    _code_used += (trampoline.size() + 15) & ~static_cast<std::size_t>(15);
+
+    Tracepoint tp {addr, at, std::vector<uint8_t>(code, code + len)};
+    write_jump(tp, memory);
+    _tracepoints.emplace(id, std::move(tp));
+    _next_id++;
+    return id;
+}
+
+void Tracepoints::write_jump(const Tracepoint& tp, ProcessMemory& memory) {
+    std::vector<uint8_t> patch;
+    emit_jmp(patch, tp.addr, tp.trampoline);
+    patch.resize(tp.saved.size(), 0xcc);
+    memory.write_forced(tp.addr, patch.data(), patch.size());
+}
+
+// COMMAND: Put the instructions back. The trampoline is kept, as a thread may be running it
+void Tracepoints::remove(unsigned id, ProcessMemory& memory) {
+    std::lock_guard<std::mutex> guard {_lock};
+    auto iter = _tracepoints.find(id);
+    if (iter == _tracepoints.end()) {
+        throw std::out_of_range{"No tracepoint " + std::to_string(id)};
+    }
+    memory.write_forced(iter->second.addr, iter->second.saved.data(), iter->second.saved.size());
+    _tracepoints.erase(iter);
+}
+
+void Tracepoints::remove_all(ProcessMemory& memory) {
+    std::lock_guard<std::mutex> guard {_lock};
+    for (auto& [id, tp] : _tracepoints) {
+        memory.write_forced(tp.addr, tp.saved.data(), tp.saved.size());
+    }
+    _tracepoints.clear();
+}
+
+void Tracepoints::reinsert(ProcessMemory& memory) {
+    std::lock_guard<std::mutex> guard {_lock};
+    for (auto& [id, tp] : _tracepoints) {
+        write_jump(tp, memory);
+    }
+}
+
+// Whether addr is within the instructions replaced by a tracepoint
+bool Tracepoints::overlaps(uint64_t addr) const {
+    for (auto& [id, tp] : _tracepoints) {
+        if (addr >= tp.addr && addr < tp.addr + tp.saved.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Read the records written since the last call. A record is complete once its seq is set; one being written stops
+// the reading there until the next call, unless writers have gone a whole ring further since
+std::size_t Tracepoints::drain() {
+    auto head_ptr = reinterpret_cast<uint64_t*>(_area);
+    auto ring = reinterpret_cast<Record*>(_area + RING_OFFSET);
+    std::lock_guard<std::mutex> guard {_lock};
+    auto head = __atomic_load_n(head_ptr, __ATOMIC_ACQUIRE);
+    std::size_t count = 0;
+    while (_tail < head) {
+        if (head - _tail > RING_SIZE) {
+            _dropped += head - _tail - RING_SIZE;   // Overwritten before we got to them
+            _tail = head - RING_SIZE;
+        }
+        auto& slot = ring[_tail & (RING_SIZE - 1)];
+        auto seq = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+        if (seq < _tail + 1) {
+            break;
+        }
+        Record record;
+        memcpy(&record, &slot, sizeof(record));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        // Taken by a writer one lap ahead, before or while we copied it
+        if (seq != _tail + 1 || __atomic_load_n(&slot.seq, __ATOMIC_RELAXED) != seq) {
+            _dropped++;
+        } else {
+            deliver(record);
+            count++;
+        }
+        _tail++;
+    }
+    return count;
+}
+
+static void print_record(const Tracepoints::Record& r, std::ostream& out) {
+    out << "tsc=" << std::dec << r.tsc << std::hex << " rax=0x" << r.rax << " rbx=0x" << r.rbx << " rcx=0x" << r.rcx
+        << " rdx=0x" << r.rdx << " rsi=0x" << r.rsi << " rdi=0x" << r.rdi << " rbp=0x" << r.rbp << " rsp=0x" << r.rsp
+        << " r8=0x" << r.r8 << " r9=0x" << r.r9 << " r10=0x" << r.r10 << " r11=0x" << r.r11 << " r12=0x" << r.r12
+        << " r13=0x" << r.r13 << " r14=0x" << r.r14 << " r15=0x" << r.r15 << " rflags=0x" << r.rflags << '\n';
+}
+
+// Account for a record (of a tracepoint that may have been removed since)
+void Tracepoints::deliver(const Record& record) {
+    auto iter = _tracepoints.find(static_cast<unsigned>(record.id));
+    if (iter == _tracepoints.end()) {
+        return;
+    }
+    auto& tp = iter->second;
+    tp.hits++;
+    tp.recent.push_back(record);
+    if (tp.recent.size() > MAX_RECENT) {
+        tp.recent.pop_front();
+    }
+    if (_log.is_open()) {
+        _log << std::dec << record.id << ' ';
+        print_record(record, _log);
+    }
+}
+
+// COMMAND: List the tracepoints, with their hits so far
+void Tracepoints::print(std::ostream& out, uint64_t load_addr) {
+    std::lock_guard<std::mutex> guard {_lock};
+    for (auto& [id, tp] : _tracepoints) {
+        out << std::dec << id << ": 0x" << std::hex << tp.addr - load_addr << ", " << std::dec << tp.hits << " hits ("
+            << tp.saved.size() << " bytes replaced)\n";
+    }
+    if (_dropped != 0) {
+        out << _dropped << " records dropped (written faster than they were read)\n";
+    }
+}
+
+// COMMAND: Print the registers of the last hits of a tracepoint
+void Tracepoints::print_records(unsigned id, std::ostream& out) {
+    std::lock_guard<std::mutex> guard {_lock};
+    auto iter = _tracepoints.find(id);
+    if (iter == _tracepoints.end()) {
+        throw std::out_of_range{"No tracepoint " + std::to_string(id)};
+    }
+    for (auto& record : iter->second.recent) {
+        print_record(record, out);
+    }
+}
+
+void Tracepoints::set_log(const std::string& path) {
+    std::lock_guard<std::mutex> guard {_lock};
+    _log.close();
+    if (!path.empty()) {
+        _log.open(path);
+        if (!_log) {
+            throw std::invalid_argument{"Cannot open " + path};
+        }
+    }
+}
@@ -0,0 +1,240 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include "TypeCache.h"
+
+using dwarf::DW_AT;
+using dwarf::DW_TAG;
+
+const TypeLayout& TypeLayout::resolve() const {
+    auto type = this;
+    while (type->kind == Kind::Alias && type->target != nullptr) {
+        type = type->target;
+    }
+    return *type;
+}
+
+// Find a member, adding its offset to base (members of anonymous structs and unions are reached as if they were
+// members of the enclosing one, so their offset is the sum of both)
+const TypeLayout::Member* TypeLayout::find_member(const std::string& member_name, uint64_t& base) const {
+    for (auto& member : members) {
+        if (member.name == member_name) {
+            base += member.offset;
+            return &member;
+        }
+    }
+    for (auto& member : members) {
+        if (member.name.empty() && member.type->resolve().kind == Kind::Struct) {
+            auto inner_base = base + member.offset;
+            auto inner = member.type->resolve().find_member(member_name, inner_base);
+            if (inner != nullptr) {
+                base = inner_base;
+                return inner;
+            }
+        }
+    }
+    return nullptr;
+}
+
+static uint64_t get_unsigned(const dwarf::die& d, DW_AT attr, uint64_t otherwise = 0) {
+    if (!d.has(attr)) {
+        return otherwise;
+    }
+    auto val = d[attr];
+    return val.get_type() == dwarf::value::type::sconstant ? static_cast<uint64_t>(val.as_sconstant())
+                                                           : val.as_uconstant();
+}
+
+// Number of elements described by a DW_TAG_subrange_type (0 if unknown)
+static uint64_t get_count(const dwarf::die& subrange) {
+    if (subrange.has(DW_AT::count)) {
+        return get_unsigned(subrange, DW_AT::count);
+    }
+    if (subrange.has(DW_AT::upper_bound)) {
+        auto val = subrange[DW_AT::upper_bound];
+        if (val.get_type() == dwarf::value::type::sconstant) {
+            return val.as_sconstant() < 0 ? 0 : val.as_sconstant() + 1;
+        }
+        if (val.get_type() == dwarf::value::type::constant || val.get_type() == dwarf::value::type::uconstant) {
+            return val.as_uconstant() + 1;
+        }
+    }
+    return 0;   // e.g. a flexible array member, or a variable length array
+}
+
+static TypeLayout::Encoding get_encoding(const dwarf::die& type) {
+    switch (static_cast<dwarf::DW_ATE>(get_unsigned(type, DW_AT::encoding))) {
+        case dwarf::DW_ATE::boolean:
+            return TypeLayout::Encoding::Bool;
+        case dwarf::DW_ATE::float_:
+            return TypeLayout::Encoding::Float;
+        case dwarf::DW_ATE::signed_char:
+            return TypeLayout::Encoding::SignedChar;
+        case dwarf::DW_ATE::unsigned_char:
+            return TypeLayout::Encoding::UnsignedChar;
+        case dwarf::DW_ATE::unsigned_:
+        case dwarf::DW_ATE::address:
+        case dwarf::DW_ATE::UTF:
+            return TypeLayout::Encoding::Unsigned;
+        default:
+            return TypeLayout::Encoding::Signed;
+    }
+}
+
+// Get the layout of a type DIE, decoding it (and the types it refers to) on first use
+const TypeLayout& TypeCache::get(const dwarf::die& type) {
+    auto offset = type.get_section_offset();
+    auto iter = _by_offset.find(offset);
+    if (iter != _by_offset.end()) {
+        return *iter->second;
+    }
+    // Registered before decoding, so types that refer back to themselves find it
+    auto& layout = _layouts.emplace_back();
+    _by_offset.emplace(offset, &layout);
+    decode(type, layout);
+    return layout;
+}
+
+const TypeLayout& TypeCache::get_void() {
+    static const TypeLayout void_layout {TypeLayout::Kind::Void, TypeLayout::Encoding::Signed, "void"};
+    return void_layout;
+}
+
+void TypeCache::decode(const dwarf::die& type, TypeLayout& layout) {
+    auto target = [&]() -> const TypeLayout& {
+        return type.has(DW_AT::type) ? get(dwarf::at_type(type)) : get_void();
+    };
+    auto name = type.has(DW_AT::name) ? dwarf::at_name(type) : std::string{};
+    layout.size = get_unsigned(type, DW_AT::byte_size);
+
+    switch (type.tag) {
+        case DW_TAG::base_type:
+            layout.kind = TypeLayout::Kind::Base;
+            layout.encoding = get_encoding(type);
+            layout.name = name;
+            break;
+        case DW_TAG::enumeration_type:
+            layout.kind = TypeLayout::Kind::Enum;
+            layout.name = "enum " + name;
+            for (auto& child : type) {
+                if (child.tag == DW_TAG::enumerator) {
+                    auto val = child[DW_AT::const_value];
+                    auto value = val.get_type() == dwarf::value::type::sconstant ? val.as_sconstant()
+                                                                                : static_cast<int64_t>(val.as_uconstant());
+                    layout.enumerators.emplace_back(value, dwarf::at_name(child));
+                }
+            }
+            break;
+        case DW_TAG::pointer_type:
+        case DW_TAG::reference_type:
+        case DW_TAG::rvalue_reference_type:
+            layout.kind = TypeLayout::Kind::Pointer;
+            layout.size = get_unsigned(type, DW_AT::byte_size, sizeof(uint64_t));
+            layout.target = &target();
+            layout.name = layout.target->name + (type.tag == DW_TAG::pointer_type ? " *" : " &");
+            break;
+        case DW_TAG::structure_type:
+        case DW_TAG::class_type:
+        case DW_TAG::union_type:
+            layout.kind = TypeLayout::Kind::Struct;
+            layout.name = (type.tag == DW_TAG::union_type ? "union " : type.tag == DW_TAG::class_type ? "class " : "struct ")
+                          + name;
+            for (auto& child : type) {
+                if (child.tag != DW_TAG::member || child.has(DW_AT::declaration)) {
+                    continue;   // Static members are declared here but live elsewhere
+                }
+                TypeLayout::Member member;
+                member.name = child.has(DW_AT::name) ? dwarf::at_name(child) : std::string{};
+                member.type = child.has(DW_AT::type) ? &get(dwarf::at_type(child)) : &get_void();
+                member.offset = 0;      // Union members have no location
+                if (child.has(DW_AT::data_member_location)) {
+                    auto val = child[DW_AT::data_member_location];
+                    if (val.get_type() == dwarf::value::type::exprloc || val.get_type() == dwarf::value::type::block) {
+                        // Older producers give the offset as an expression (DW_OP_plus_uconst n) on the object address
+                        member.offset = val.as_exprloc().evaluate(&dwarf::no_expr_context, 0).value;
+                    } else {
+                        member.offset = get_unsigned(child, DW_AT::data_member_location);
+                    }
+                }
+                member.bit_size = get_unsigned(child, DW_AT::bit_size);
+                if (child.has(DW_AT::data_bit_offset)) {
+                    auto bits = get_unsigned(child, DW_AT::data_bit_offset);
+                    member.offset = bits / 8;
+                    member.bit_offset = bits % 8;
+                } else if (child.has(DW_AT::bit_offset)) {
+                    // DWARF 2/3 count from the most significant bit of a storage unit of byte_size bytes
+                    auto unit_bits = get_unsigned(child, DW_AT::byte_size, member.type->resolve().size) * 8;
+                    member.bit_offset = unit_bits - get_unsigned(child, DW_AT::bit_offset) - member.bit_size;
+                }
+                layout.members.push_back(std::move(member));
+            }
+            break;
+        case DW_TAG::array_type:
+        {
+            auto& element = target();
+            std::vector<dwarf::die> dims;
+            for (auto& child : type) {
+                if (child.tag == DW_TAG::subrange_type) {
+                    dims.push_back(child);
+                }
+            }
+            if (dims.empty()) {
+                dims.push_back(dwarf::die{});
+            }
+            // int a[2][3] is an array of 2 arrays of 3 ints, the inner array having no DIE of its own
+            auto& inner = decode_array(type, element, dims.begin() + 1, dims.end());
+            layout.kind = TypeLayout::Kind::Array;
+            layout.target = &inner;
+            layout.count = dims[0].valid() ? get_count(dims[0]) : 0;
+            layout.stride = get_unsigned(type, DW_AT::byte_stride, inner.resolve().size);
+            layout.size = layout.count * layout.stride;
+            layout.name = element.name + " [" + std::to_string(layout.count) + "]" +
+                          (&inner != &element ? inner.name.substr(element.name.size() + 1) : "");
+            break;
+        }
+        case DW_TAG::subroutine_type:
+            layout.kind = TypeLayout::Kind::Function;
+            layout.target = &target();
+            layout.name = layout.target->name + " ()";
+            break;
+        case DW_TAG::typedef_:
+            layout.kind = TypeLayout::Kind::Alias;
+            layout.target = &target();
+            layout.name = name;
+            layout.size = layout.target->resolve().size;
+            break;
+        case DW_TAG::const_type:
+        case DW_TAG::volatile_type:
+        case DW_TAG::restrict_type:
+            layout.kind = TypeLayout::Kind::Alias;
+            layout.target = &target();
+            layout.name = (type.tag == DW_TAG::const_type ? "const " : type.tag == DW_TAG::volatile_type ? "volatile " : "")
+                          + layout.target->name;
+            layout.size = layout.target->resolve().size;
+            break;
+        default:
+            layout.kind = TypeLayout::Kind::Void;
+            layout.name = name.empty() ? "?" : name;
+            break;
+    }
+}
+
+// Layout of the inner dimensions [dim, end) of a multidimensional array (the element itself when there are none)
+const TypeLayout& TypeCache::decode_array(const dwarf::die& type, const TypeLayout& element,
+                                          std::vector<dwarf::die>::const_iterator dim,
+                                          std::vector<dwarf::die>::const_iterator end) {
+    if (dim == end) {
+        return element;
+    }
+    auto& inner = decode_array(type, element, dim + 1, end);
+    auto& layout = _layouts.emplace_back();
+    layout.kind = TypeLayout::Kind::Array;
+    layout.target = &inner;
+    layout.count = get_count(*dim);
+    layout.stride = inner.resolve().size;
+    layout.size = layout.count * layout.stride;
+    layout.name = element.name + " [" + std::to_string(layout.count) + "]" +
+                  (&inner != &element ? inner.name.substr(element.name.size() + 1) : "");
+    return layout;
+}
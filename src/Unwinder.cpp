@@ -0,0 +1,540 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include "Unwinder.h"
+#include "Registers.h"
+
+constexpr std::size_t RSP = 7;
+constexpr std::size_t RBP = 6;
+constexpr std::size_t RA = 16;
+
+template <typename T>
+static T read_value(const uint8_t *&p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+static uint64_t read_uleb(const uint8_t *&p) {
+    uint64_t value = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = *p++;
+        if (shift < 64) value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+static int64_t read_sleb(const uint8_t *&p) {
+    int64_t value = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = *p++;
+        if (shift < 64) value |= static_cast<int64_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    if (shift < 64 && (byte & 0x40)) {
+        value |= -(static_cast<int64_t>(1) << shift);
+    }
+    return value;
+}
+
+// Read a pointer in a DW_EH_PE encoding (only absolute and pc-relative values occur in executables)
+static uint64_t read_encoded(const uint8_t *&p, uint8_t encoding, const uint8_t *section_start, uint64_t section_addr) {
+    if (encoding == 0xff) {     // DW_EH_PE_omit
+        return 0;
+    }
+    uint64_t base = (encoding & 0x70) == 0x10 ? section_addr + (p - section_start) : 0;   // DW_EH_PE_pcrel
+    uint64_t value;
+    switch (encoding & 0x0f) {
+        case 0x01: value = read_uleb(p); break;
+        case 0x02: value = read_value<uint16_t>(p); break;
+        case 0x03: value = read_value<uint32_t>(p); break;
+        case 0x09: value = read_sleb(p); break;
+        case 0x0a: value = read_value<int16_t>(p); break;
+        case 0x0b: value = read_value<int32_t>(p); break;
+        default: value = read_value<uint64_t>(p); break;   // DW_EH_PE_absptr, udata8, sdata8
+    }
+    return base + value;
+}
+
+
+// Copy len bytes of stack from sp (fewer if the stack mapping ends first)
+void StackSnapshot::read(ProcessMemory& memory, uint64_t sp, std::size_t len) {
+    _memory = &memory;
+    _base = sp;
+    if (_data.size() < len) {
+        _data.resize(len);
+    }
+    _size = memory.read(sp, _data.data(), len);
+}
+
+bool StackSnapshot::read_word(uint64_t addr, uint64_t& value) const {
+    if (addr >= _base && addr - _base + sizeof(value) <= _size) {
+        std::memcpy(&value, &_data[addr - _base], sizeof(value));
+        return true;
+    }
+    return _memory != nullptr && _memory->read(addr, &value, sizeof(value)) == sizeof(value);
+}
+
+
+// Index the FDEs of .eh_frame and .debug_frame, preferring .eh_frame where both describe a function
+void Unwinder::build(const elf::elf& elf) {
+    _cies.clear();
+    _fdes.clear();
+    for (auto& section : elf.sections()) {
+        if (section.get_name() == ".eh_frame") {
+            parse_section(section, true);
+        }
+    }
+    auto num_eh_fdes = _fdes.size();
+    for (auto& section : elf.sections()) {
+        if (section.get_name() == ".debug_frame") {
+            parse_section(section, false);
+        }
+    }
+
+    std::stable_sort(_fdes.begin(), _fdes.end(), [](const Fde& a, const Fde& b) { return a.low < b.low; });
+    if (num_eh_fdes != _fdes.size()) {
+        _fdes.erase(std::unique(_fdes.begin(), _fdes.end(),
+                                [](const Fde& a, const Fde& b) { return a.low == b.low; }), _fdes.end());
+    }
+}
+
+// Walk the CIE and FDE records of a frame section. Both formats share the layout, but .eh_frame marks CIEs with
+// id 0 and points FDEs to their CIE relative to the pointer itself
+void Unwinder::parse_section(const elf::section& section, bool eh_frame) {
+    auto start = static_cast<const uint8_t *>(section.data());
+    auto end = start + section.size();
+    auto addr = section.get_hdr().addr;
+    std::unordered_map<const uint8_t *, uint32_t> cies;
+
+    for (auto p = start; p + 4 <= end;) {
+        auto entry = p;
+        uint64_t len = read_value<uint32_t>(p);
+        if (len == 0) {
+            if (eh_frame) break;    // Terminator
+            continue;
+        }
+        bool is64 = len == 0xffffffff;
+        if (is64) {
+            len = read_value<uint64_t>(p);
+        }
+        auto next = p + len;
+        if (next > end) {
+            break;
+        }
+
+        auto id_pos = p;
+        uint64_t id = is64 ? read_value<uint64_t>(p) : read_value<uint32_t>(p);
+        bool is_cie = eh_frame ? id == 0 : id == (is64 ? UINT64_MAX : 0xffffffff);
+        if (is_cie) {
+            if (cies.count(entry) == 0) {
+                cies[entry] = parse_cie(entry, start, addr, eh_frame);
+            }
+            p = next;
+            continue;
+        }
+
+        auto cie_entry = eh_frame ? id_pos - id : start + id;
+        if (cie_entry < start || cie_entry >= end) {
+            p = next;
+            continue;
+        }
+        auto iter = cies.find(cie_entry);
+        if (iter == cies.end()) {
+            iter = cies.emplace(cie_entry, parse_cie(cie_entry, start, addr, eh_frame)).first;
+        }
+        auto& cie = _cies[iter->second];
+        if (cie.usable) {
+            auto low = read_encoded(p, cie.fde_encoding, start, addr);
+            auto range = read_encoded(p, cie.fde_encoding & 0x0f, start, addr);     // Never relative
+            if (cie.has_augmentation_data) {
+                auto aug_len = read_uleb(p);
+                p += aug_len;
+            }
+            if (range != 0) {
+                _fdes.push_back(Fde{low, low + range, iter->second, p, next});
+            }
+        }
+        p = next;
+    }
+}
+
+// Parse the CIE at entry, returning its index
+uint32_t Unwinder::parse_cie(const uint8_t *entry, const uint8_t *section_start, uint64_t section_addr, bool eh_frame) {
+    Cie cie;
+    auto p = entry;
+    uint64_t len = read_value<uint32_t>(p);
+    bool is64 = len == 0xffffffff;
+    if (is64) {
+        len = read_value<uint64_t>(p);
+    }
+    cie.end = p + len;
+    p += is64 ? 8 : 4;  // CIE id
+
+    auto version = *p++;
+    auto augmentation = reinterpret_cast<const char *>(p);
+    p += std::strlen(augmentation) + 1;
+    if (!eh_frame && version >= 4) {
+        p += 2;     // Address and segment selector sizes
+    }
+    cie.code_align = read_uleb(p);
+    cie.data_align = read_sleb(p);
+    cie.ra_reg = version == 1 ? *p++ : read_uleb(p);
+
+    if (augmentation[0] == 'z') {
+        cie.has_augmentation_data = true;
+        auto aug_len = read_uleb(p);
+        auto aug_end = p + aug_len;
+        for (auto c = augmentation + 1; *c != '\0'; c++) {
+            if (*c == 'R') {
+                cie.fde_encoding = *p++;
+            } else if (*c == 'P') {
+                auto encoding = *p++;
+                read_encoded(p, encoding, section_start, section_addr);    // Personality routine
+            } else if (*c == 'L') {
+                p++;    // LSDA encoding
+            } else if (*c != 'S') {
+                break;  // Unknown, but the length lets us skip the rest
+            }
+        }
+        p = aug_end;
+    } else if (augmentation[0] != '\0') {
+        cie.usable = false;
+    }
+
+    cie.instructions = p;
+    _cies.push_back(cie);
+    return static_cast<uint32_t>(_cies.size() - 1);
+}
+
+// Find the row of rules in effect at a (relative) PC
+const Unwinder::Row* Unwinder::find_row(uint64_t pc) const {
+    auto fde = std::upper_bound(_fdes.begin(), _fdes.end(), pc, [](uint64_t pc, const Fde& f) { return pc < f.low; });
+    if (fde == _fdes.begin() || pc >= (--fde)->high) {
+        return nullptr;
+    }
+    if (!fde->decoded) {
+        decode(*fde);
+    }
+    auto row = std::upper_bound(fde->rows.begin(), fde->rows.end(), pc,
+                                [](uint64_t pc, const Row& r) { return pc < r.loc; });
+    return row == fde->rows.begin() ? nullptr : &*(row - 1);
+}
+
+// Run the CIE's initial instructions and then the FDE's, recording a row at every location advance
+void Unwinder::decode(const Fde& fde) const {
+    auto& cie = _cies[fde.cie];
+    Row row{};
+    // Callee-saved registers keep their value unless a rule says otherwise
+    for (auto reg : {3, 6, 12, 13, 14, 15}) {
+        row.regs[reg].type = RuleType::SameValue;
+    }
+    execute(cie.instructions, cie.end, cie, row, row, nullptr);
+    auto initial = row;
+
+    row.loc = fde.low;
+    execute(fde.instructions, fde.end, cie, row, initial, &fde.rows);
+    fde.rows.push_back(row);
+    fde.rows.shrink_to_fit();
+    fde.decoded = true;
+}
+
+// Execute DW_CFA instructions on a row. Rows are only recorded for FDE instructions (rows is null for the CIE)
+void Unwinder::execute(const uint8_t *p, const uint8_t *end, const Cie& cie, Row& row, const Row& initial,
+                       std::vector<Row> *rows) const {
+    std::vector<Row> state_stack;
+    auto advance = [&](uint64_t delta) {
+        if (rows != nullptr) {
+            rows->push_back(row);
+        }
+        row.loc += delta * cie.code_align;
+    };
+    auto set_rule = [&](uint64_t reg, RuleType type, int64_t offset = 0, uint16_t other = 0) {
+        if (reg < NUM_UNWIND_REGS) {
+            row.regs[reg] = Rule{type, other, offset};
+        }
+    };
+    auto set_expr = [&](uint64_t reg, RuleType type) {
+        auto len = read_uleb(p);
+        if (reg < NUM_UNWIND_REGS) {
+            row.regs[reg] = Rule{type, 0, 0, p, len};
+        }
+        p += len;
+    };
+    auto restore = [&](uint64_t reg) {
+        if (reg < NUM_UNWIND_REGS) {
+            row.regs[reg] = initial.regs[reg];
+        }
+    };
+
+    while (p < end) {
+        auto op = *p++;
+        switch (op >> 6) {
+            case 1: advance(op & 0x3f); continue;                                                  // advance_loc
+            case 2: set_rule(op & 0x3f, RuleType::Offset, read_uleb(p) * cie.data_align); continue;  // offset
+            case 3: restore(op & 0x3f); continue;                                                  // restore
+            default: break;
+        }
+
+        uint64_t reg;
+        switch (op) {
+            case 0x00: break;                                                   // nop
+            case 0x01: row.loc = read_value<uint64_t>(p); break;                // set_loc
+            case 0x02: advance(read_value<uint8_t>(p)); break;                  // advance_loc1
+            case 0x03: advance(read_value<uint16_t>(p)); break;                 // advance_loc2
+            case 0x04: advance(read_value<uint32_t>(p)); break;                 // advance_loc4
+            case 0x05:                                                          // offset_extended
+                reg = read_uleb(p);
+                set_rule(reg, RuleType::Offset, read_uleb(p) * cie.data_align);
+                break;
+            case 0x06: restore(read_uleb(p)); break;                            // restore_extended
+            case 0x07: set_rule(read_uleb(p), RuleType::Undefined); break;      // undefined
+            case 0x08: set_rule(read_uleb(p), RuleType::SameValue); break;      // same_value
+            case 0x09:                                                          // register
+                reg = read_uleb(p);
+                set_rule(reg, RuleType::Register, 0, read_uleb(p));
+                break;
+            case 0x0a: state_stack.push_back(row); break;                       // remember_state
+            case 0x0b:                                                          // restore_state (keeps the location)
+                if (!state_stack.empty()) {
+                    auto loc = row.loc;
+                    row = state_stack.back();
+                    row.loc = loc;
+                    state_stack.pop_back();
+                }
+                break;
+            case 0x0c:                                                          // def_cfa
+                row.cfa.type = RuleType::Offset;
+                row.cfa.reg = read_uleb(p);
+                row.cfa.offset = read_uleb(p);
+                break;
+            case 0x0d:                                                          // def_cfa_register
+                row.cfa.type = RuleType::Offset;
+                row.cfa.reg = read_uleb(p);
+                break;
+            case 0x0e: row.cfa.offset = read_uleb(p); break;                    // def_cfa_offset
+            case 0x0f:                                                          // def_cfa_expression
+                row.cfa.type = RuleType::Expression;
+                row.cfa.expr_len = read_uleb(p);
+                row.cfa.expr = p;
+                p += row.cfa.expr_len;
+                break;
+            case 0x10: reg = read_uleb(p); set_expr(reg, RuleType::Expression); break;      // expression
+            case 0x11:                                                          // offset_extended_sf
+                reg = read_uleb(p);
+                set_rule(reg, RuleType::Offset, read_sleb(p) * cie.data_align);
+                break;
+            case 0x12:                                                          // def_cfa_sf
+                row.cfa.type = RuleType::Offset;
+                row.cfa.reg = read_uleb(p);
+                row.cfa.offset = read_sleb(p) * cie.data_align;
+                break;
+            case 0x13: row.cfa.offset = read_sleb(p) * cie.data_align; break;   // def_cfa_offset_sf
+            case 0x14:                                                          // val_offset
+                reg = read_uleb(p);
+                set_rule(reg, RuleType::ValOffset, read_uleb(p) * cie.data_align);
+                break;
+            case 0x15:                                                          // val_offset_sf
+                reg = read_uleb(p);
+                set_rule(reg, RuleType::ValOffset, read_sleb(p) * cie.data_align);
+                break;
+            case 0x16: reg = read_uleb(p); set_expr(reg, RuleType::ValExpression); break;   // val_expression
+            case 0x2e: read_uleb(p); break;                                     // GNU_args_size
+            case 0x2f:                                                          // GNU_negative_offset_extended
+                reg = read_uleb(p);
+                set_rule(reg, RuleType::Offset, -static_cast<int64_t>(read_uleb(p)) * cie.data_align);
+                break;
+            default:
+                return;     // Unknown instruction: the operands cannot be skipped, so stop here
+        }
+    }
+}
+
+// Evaluate a DWARF expression of a CFI rule (the subset compilers emit there). The initial value (the CFA, for
+// register rules) is pushed first if asked
+bool Unwinder::evaluate(const uint8_t *expr, std::size_t len, const uint64_t *regs, uint32_t valid,
+                        const StackSnapshot& stack, uint64_t initial, bool push_initial, uint64_t& result) {
+    uint64_t st[16];
+    std::size_t sp = 0;
+    if (push_initial) {
+        st[sp++] = initial;
+    }
+
+    auto p = expr;
+    auto end = expr + len;
+    while (p < end) {
+        auto op = *p++;
+        if (sp >= 15) {
+            return false;
+        }
+        if (op >= 0x30 && op <= 0x4f) {                                 // lit0-31
+            st[sp++] = op - 0x30;
+            continue;
+        }
+        if (op >= 0x70 && op <= 0x80) {                                 // breg0-16
+            if (!(valid & (1u << (op - 0x70)))) return false;
+            st[sp++] = regs[op - 0x70] + read_sleb(p);
+            continue;
+        }
+        if (op >= 0x1a && op <= 0x2e && op != 0x1f && op != 0x23 && sp < 2) {
+            return false;   // Binary operators
+        }
+
+        uint64_t b;
+        switch (op) {
+            case 0x08: st[sp++] = read_value<uint8_t>(p); break;        // const1u
+            case 0x09: st[sp++] = read_value<int8_t>(p); break;         // const1s
+            case 0x0a: st[sp++] = read_value<uint16_t>(p); break;       // const2u
+            case 0x0b: st[sp++] = read_value<int16_t>(p); break;        // const2s
+            case 0x0c: st[sp++] = read_value<uint32_t>(p); break;       // const4u
+            case 0x0d: st[sp++] = read_value<int32_t>(p); break;        // const4s
+            case 0x0e: st[sp++] = read_value<uint64_t>(p); break;       // const8u
+            case 0x0f: st[sp++] = read_value<int64_t>(p); break;        // const8s
+            case 0x10: st[sp++] = read_uleb(p); break;                  // constu
+            case 0x11: st[sp++] = read_sleb(p); break;                  // consts
+            case 0x12: if (sp == 0) return false; st[sp] = st[sp - 1]; sp++; break;    // dup
+            case 0x13: if (sp == 0) return false; sp--; break;          // drop
+            case 0x06:                                                  // deref
+                if (sp == 0 || !stack.read_word(st[sp - 1], st[sp - 1])) return false;
+                break;
+            case 0x1f: if (sp == 0) return false; st[sp - 1] = -st[sp - 1]; break;     // neg
+            case 0x23: if (sp == 0) return false; st[sp - 1] += read_uleb(p); break;   // plus_uconst
+            case 0x1a: b = st[--sp]; st[sp - 1] &= b; break;            // and
+            case 0x1c: b = st[--sp]; st[sp - 1] -= b; break;            // minus
+            case 0x1e: b = st[--sp]; st[sp - 1] *= b; break;            // mul
+            case 0x21: b = st[--sp]; st[sp - 1] |= b; break;            // or
+            case 0x22: b = st[--sp]; st[sp - 1] += b; break;            // plus
+            case 0x24: b = st[--sp]; st[sp - 1] = b >= 64 ? 0 : st[sp - 1] << b; break;  // shl
+            case 0x25: b = st[--sp]; st[sp - 1] = b >= 64 ? 0 : st[sp - 1] >> b; break;  // shr
+            case 0x27: b = st[--sp]; st[sp - 1] ^= b; break;            // xor
+            case 0x29: b = st[--sp]; st[sp - 1] = static_cast<int64_t>(st[sp - 1]) == static_cast<int64_t>(b); break;
+            case 0x2a: b = st[--sp]; st[sp - 1] = static_cast<int64_t>(st[sp - 1]) >= static_cast<int64_t>(b); break;
+            case 0x2b: b = st[--sp]; st[sp - 1] = static_cast<int64_t>(st[sp - 1]) > static_cast<int64_t>(b); break;
+            case 0x2c: b = st[--sp]; st[sp - 1] = static_cast<int64_t>(st[sp - 1]) <= static_cast<int64_t>(b); break;
+            case 0x2d: b = st[--sp]; st[sp - 1] = static_cast<int64_t>(st[sp - 1]) < static_cast<int64_t>(b); break;
+            case 0x2e: b = st[--sp]; st[sp - 1] = static_cast<int64_t>(st[sp - 1]) != static_cast<int64_t>(b); break;
+            default: return false;
+        }
+    }
+    if (sp == 0) {
+        return false;
+    }
+    result = st[sp - 1];
+    return true;
+}
+
+std::size_t Unwinder::unwind(const user_regs_struct& regs, uint64_t load_addr, const StackSnapshot& stack,
+                             Frame *frames, std::size_t max) const {
+    return unwind(regs, [&](uint64_t, uint64_t& module_load_addr) {
+        module_load_addr = load_addr;
+        return this;
+    }, stack, frames, max);
+}
+
+std::size_t Unwinder::unwind(const user_regs_struct& regs, const ModuleLookup& lookup, const StackSnapshot& stack,
+                             Frame *frames, std::size_t max) {
+    uint64_t cur[NUM_UNWIND_REGS];
+    uint32_t valid = (1u << NUM_UNWIND_REGS) - 1;
+    auto words = reinterpret_cast<const uint64_t *>(&regs);
+    for (std::size_t i = 0; i < RA; i++) {
+        cur[i] = words[dwarf_reg_indices[i]];
+    }
+    cur[RA] = regs.rip;
+
+    std::size_t n = 0;
+    while (n < max) {
+        auto pc = cur[RA];
+        // Return addresses point after the call, which may already be the start of the next function
+        auto call_pc = n == 0 ? pc : pc - 1;
+        uint64_t load_addr = 0;
+        auto unwinder = lookup(call_pc, load_addr);
+        auto row = unwinder != nullptr ? unwinder->find_row(call_pc - load_addr) : nullptr;
+
+        uint64_t next[NUM_UNWIND_REGS];
+        uint32_t next_valid = 0;
+        uint64_t cfa;
+        auto set = [&](std::size_t reg, uint64_t value) {
+            next[reg] = value;
+            next_valid |= 1u << reg;
+        };
+
+        if (row != nullptr) {
+            if (row->cfa.type == RuleType::Offset && row->cfa.reg < NUM_UNWIND_REGS &&
+                (valid & (1u << row->cfa.reg))) {
+                cfa = cur[row->cfa.reg] + row->cfa.offset;
+            } else if (row->cfa.type != RuleType::Expression ||
+                       !evaluate(row->cfa.expr, row->cfa.expr_len, cur, valid, stack, 0, false, cfa)) {
+                frames[n++] = Frame{pc, 0};
+                break;
+            }
+
+            for (std::size_t reg = 0; reg < NUM_UNWIND_REGS; reg++) {
+                auto& rule = row->regs[reg];
+                uint64_t value;
+                switch (rule.type) {
+                    case RuleType::SameValue:
+                        if (valid & (1u << reg)) set(reg, cur[reg]);
+                        break;
+                    case RuleType::Offset:
+                        if (stack.read_word(cfa + rule.offset, value)) set(reg, value);
+                        break;
+                    case RuleType::ValOffset:
+                        set(reg, cfa + rule.offset);
+                        break;
+                    case RuleType::Register:
+                        if (rule.reg < NUM_UNWIND_REGS && (valid & (1u << rule.reg))) set(reg, cur[rule.reg]);
+                        break;
+                    case RuleType::Expression:
+                        if (evaluate(rule.expr, rule.expr_len, cur, valid, stack, cfa, true, value) &&
+                            stack.read_word(value, value)) {
+                            set(reg, value);
+                        }
+                        break;
+                    case RuleType::ValExpression:
+                        if (evaluate(rule.expr, rule.expr_len, cur, valid, stack, cfa, true, value)) set(reg, value);
+                        break;
+                    case RuleType::Undefined:
+                        break;
+                }
+            }
+        } else {
+            // No CFI: follow the frame pointer, or at the first frame assume we are at a function's entry
+            uint64_t value;
+            if ((valid & (1u << RBP)) && cur[RBP] > cur[RSP] && stack.read_word(cur[RBP], value)) {
+                cfa = cur[RBP] + 16;
+                set(RBP, value);
+                if (stack.read_word(cur[RBP] + 8, value)) set(RA, value);
+            } else if (n == 0 && stack.read_word(cur[RSP], value)) {
+                cfa = cur[RSP] + 8;
+                set(RA, value);
+                if (valid & (1u << RBP)) set(RBP, cur[RBP]);
+            } else {
+                frames[n++] = Frame{pc, 0};
+                break;
+            }
+            for (auto reg : {3, 12, 13, 14, 15}) {
+                if (valid & (1u << reg)) set(reg, cur[reg]);
+            }
+        }
+
+        frames[n++] = Frame{pc, cfa};
+        set(RSP, cfa);
+        // The outermost frame has an undefined return address; a CFA that does not move up the stack is garbage
+        if (!(next_valid & (1u << RA)) || next[RA] == 0 || cfa <= cur[RSP]) {
+            break;
+        }
+        std::copy(next, next + NUM_UNWIND_REGS, cur);
+        valid = next_valid;
+    }
+    return n;
+}
@@ -0,0 +1,637 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "Registers.h"
+#include "ValuePrinter.h"
+
+using Kind = TypeLayout::Kind;
+using Encoding = TypeLayout::Encoding;
+
+static uint64_t read_uleb(const uint8_t *&p) {
+    uint64_t result = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = *p++;
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return result;
+}
+
+static int64_t read_sleb(const uint8_t *&p) {
+    int64_t result = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = *p++;
+        result |= static_cast<int64_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    if (shift < 64 && (byte & 0x40)) {
+        result |= -(int64_t{1} << shift);
+    }
+    return result;
+}
+
+template <typename T>
+static T read_raw(const uint8_t *&p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+// Little endian integer of size bytes
+static uint64_t read_unsigned(const uint8_t *data, std::size_t size) {
+    uint64_t value = 0;
+    std::memcpy(&value, data, std::min(size, sizeof(value)));
+    return value;
+}
+
+static int64_t read_signed(const uint8_t *data, std::size_t size) {
+    auto value = read_unsigned(data, size);
+    if (size > 0 && size < sizeof(value)) {
+        auto shift = 64 - size * 8;
+        return static_cast<int64_t>(value << shift) >> shift;
+    }
+    return static_cast<int64_t>(value);
+}
+
+static bool is_signed(const TypeLayout& type) {
+    return type.kind == Kind::Enum || type.encoding == Encoding::Signed || type.encoding == Encoding::SignedChar;
+}
+
+// Value of a bit field, widened to a word
+static uint64_t extract_bits(const uint8_t *data, std::size_t avail, unsigned bit_offset, unsigned bit_size,
+                             bool sign_extend) {
+    auto value = read_unsigned(data, std::min<std::size_t>(avail, (bit_offset + bit_size + 7) / 8)) >> bit_offset;
+    if (bit_size < 64) {
+        value &= (uint64_t{1} << bit_size) - 1;
+        if (sign_extend && (value >> (bit_size - 1)) & 1) {
+            value |= ~uint64_t{0} << bit_size;
+        }
+    }
+    return value;
+}
+
+static void write_char(char c, char quote, std::ostream& out) {
+    switch (c) {
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        case '\r': out << "\\r"; break;
+        case '\\': out << "\\\\"; break;
+        default:
+            if (c == quote) {
+                out << '\\' << c;
+            } else if (std::isprint(static_cast<unsigned char>(c))) {
+                out << c;
+            } else {
+                out << '\\' << std::oct << static_cast<unsigned>(static_cast<unsigned char>(c)) << std::dec;
+            }
+    }
+}
+
+static std::string parse_identifier(const std::string& expression, std::size_t& pos) {
+    auto start = pos;
+    while (pos < expression.size() && (std::isalnum(static_cast<unsigned char>(expression[pos])) || expression[pos] == '_')) {
+        pos++;
+    }
+    if (pos == start) {
+        throw std::invalid_argument{"Expected a name at '" + expression.substr(start) + "'"};
+    }
+    return expression.substr(start, pos - start);
+}
+
+// Print the value of an expression as 'expression = value'
+void ValuePrinter::print(const std::string& expression, std::ostream& out) {
+    // Prefix operators apply last: *p->next is *(p->next)
+    std::size_t pos = 0;
+    std::size_t derefs = 0;
+    bool address_of = false;
+    for (; pos < expression.size() && (expression[pos] == '*' || expression[pos] == '&' || expression[pos] == ' '); pos++) {
+        derefs += expression[pos] == '*';
+        address_of |= expression[pos] == '&';
+    }
+
+    auto object = locate(parse_identifier(expression, pos));
+    while (pos < expression.size()) {
+        if (expression[pos] == '.') {
+            pos++;
+            select_member(object, parse_identifier(expression, pos));
+        } else if (expression.compare(pos, 2, "->") == 0) {
+            pos += 2;
+            object = dereference(object, 0);
+            select_member(object, parse_identifier(expression, pos));
+        } else if (expression[pos] == '[') {
+            auto end = expression.find(']', pos);
+            if (end == std::string::npos) {
+                throw std::invalid_argument{"Missing ']'"};
+            }
+            auto index = std::stoull(expression.substr(pos + 1, end - pos - 1), nullptr, 0);
+            pos = end + 1;
+            object = dereference(object, index);
+        } else {
+            throw std::invalid_argument{"Cannot parse '" + expression.substr(pos) + "'"};
+        }
+    }
+    for (std::size_t i = 0; i < derefs; i++) {
+        object = dereference(object, 0);
+    }
+
+    out << expression << " = ";
+    if (address_of) {
+        if (object.pieces.size() != 1 || object.pieces[0].type != Piece::Type::Memory || object.bit_size != 0) {
+            throw std::invalid_argument{"Cannot take the address of a value that is not in memory"};
+        }
+        out << '(' << object.type->name << " *) 0x" << std::hex << object.pieces[0].value + object.offset
+            << std::dec << '\n';
+        return;
+    }
+
+    // Everything the value needs is read in one go (up to a limit, as only part of a large array is printed)
+    auto& type = object.type->resolve();
+    std::vector<uint8_t> buf(std::min<uint64_t>(type.size, MAX_VALUE_SIZE));
+    std::size_t avail = buf.size();
+    if (object.bit_size != 0) {
+        buf.resize(8);
+        avail = read(object, buf.data(), std::min<std::size_t>(8, (object.bit_offset + object.bit_size + 7) / 8));
+        auto bits = extract_bits(buf.data(), avail, object.bit_offset, object.bit_size, is_signed(type));
+        std::memcpy(buf.data(), &bits, sizeof(bits));
+        avail = sizeof(bits);
+    } else if (!buf.empty()) {
+        avail = read(object, buf.data(), buf.size());
+        if (avail == 0) {
+            throw std::out_of_range{"Cannot access memory of " + expression};
+        }
+    }
+    format(*object.type, buf.data(), avail, out);
+    out << '\n';
+}
+
+// Find a variable and evaluate its location
+ValuePrinter::Object ValuePrinter::locate(const std::string& name) {
+    auto variable = _ctx.find_variable(_frame.pc, name);
+    Object object;
+    object.type = &_ctx.get_type_layout(variable);
+
+    if (variable.has(dwarf::DW_AT::const_value)) {
+        auto val = variable[dwarf::DW_AT::const_value];
+        Piece piece;
+        if (val.get_type() == dwarf::value::type::block) {
+            std::size_t size;
+            piece.type = Piece::Type::Implicit;
+            piece.data = static_cast<const uint8_t *>(val.as_block(&size));
+            piece.value = size;
+        } else {
+            piece.type = Piece::Type::Literal;
+            piece.value = val.get_type() == dwarf::value::type::sconstant ? val.as_sconstant() : val.as_uconstant();
+        }
+        object.pieces.push_back(piece);
+        return object;
+    }
+
+    const uint8_t *expr;
+    std::size_t len;
+    if (_ctx.get_location(variable, dwarf::DW_AT::location, _frame.pc, expr, len)) {
+        evaluate(expr, len, object.pieces);
+    } else {
+        object.pieces.push_back(Piece{Piece::Type::Unavailable});
+    }
+    return object;
+}
+
+// Run a DWARF location expression, splitting the result into pieces (just one unless it ends with DW_OP_piece)
+void ValuePrinter::evaluate(const uint8_t *p, std::size_t len, std::vector<Piece>& pieces) {
+    auto start = p;
+    auto end = p + len;
+    uint64_t stack[MAX_STACK];
+    std::size_t sp = 0;
+    auto push = [&](uint64_t value) {
+        if (sp == MAX_STACK) {
+            throw std::invalid_argument{"DWARF expression stack overflow"};
+        }
+        stack[sp++] = value;
+    };
+    auto pop = [&] {
+        if (sp == 0) {
+            throw std::invalid_argument{"Malformed DWARF expression"};
+        }
+        return stack[--sp];
+    };
+    auto binary = [&](auto op) {
+        auto b = pop();
+        auto a = pop();
+        push(op(a, b));
+    };
+
+    // The location of the current piece is the top of the stack unless an operation said otherwise
+    Piece piece;
+    bool located = false;
+    auto finish_piece = [&](std::size_t size) {
+        if (!located) {
+            piece.type = sp > 0 ? Piece::Type::Memory : Piece::Type::Unavailable;
+            piece.value = sp > 0 ? stack[sp - 1] : 0;
+        }
+        piece.size = size;
+        pieces.push_back(piece);
+        piece = Piece{};
+        located = false;
+        sp = 0;
+    };
+
+    while (p < end) {
+        auto op = *p++;
+        if (op >= 0x30 && op <= 0x4f) {             // DW_OP_lit0-31
+            push(op - 0x30);
+        } else if (op >= 0x50 && op <= 0x6f) {      // DW_OP_reg0-31
+            piece.type = Piece::Type::Register;
+            piece.value = op - 0x50;
+            located = true;
+        } else if (op >= 0x70 && op <= 0x8f) {      // DW_OP_breg0-31
+            push(get_reg(op - 0x70) + read_sleb(p));
+        } else {
+            switch (op) {
+                case 0x03: push(read_raw<uint64_t>(p) + _frame.load_addr); break;  // DW_OP_addr
+                case 0x06: push(_memory.read_word(pop())); break;                   // DW_OP_deref
+                case 0x08: push(read_raw<uint8_t>(p)); break;                       // DW_OP_const1u
+                case 0x09: push(read_raw<int8_t>(p)); break;                        // DW_OP_const1s
+                case 0x0a: push(read_raw<uint16_t>(p)); break;                      // DW_OP_const2u
+                case 0x0b: push(read_raw<int16_t>(p)); break;                       // DW_OP_const2s
+                case 0x0c: push(read_raw<uint32_t>(p)); break;                      // DW_OP_const4u
+                case 0x0d: push(read_raw<int32_t>(p)); break;                       // DW_OP_const4s
+                case 0x0e: push(read_raw<uint64_t>(p)); break;                      // DW_OP_const8u
+                case 0x0f: push(read_raw<int64_t>(p)); break;                       // DW_OP_const8s
+                case 0x10: push(read_uleb(p)); break;                               // DW_OP_constu
+                case 0x11: push(read_sleb(p)); break;                               // DW_OP_consts
+                case 0x12: { auto a = pop(); push(a); push(a); break; }             // DW_OP_dup
+                case 0x13: pop(); break;                                            // DW_OP_drop
+                case 0x14: { auto b = pop(), a = pop(); push(a); push(b); push(a); break; }   // DW_OP_over
+                case 0x15: {                                                        // DW_OP_pick
+                    auto index = read_raw<uint8_t>(p);
+                    if (index >= sp) {
+                        throw std::invalid_argument{"Malformed DWARF expression"};
+                    }
+                    push(stack[sp - 1 - index]);
+                    break;
+                }
+                case 0x16: { auto b = pop(), a = pop(); push(b); push(a); break; }  // DW_OP_swap
+                case 0x17: { auto c = pop(), b = pop(), a = pop(); push(c); push(a); push(b); break; }    // DW_OP_rot
+                case 0x19: { auto a = static_cast<int64_t>(pop()); push(a < 0 ? -a : a); break; }         // DW_OP_abs
+                case 0x1a: binary([](uint64_t a, uint64_t b) { return a & b; }); break;
+                case 0x1b: binary([](uint64_t a, uint64_t b) {                      // DW_OP_div (signed)
+                    if (b == 0) throw std::invalid_argument{"Division by zero in DWARF expression"};
+                    return static_cast<uint64_t>(static_cast<int64_t>(a) / static_cast<int64_t>(b));
+                }); break;
+                case 0x1c: binary([](uint64_t a, uint64_t b) { return a - b; }); break;
+                case 0x1d: binary([](uint64_t a, uint64_t b) {                      // DW_OP_mod
+                    if (b == 0) throw std::invalid_argument{"Division by zero in DWARF expression"};
+                    return a % b;
+                }); break;
+                case 0x1e: binary([](uint64_t a, uint64_t b) { return a * b; }); break;
+                case 0x1f: push(-pop()); break;                                     // DW_OP_neg
+                case 0x20: push(~pop()); break;                                     // DW_OP_not
+                case 0x21: binary([](uint64_t a, uint64_t b) { return a | b; }); break;
+                case 0x22: binary([](uint64_t a, uint64_t b) { return a + b; }); break;
+                case 0x23: push(pop() + read_uleb(p)); break;                       // DW_OP_plus_uconst
+                case 0x24: binary([](uint64_t a, uint64_t b) { return b < 64 ? a << b : 0; }); break;
+                case 0x25: binary([](uint64_t a, uint64_t b) { return b < 64 ? a >> b : 0; }); break;
+                case 0x26: binary([](uint64_t a, uint64_t b) {                      // DW_OP_shra
+                    return static_cast<uint64_t>(static_cast<int64_t>(a) >> std::min<uint64_t>(b, 63));
+                }); break;
+                case 0x27: binary([](uint64_t a, uint64_t b) { return a ^ b; }); break;
+                case 0x28: {                                                        // DW_OP_bra
+                    auto offset = read_raw<int16_t>(p);
+                    if (pop() != 0) {
+                        p += offset;
+                    }
+                    break;
+                }
+                case 0x29: binary([](int64_t a, int64_t b) { return a == b; }); break;
+                case 0x2a: binary([](int64_t a, int64_t b) { return a >= b; }); break;
+                case 0x2b: binary([](int64_t a, int64_t b) { return a > b; }); break;
+                case 0x2c: binary([](int64_t a, int64_t b) { return a <= b; }); break;
+                case 0x2d: binary([](int64_t a, int64_t b) { return a < b; }); break;
+                case 0x2e: binary([](int64_t a, int64_t b) { return a != b; }); break;
+                case 0x2f: p += read_raw<int16_t>(p); break;                        // DW_OP_skip
+                case 0x90:                                                          // DW_OP_regx
+                    piece.type = Piece::Type::Register;
+                    piece.value = read_uleb(p);
+                    located = true;
+                    break;
+                case 0x91: push(get_frame_base() + read_sleb(p)); break;            // DW_OP_fbreg
+                case 0x92: {                                                        // DW_OP_bregx
+                    auto reg = read_uleb(p);
+                    push(get_reg(reg) + read_sleb(p));
+                    break;
+                }
+                case 0x93: finish_piece(read_uleb(p)); break;                       // DW_OP_piece
+                case 0x94: {                                                        // DW_OP_deref_size
+                    auto size = read_raw<uint8_t>(p);
+                    uint64_t value = 0;
+                    if (_memory.read(pop(), &value, std::min<std::size_t>(size, sizeof(value))) == 0) {
+                        throw std::out_of_range{"Cannot read memory for a DWARF expression"};
+                    }
+                    push(value);
+                    break;
+                }
+                case 0x96: break;                                                   // DW_OP_nop
+                case 0x9c: push(_frame.cfa()); break;                               // DW_OP_call_frame_cfa
+                case 0x9e:                                                          // DW_OP_implicit_value
+                    piece.type = Piece::Type::Implicit;
+                    piece.value = read_uleb(p);
+                    piece.data = p;
+                    p += piece.value;
+                    located = true;
+                    break;
+                case 0x9f:                                                          // DW_OP_stack_value
+                    piece.type = Piece::Type::Literal;
+                    piece.value = pop();
+                    located = true;
+                    break;
+                case 0xa3:      // DW_OP_entry_value and DW_OP_GNU_entry_value: the value on entry to the function,
+                case 0xf3:      // which only the caller's frame could tell
+                    pieces.assign(1, Piece{Piece::Type::Unavailable});
+                    return;
+                default: {
+                    std::ostringstream msg;
+                    msg << "Unsupported DWARF expression operation 0x" << std::hex << static_cast<unsigned>(op);
+                    throw std::invalid_argument{msg.str()};
+                }
+            }
+        }
+        if (p < start || p > end) {
+            throw std::invalid_argument{"Malformed DWARF expression"};
+        }
+    }
+    if (pieces.empty()) {
+        finish_piece(0);
+    }
+}
+
+// Register of the frame from its DWARF number
+uint64_t ValuePrinter::get_reg(uint64_t dwarf_reg) const {
+    if (dwarf_reg >= MAX_DWARF_REG || dwarf_reg_indices[dwarf_reg] == -1) {
+        throw std::out_of_range{"Value is in DWARF register " + std::to_string(dwarf_reg) + ", which cannot be read"};
+    }
+    return reinterpret_cast<const uint64_t *>(&_frame.regs)[dwarf_reg_indices[dwarf_reg]];
+}
+
+// Frame base of the function around the PC (DW_AT_frame_base), which DW_OP_fbreg offsets are relative to
+uint64_t ValuePrinter::get_frame_base() {
+    if (!_has_frame_base) {
+        auto function = _ctx.get_function_from_pc(_frame.pc);
+        const uint8_t *expr;
+        std::size_t len;
+        if (!_ctx.get_location(function, dwarf::DW_AT::frame_base, _frame.pc, expr, len)) {
+            throw std::out_of_range{"The function has no frame base"};
+        }
+        std::vector<Piece> pieces;
+        evaluate(expr, len, pieces);
+        // Usually DW_OP_call_frame_cfa (a memory location at the CFA) or a register such as rbp
+        _frame_base = pieces[0].type == Piece::Type::Register ? get_reg(pieces[0].value) : pieces[0].value;
+        _has_frame_base = true;
+    }
+    return _frame_base;
+}
+
+// Copy len bytes of an object, with a single transfer when it is in memory.
+// Returns how many bytes could be read
+std::size_t ValuePrinter::read(const Object& object, uint8_t *buf, std::size_t len) {
+    if (object.pieces.size() == 1 && object.pieces[0].type == Piece::Type::Memory) {
+        return _memory.read(object.pieces[0].value + object.offset, buf, len);
+    }
+
+    // Assemble the bytes from every piece that overlaps [offset, offset + len)
+    std::fill(buf, buf + len, 0);
+    uint64_t piece_start = 0;
+    for (auto& piece : object.pieces) {
+        auto piece_size = piece.size != 0 ? piece.size : UINT64_MAX - piece_start;
+        auto low = std::max(piece_start, object.offset);
+        auto high = std::min(piece_start + piece_size, object.offset + len);
+        if (low < high) {
+            auto dest = buf + (low - object.offset);
+            auto from = low - piece_start;
+            auto n = high - low;
+            uint64_t word = piece.value;
+            switch (piece.type) {
+                case Piece::Type::Memory:
+                    if (_memory.read(piece.value + from, dest, n) != n) {
+                        return low - object.offset;
+                    }
+                    break;
+                case Piece::Type::Register:
+                    word = get_reg(piece.value);
+                    [[fallthrough]];
+                case Piece::Type::Literal:
+                    if (from < sizeof(word)) {
+                        std::memcpy(dest, reinterpret_cast<uint8_t *>(&word) + from, std::min(n, sizeof(word) - from));
+                    }
+                    break;
+                case Piece::Type::Implicit:
+                    if (from < piece.value) {
+                        std::memcpy(dest, piece.data + from, std::min(n, piece.value - from));
+                    }
+                    break;
+                case Piece::Type::Unavailable:
+                    throw std::out_of_range{"<optimized out>"};
+            }
+        }
+        piece_start += piece_size;
+        if (piece_start >= object.offset + len) {
+            break;
+        }
+    }
+    return len;
+}
+
+// Follow a pointer to its index-th element (or take the index-th element of an array)
+ValuePrinter::Object ValuePrinter::dereference(const Object& pointer, uint64_t index) {
+    auto& type = pointer.type->resolve();
+    if (type.kind == Kind::Array) {
+        auto element = pointer;
+        element.offset += index * type.stride;
+        element.type = type.target;
+        return element;
+    }
+    if (type.kind != Kind::Pointer) {
+        throw std::invalid_argument{"Not a pointer or an array"};
+    }
+    if (type.target->resolve().kind == Kind::Void) {
+        throw std::invalid_argument{"Cannot dereference a void pointer"};
+    }
+    uint64_t addr;
+    if (read(pointer, reinterpret_cast<uint8_t *>(&addr), sizeof(addr)) != sizeof(addr)) {
+        throw std::out_of_range{"Cannot read the pointer"};
+    }
+    Object element;
+    element.pieces.push_back(Piece{Piece::Type::Memory, addr + index * type.target->resolve().size});
+    element.type = type.target;
+    return element;
+}
+
+void ValuePrinter::select_member(Object& object, const std::string& name) {
+    auto& type = object.type->resolve();
+    if (type.kind != Kind::Struct) {
+        throw std::invalid_argument{"Not a struct or union: " + type.name};
+    }
+    auto member = type.find_member(name, object.offset);
+    if (member == nullptr) {
+        throw std::out_of_range{"There is no member named " + name};
+    }
+    object.type = member->type;
+    object.bit_offset = member->bit_offset;
+    object.bit_size = member->bit_size;
+}
+
+// Format a value from a copy of its bytes (avail of them could be read)
+void ValuePrinter::format(const TypeLayout& declared, const uint8_t *data, std::size_t avail, std::ostream& out) {
+    auto& type = declared.resolve();
+    if ((type.kind == Kind::Base || type.kind == Kind::Enum || type.kind == Kind::Pointer) && type.size > avail) {
+        out << "<unreadable>";
+        return;
+    }
+
+    switch (type.kind) {
+        case Kind::Base:
+            format_base(type, data, out);
+            break;
+        case Kind::Enum:
+        {
+            auto value = read_signed(data, type.size);
+            auto iter = std::find_if(type.enumerators.begin(), type.enumerators.end(),
+                                     [&](auto& e) { return e.first == value; });
+            if (iter != type.enumerators.end()) {
+                out << iter->second;
+            } else {
+                out << value;
+            }
+            break;
+        }
+        case Kind::Pointer:
+        {
+            auto addr = read_unsigned(data, type.size);
+            auto& target = type.target->resolve();
+            bool is_string = target.kind == Kind::Base && target.size == 1 &&
+                             (target.encoding == Encoding::SignedChar || target.encoding == Encoding::UnsignedChar);
+            if (!is_string) {
+                out << '(' << declared.name << ") ";
+            }
+            out << "0x" << std::hex << addr << std::dec;
+            if (is_string && addr != 0) {
+                char str[MAX_STRING];
+                auto n = _memory.read(addr, str, sizeof(str));
+                out << ' ';
+                format_string(str, n, out);
+                if (strnlen(str, n) == n) {
+                    out << "...";
+                }
+            }
+            break;
+        }
+        case Kind::Struct:
+        {
+            out << '{';
+            bool first = true;
+            for (auto& member : type.members) {
+                out << (first ? "" : ", ");
+                if (!member.name.empty()) {
+                    out << member.name << " = ";
+                }
+                auto member_avail = avail > member.offset ? avail - member.offset : 0;
+                if (member.bit_size != 0) {
+                    auto bits = extract_bits(data + member.offset, member_avail, member.bit_offset, member.bit_size,
+                                             is_signed(member.type->resolve()));
+                    format(*member.type, reinterpret_cast<const uint8_t *>(&bits), sizeof(bits), out);
+                } else {
+                    format(*member.type, data + std::min<uint64_t>(member.offset, avail), member_avail, out);
+                }
+                first = false;
+            }
+            out << '}';
+            break;
+        }
+        case Kind::Array:
+        {
+            auto& element = type.target->resolve();
+            if (element.kind == Kind::Base && element.size == 1 &&
+                (element.encoding == Encoding::SignedChar || element.encoding == Encoding::UnsignedChar)) {
+                format_string(reinterpret_cast<const char *>(data), std::min<std::size_t>(type.count, avail), out);
+                break;
+            }
+            out << '{';
+            std::size_t i = 0;
+            for (; i < type.count && i < MAX_ELEMENTS && i * type.stride < avail; i++) {
+                out << (i > 0 ? ", " : "");
+                format(*type.target, data + i * type.stride, avail - i * type.stride, out);
+            }
+            if (i < type.count) {
+                out << (i > 0 ? ", " : "") << "...";
+            }
+            out << '}';
+            break;
+        }
+        case Kind::Function:
+            out << '{' << declared.name << '}';
+            break;
+        default:
+            out << "void";
+            break;
+    }
+}
+
+void ValuePrinter::format_base(const TypeLayout& type, const uint8_t *data, std::ostream& out) {
+    switch (type.encoding) {
+        case Encoding::Float:
+            if (type.size == sizeof(float)) {
+                float value;
+                std::memcpy(&value, data, sizeof(value));
+                out << value;
+            } else if (type.size == sizeof(double)) {
+                double value;
+                std::memcpy(&value, data, sizeof(value));
+                out << value;
+            } else {
+                long double value = 0;  // x87 extended precision, 10 bytes padded to 16
+                std::memcpy(&value, data, std::min(type.size, sizeof(value)));
+                out << value;
+            }
+            break;
+        case Encoding::Bool:
+            out << (read_unsigned(data, type.size) != 0 ? "true" : "false");
+            break;
+        case Encoding::SignedChar:
+        case Encoding::UnsignedChar:
+        {
+            auto value = type.encoding == Encoding::SignedChar ? read_signed(data, type.size)
+                                                                : static_cast<int64_t>(read_unsigned(data, type.size));
+            out << value << " '";
+            write_char(static_cast<char>(value), '\'', out);
+            out << '\'';
+            break;
+        }
+        case Encoding::Signed:
+            out << read_signed(data, type.size);
+            break;
+        case Encoding::Unsigned:
+            out << read_unsigned(data, type.size);
+            break;
+    }
+}
+
+// A C string, up to its terminator or len bytes
+void ValuePrinter::format_string(const char *data, std::size_t len, std::ostream& out) {
+    auto n = strnlen(data, len);
+    out << '"';
+    for (std::size_t i = 0; i < n; i++) {
+        write_char(data[i], '"', out);
+    }
+    out << '"';
+}
@@ -0,0 +1,50 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+#include <algorithm>
+#include "WorkerPool.h"
+
+WorkerPool& WorkerPool::get() {
+    static auto pool = new WorkerPool;  // Never destroyed, so that exit does not wait for the jobs
+    return *pool;
+}
+
+WorkerPool::WorkerPool() {
+    auto num_cores = std::thread::hardware_concurrency();
+    auto num_threads = num_cores > 1 ? num_cores - 1 : 1;
+    for (std::size_t i = 0; i < num_threads; i++) {
+        _threads.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+void WorkerPool::submit(const void *owner, std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+        _jobs.emplace_back(owner, std::move(job));
+    }
+    _queued.notify_one();
+}
+
+void WorkerPool::cancel(const void *owner) {
+    std::unique_lock<std::mutex> lock {_mutex};
+    _jobs.erase(std::remove_if(_jobs.begin(), _jobs.end(), [&](auto& job) { return job.first == owner; }),
+                _jobs.end());
+    _finished.wait(lock, [&] { return std::find(_running.begin(), _running.end(), owner) == _running.end(); });
+}
+
+// Take jobs in the order they were queued
+void WorkerPool::run() {
+    std::unique_lock<std::mutex> lock {_mutex};
+    while (true) {
+        _queued.wait(lock, [&] { return !_jobs.empty(); });
+        auto [owner, job] = std::move(_jobs.front());
+        _jobs.pop_front();
+        _running.push_back(owner);
+        lock.unlock();
+        job();
+        lock.lock();
+        _running.erase(std::find(_running.begin(), _running.end(), owner));
+        _finished.notify_all();
+    }
+}
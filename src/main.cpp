@@ -3,6 +3,7 @@
 #include <sstream>
 #include <unistd.h>
 #include <Debugger.h>
+#include <GdbServer.h>
 
 
 int main(int argc, char *argv[]) {
@@ -11,16 +12,87 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    // syscalls <name>,... launches the program with a filter that stops it at these system calls (to be traced or caught)
+    std::vector<long> syscalls;
+    if (std::string(argv[1]) == "syscalls") {
+        if (argc < 4) {
+            std::cerr << "Usage: syscalls <name>,... <program>\n";
+            return EXIT_FAILURE;
+        }
+        try {
+            syscalls = SyscallFilter::parse(argv[2]);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    // serve <port|socket> <program | attach <pid>> drives the process from a GDB client instead of the prompt
+    std::string address;
+    if (std::string(argv[1]) == "serve") {
+        if (argc < 4) {
+            std::cerr << "Usage: serve <port|socket> <program | attach <pid>>\n";
+            return EXIT_FAILURE;
+        }
+        address = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+    auto run = [&](Debugger& debugger) {
+        if (address.empty()) {
+            debugger.run();
+        } else {
+            GdbServer{debugger}.serve(address);
+        }
+    };
+
+    // core <core-file> [program]: inspect a core file (the program defaults to the executable named in the core)
+    if (std::string(argv[1]) == "core") {
+        if (argc < 3) {
+            std::cerr << "Please specify a core file.\n";
+            return EXIT_FAILURE;
+        }
+        std::unique_ptr<CoreFile> core;
+        try {
+            core = std::make_unique<CoreFile>(argv[2]);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        Debugger debugger {std::move(core), argc > 3 ? argv[3] : ""};
+        debugger.run();
+        return EXIT_SUCCESS;
+    }
+
+    if (std::string(argv[1]) == "attach") {
+        if (!syscalls.empty()) {
+            std::cerr << "System calls can only be filtered in a launched program.\n";
+            return EXIT_FAILURE;
+        }
+        if (argc < 3) {
+            std::cerr << "Please specify the pid of the process to attach to.\n";
+            return EXIT_FAILURE;
+        }
+        pid_t pid = std::stoi(argv[2]);
+        Debugger debugger {Debugger::read_exe_path(pid), pid};
+        debugger.attach();
+        run(debugger);
+        return EXIT_SUCCESS;
+    }
+
     auto prog = argv[1];    // program name
 
     pid_t pid = fork();
     if (pid != 0) {
         // Execute debugger (parent)
         Debugger debugger {prog, pid};
-        debugger.run();
+        debugger.filter_syscalls(syscalls);
+        run(debugger);
     } else {
         // Execute program to debug (child)
-        Debugger::launch_process(prog, pid);
+        Debugger::launch_process(prog, pid, syscalls);
     }
 }
 
@@ -0,0 +1,327 @@
+//
+// Created by agent on 17/10/2026.
+//
+
+// Stand-in GDB client: launches `LinuxDebugger serve <socket> <program>`, plays a scripted session against it and
+// checks every reply (framing, checksums and acks, packet batching, no-ack mode, qXfer, registers, binary and hex
+// memory packets, Z0/Z2, vCont and stop replies), up to the exit of the program. Exits with 1 if a check failed.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+constexpr uint64_t AT_ENTRY_TYPE = 9;
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what, const std::string& got = "") {
+    std::cout << (ok ? "PASS " : "FAIL ") << what;
+    if (!ok && !got.empty()) {
+        std::cout << " (got '" << got << "')";
+    }
+    std::cout << '\n';
+    failures += !ok;
+}
+
+static std::string to_hex(uint64_t value) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%lx", static_cast<unsigned long>(value));
+    return buf;
+}
+
+static std::string encode_hex(const std::string& bytes) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : bytes) {
+        out += HEX[c >> 4];
+        out += HEX[c & 0xf];
+    }
+    return out;
+}
+
+static std::string decode_hex(const std::string& hex) {
+    std::string out;
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out += static_cast<char>(std::stoul(hex.substr(i, 2), nullptr, 16));
+    }
+    return out;
+}
+
+// A little-endian value from the start of some bytes
+static uint64_t to_value(const std::string& bytes) {
+    uint64_t value = 0;
+    std::memcpy(&value, bytes.data(), std::min(bytes.size(), sizeof(value)));
+    return value;
+}
+
+// Escape binary data for an X packet
+static std::string escape_binary(const std::string& data) {
+    std::string out;
+    for (auto c : data) {
+        if (c == '#' || c == '$' || c == '}' || c == '*') {
+            out += '}';
+            c ^= 0x20;
+        }
+        out += c;
+    }
+    return out;
+}
+
+// One connection to the server, speaking the remote protocol
+class Connection {
+public:
+    explicit Connection(const std::string& path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        // The server listens once the program is loaded
+        for (int attempt = 0; attempt < 100; attempt++) {
+            _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (connect(_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+                return;
+            }
+            close(_fd);
+            usleep(50000);
+        }
+        throw std::runtime_error{"Could not connect to " + path};
+    }
+    ~Connection() { close(_fd); }
+
+    void set_ack(bool ack) { _ack = ack; }
+
+    static std::string frame(const std::string& payload, bool good_checksum = true) {
+        uint8_t sum = 0;
+        for (auto c : payload) {
+            sum += static_cast<uint8_t>(c);
+        }
+        std::string hex = encode_hex(std::string(1, static_cast<char>(good_checksum ? sum : sum + 1)));
+        return "$" + payload + "#" + hex;
+    }
+
+    void send_raw(const std::string& bytes) {
+        for (std::size_t sent = 0; sent < bytes.size();) {
+            auto n = send(_fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (n == -1) {
+                throw std::runtime_error{std::string{"send: "} + std::strerror(errno)};
+            }
+            sent += n;
+        }
+    }
+
+    // The next byte outside a packet ('+' or '-')
+    char receive_ack() {
+        fill(1);
+        auto c = _in[0];
+        _in.erase(0, 1);
+        return c;
+    }
+
+    // The next packet, with its checksum checked (and acked, unless in no-ack mode) and binary escapes undone
+    std::string receive() {
+        while (true) {
+            fill(1);
+            if (_in[0] == '$') {
+                break;
+            }
+            if (!_ack || _in[0] != '+') {
+                throw std::runtime_error{std::string{"Unexpected byte '"} + _in[0] + "' before a packet"};
+            }
+            _in.erase(0, 1);
+        }
+        std::size_t hash;
+        while ((hash = _in.find('#')) == std::string::npos || hash + 2 >= _in.size()) {
+            fill(_in.size() + 1);
+        }
+        uint8_t sum = 0;
+        std::string payload;
+        for (std::size_t i = 1; i < hash; i++) {
+            sum += static_cast<uint8_t>(_in[i]);
+            if (_in[i] == '}') {
+                sum += static_cast<uint8_t>(_in[++i]);
+                payload += static_cast<char>(_in[i] ^ 0x20);
+            } else {
+                payload += _in[i];
+            }
+        }
+        auto checksum = std::stoul(_in.substr(hash + 1, 2), nullptr, 16);
+        _in.erase(0, hash + 3);
+        if (sum != checksum) {
+            throw std::runtime_error{"Bad checksum on reply '" + payload + "'"};
+        }
+        if (_ack) {
+            send_raw("+");
+        }
+        return payload;
+    }
+
+    std::string request(const std::string& payload) {
+        send_raw(frame(payload));
+        if (_ack && receive_ack() != '+') {
+            throw std::runtime_error{"Request '" + payload + "' was not acked"};
+        }
+        return receive();
+    }
+
+    // Whether the server has gone (the connection was closed)
+    bool closed() {
+        char c;
+        return recv(_fd, &c, 1, 0) == 0;
+    }
+
+private:
+    int _fd = -1;
+    bool _ack = true;
+    std::string _in;
+
+    void fill(std::size_t size) {
+        char buf[4096];
+        while (_in.size() < size) {
+            auto n = recv(_fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                throw std::runtime_error{"The server closed the connection"};
+            }
+            _in.append(buf, n);
+        }
+    }
+};
+
+// The stop reply a T packet gives for a register (by number), as a value
+static bool stop_register(const std::string& reply, unsigned regnum, uint64_t& value) {
+    auto key = ";" + encode_hex(std::string(1, static_cast<char>(regnum))) + ":";
+    auto pos = reply.find(key);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    auto end = reply.find(';', pos + 1);
+    value = to_value(decode_hex(reply.substr(pos + key.size(), end - pos - key.size())));
+    return true;
+}
+
+static std::string stop_thread(const std::string& reply) {
+    auto pos = reply.find("thread:");
+    return pos == std::string::npos ? "" : reply.substr(pos + 7, reply.find(';', pos) - pos - 7);
+}
+
+static void run_session(Connection& gdb) {
+    // Framing: a bad checksum is nacked, a good one acked and answered
+    gdb.send_raw(Connection::frame("qSupported:swbreak+", false));
+    check(gdb.receive_ack() == '-', "bad checksum is nacked");
+    auto supported = gdb.request("qSupported:swbreak+;hwbreak+");
+    check(supported.find("QStartNoAckMode+") != std::string::npos &&
+          supported.find("qXfer:features:read+") != std::string::npos, "qSupported", supported);
+
+    // Batching: two requests in one write, both answered
+    gdb.send_raw(Connection::frame("?") + Connection::frame("qC"));
+    bool acked = gdb.receive_ack() == '+';
+    auto stop = gdb.receive();
+    acked = gdb.receive_ack() == '+' && acked;
+    auto current = gdb.receive();
+    check(acked && stop[0] == 'T' && current.rfind("QC", 0) == 0, "batched ? and qC", stop + " / " + current);
+    auto tid = stop_thread(stop);
+    check(!tid.empty() && current == "QC" + tid, "stop reply names the current thread", stop);
+
+    check(gdb.request("QStartNoAckMode") == "OK", "QStartNoAckMode");
+    gdb.set_ack(false);
+
+    // qXfer objects, read in parts
+    auto xml = gdb.request("qXfer:features:read:target.xml:0,400");
+    std::string whole = xml.substr(1);
+    while (xml[0] == 'm') {
+        xml = gdb.request("qXfer:features:read:target.xml:" + to_hex(whole.size()) + ",400");
+        whole += xml.substr(1);
+    }
+    check(whole.find("i386:x86-64") != std::string::npos && whole.find("</target>") != std::string::npos,
+          "qXfer target.xml in parts", whole.substr(0, 80));
+    auto exe = gdb.request("qXfer:exec-file:read::0,1000");
+    check(exe[0] == 'l' && exe.size() > 1, "qXfer exec-file", exe);
+    auto auxv = gdb.request("qXfer:auxv:read::0,1000");
+    uint64_t entry = 0;
+    for (std::size_t i = 1; i + 16 <= auxv.size(); i += 16) {
+        if (to_value(auxv.substr(i, 8)) == AT_ENTRY_TYPE) {
+            entry = to_value(auxv.substr(i + 8, 8));
+        }
+    }
+    check(auxv[0] == 'l' && entry != 0, "qXfer auxv has AT_ENTRY");
+
+    // Registers: g and p agree on rip
+    auto regs = gdb.request("g");
+    auto rip_hex = gdb.request("p10");
+    check(regs.size() >= 17 * 16 && regs.substr(16 * 16, 16) == rip_hex, "g and p agree on rip", rip_hex);
+    auto rip = to_value(decode_hex(rip_hex));
+
+    // Memory: x (binary) and m (hex) read the same bytes, X writes them back
+    auto hex = gdb.request("m" + to_hex(rip) + ",20");
+    auto binary = gdb.request("x" + to_hex(rip) + ",20");
+    check(binary.size() == 33 && binary[0] == 'b' && encode_hex(binary.substr(1)) == hex, "x matches m", binary);
+    check(gdb.request("X" + to_hex(rip) + ",20:" + escape_binary(binary.substr(1))) == "OK", "X write");
+    check(gdb.request("m" + to_hex(rip) + ",20") == hex, "memory unchanged after X");
+    check(gdb.request("Mbad") == "E01", "malformed M is an error");
+
+    // Breakpoints: Z0 at the entry point, hidden from memory reads, reported as swbreak
+    auto original = gdb.request("m" + to_hex(entry) + ",1");
+    check(gdb.request("Z0," + to_hex(entry) + ",1") == "OK", "Z0 insert");
+    check(gdb.request("m" + to_hex(entry) + ",1") == original, "memory reads hide the int3", original);
+    check(gdb.request("vCont?").find("c;C;s;S") != std::string::npos, "vCont?");
+    stop = gdb.request("vCont;c");
+    uint64_t pc = 0;
+    check(stop.rfind("T05", 0) == 0 && stop.find("swbreak:") != std::string::npos &&
+          stop_register(stop, 16, pc) && pc == entry, "vCont;c stops at the breakpoint", stop);
+    check(gdb.request("z0," + to_hex(entry) + ",1") == "OK", "z0 remove");
+
+    // Watchpoints: Z2 is taken (and removed), Z3 is not supported
+    uint64_t sp = 0;
+    stop_register(stop, 7, sp);
+    check(gdb.request("Z2," + to_hex(sp) + ",8") == "OK", "Z2 insert");
+    check(gdb.request("z2," + to_hex(sp) + ",8") == "OK", "z2 remove");
+    check(gdb.request("Z3," + to_hex(sp) + ",8").empty(), "Z3 not supported");
+
+    // A single step of one thread
+    stop = gdb.request("vCont;s:" + tid);
+    uint64_t next_pc = 0;
+    check(stop.rfind("T05", 0) == 0 && stop_thread(stop) == tid && stop_register(stop, 16, next_pc) &&
+          next_pc != entry, "vCont;s steps one instruction", stop);
+
+    // Run to the end: the example program exits with 42
+    auto exited = gdb.request("vCont;c");
+    check(exited == "W2a", "exit reported with its status", exited);
+    check(gdb.closed(), "server closes the connection once the process exits");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: GdbClient <LinuxDebugger> <program>\n";
+        return EXIT_FAILURE;
+    }
+    auto path = "/tmp/gdb-client-" + std::to_string(getpid()) + ".sock";
+    auto server = fork();
+    if (server == 0) {
+        execl(argv[1], argv[1], "serve", path.c_str(), argv[2], nullptr);
+        std::cerr << "Could not run " << argv[1] << ": " << std::strerror(errno) << '\n';
+        _exit(EXIT_FAILURE);
+    }
+
+    try {
+        Connection gdb {path};
+        run_session(gdb);
+    } catch (const std::exception& e) {
+        check(false, e.what());
+        kill(server, SIGKILL);
+    }
+
+    int status;
+    waitpid(server, &status, 0);
+    check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "server exits cleanly");
+    std::cout << (failures == 0 ? "All checks passed\n" : std::to_string(failures) + " checks failed\n");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}